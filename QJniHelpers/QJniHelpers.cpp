@@ -38,6 +38,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 
+#include <QtCore/QDateTime>
 #include <QtCore/QDebug>
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
@@ -111,12 +112,469 @@ public:
 };
 
 
+// System.identityHashCode() of a class, used as a cheap key of the metadata cache: different
+// global refs may point to the same class, so the refs can't be compared by value.
+// Returns 0 on failure, which is still a valid (if crowded) key.
+static jint classIdentityHash(JNIEnv * env, jclass clazz)
+{
+	struct IdentityHashMethod
+	{
+		explicit IdentityHashMethod(JNIEnv * env)
+		{
+			if (jclass local = env->FindClass("java/lang/System"))
+			{
+				system_class = static_cast<jclass>(env->NewGlobalRef(local));
+				env->DeleteLocalRef(local);
+				method = env->GetStaticMethodID(system_class, "identityHashCode", "(Ljava/lang/Object;)I");
+			}
+			if (env->ExceptionCheck())
+			{
+				env->ExceptionClear();
+				method = 0;
+			}
+		}
+		jclass system_class = 0; // Global ref, kept for the lifetime of the process
+		jmethodID method = 0;
+	};
+	static const IdentityHashMethod s_identity_hash(env);
+	if (!clazz || !s_identity_hash.method)
+	{
+		return 0;
+	}
+	const jint result = env->CallStaticIntMethod(s_identity_hash.system_class, s_identity_hash.method, clazz);
+	if (env->ExceptionCheck())
+	{
+		env->ExceptionClear();
+		return 0;
+	}
+	return result;
+}
+
+
+// Cache of class metadata which is expensive to query via JNI but never changes for
+// a loaded class: class names (two JNI calls and a string conversion each) and results
+// of IsAssignableFrom(). Entries are keyed by classIdentityHash() of the classes, which
+// QJniClass computes once per instance. The cache is set-associative: a key maps to a small
+// bucket, and IsSameObject() is only called for entries of the bucket with an equal key,
+// so a miss normally costs no JNI calls. Replacement is round-robin within the bucket;
+// the cache is only intended to catch hot diagnostics and type-dispatch paths.
+class QJniClassMetadataCache
+{
+public:
+	static const int c_bucket_count = 8;
+	static const int c_bucket_ways = 4;
+
+	enum NameKind
+	{
+		FullName = 0,
+		SimpleName,
+		DebugName, // Full name in Latin1 or "<unknown>"
+		NameKindCount
+	};
+
+	bool findName(JNIEnv * env, jclass clazz, jint identity, NameKind kind, QByteArray * out)
+	{
+		QMutexLocker locker(&mutex_);
+		if (NameEntry * entry = findNameEntry(env, clazz, identity))
+		{
+			if (!entry->names[kind].isNull())
+			{
+				*out = entry->names[kind];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void storeName(JNIEnv * env, jclass clazz, jint identity, NameKind kind, const QByteArray & name)
+	{
+		QMutexLocker locker(&mutex_);
+		NameEntry * entry = findNameEntry(env, clazz, identity);
+		if (!entry)
+		{
+			const int bucket = bucketOf(identity);
+			entry = &names_[bucket][next_name_[bucket]];
+			next_name_[bucket] = (next_name_[bucket] + 1) % c_bucket_ways;
+			resetRef(env, &entry->clazz, clazz);
+			entry->identity = identity;
+			for (int i = 0; i < NameKindCount; ++i)
+			{
+				entry->names[i] = QByteArray();
+			}
+			if (!entry->clazz)
+			{
+				return;
+			}
+		}
+		entry->names[kind] = name;
+	}
+
+	bool findCastable(JNIEnv * env, jclass from, jint from_identity, jclass to, jint to_identity, bool * out)
+	{
+		QMutexLocker locker(&mutex_);
+		if (CastableEntry * entry = findCastableEntry(env, from, from_identity, to, to_identity))
+		{
+			*out = entry->castable;
+			return true;
+		}
+		return false;
+	}
+
+	void storeCastable(JNIEnv * env, jclass from, jint from_identity, jclass to, jint to_identity, bool castable)
+	{
+		QMutexLocker locker(&mutex_);
+		CastableEntry * entry = findCastableEntry(env, from, from_identity, to, to_identity);
+		if (!entry)
+		{
+			const int bucket = bucketOf(castableKey(from_identity, to_identity));
+			entry = &castable_[bucket][next_castable_[bucket]];
+			next_castable_[bucket] = (next_castable_[bucket] + 1) % c_bucket_ways;
+			resetRef(env, &entry->from, from);
+			resetRef(env, &entry->to, to);
+			if (!entry->from || !entry->to)
+			{
+				resetRef(env, &entry->from, 0);
+				resetRef(env, &entry->to, 0);
+			}
+			entry->from_identity = from_identity;
+			entry->to_identity = to_identity;
+		}
+		entry->castable = castable;
+	}
+
+	void clear(JNIEnv * env)
+	{
+		QMutexLocker locker(&mutex_);
+		for (int b = 0; b < c_bucket_count; ++b)
+		{
+			for (int i = 0; i < c_bucket_ways; ++i)
+			{
+				resetRef(env, &names_[b][i].clazz, 0);
+				for (int k = 0; k < NameKindCount; ++k)
+				{
+					names_[b][i].names[k] = QByteArray();
+				}
+				resetRef(env, &castable_[b][i].from, 0);
+				resetRef(env, &castable_[b][i].to, 0);
+			}
+			next_name_[b] = 0;
+			next_castable_[b] = 0;
+		}
+	}
+
+private:
+	struct NameEntry
+	{
+		jclass clazz = 0; // Global ref
+		jint identity = 0;
+		QByteArray names[NameKindCount];
+	};
+
+	struct CastableEntry
+	{
+		jclass from = 0; // Global ref
+		jclass to = 0; // Global ref
+		jint from_identity = 0;
+		jint to_identity = 0;
+		bool castable = false;
+	};
+
+	static int bucketOf(jint key)
+	{
+		// Identity hashes are not guaranteed to be well mixed in the low bits.
+		quint32 h = static_cast<quint32>(key);
+		h ^= h >> 16;
+		h *= 0x45d9f3bu;
+		h ^= h >> 16;
+		return static_cast<int>(h % c_bucket_count);
+	}
+
+	static jint castableKey(jint from_identity, jint to_identity)
+	{
+		return static_cast<jint>(static_cast<quint32>(from_identity) * 31u + static_cast<quint32>(to_identity));
+	}
+
+	static bool isSameClass(JNIEnv * env, jclass a, jclass b)
+	{
+		return a == b || env->IsSameObject(a, b);
+	}
+
+	static void resetRef(JNIEnv * env, jclass * ref, jclass clazz)
+	{
+		if (*ref)
+		{
+			env->DeleteGlobalRef(*ref);
+			*ref = 0;
+		}
+		if (clazz)
+		{
+			*ref = static_cast<jclass>(env->NewGlobalRef(clazz));
+		}
+	}
+
+	NameEntry * findNameEntry(JNIEnv * env, jclass clazz, jint identity)
+	{
+		NameEntry * bucket = names_[bucketOf(identity)];
+		for (int i = 0; i < c_bucket_ways; ++i)
+		{
+			if (bucket[i].clazz && bucket[i].identity == identity && isSameClass(env, bucket[i].clazz, clazz))
+			{
+				return &bucket[i];
+			}
+		}
+		return 0;
+	}
+
+	CastableEntry * findCastableEntry(JNIEnv * env, jclass from, jint from_identity, jclass to, jint to_identity)
+	{
+		CastableEntry * bucket = castable_[bucketOf(castableKey(from_identity, to_identity))];
+		for (int i = 0; i < c_bucket_ways; ++i)
+		{
+			CastableEntry & entry = bucket[i];
+			if (entry.from
+				&& entry.from_identity == from_identity
+				&& entry.to_identity == to_identity
+				&& isSameClass(env, entry.from, from)
+				&& isSameClass(env, entry.to, to))
+			{
+				return &entry;
+			}
+		}
+		return 0;
+	}
+
+private:
+	QMutex mutex_;
+	NameEntry names_[c_bucket_count][c_bucket_ways];
+	CastableEntry castable_[c_bucket_count][c_bucket_ways];
+	int next_name_[c_bucket_count] = {};
+	int next_castable_[c_bucket_count] = {};
+};
+
+
+
+// Bounded ring of Java exceptions captured in one thread, see QJniEnvPtr::setExceptionCaptureEnabled().
+// Rings are owned by g_CapturedExceptionRings and outlive their threads until they are drained
+// by QJniEnvPtr::takeCapturedExceptions(). All fields are guarded by g_CapturedExceptionsMutex.
+struct QJniCapturedExceptionRing
+{
+	static const int c_capacity = 16;
+
+	struct Item
+	{
+		jthrowable throwable = 0; // Global ref
+		qint64 timestamp = 0;
+	};
+
+	int thread_id = 0;
+	bool thread_finished = false;
+	Item items[c_capacity];
+	int first = 0;
+	int count = 0;
+};
+
+
+// Maximum number of rings of finished threads kept until the next takeCapturedExceptions().
+const int c_max_finished_exception_rings = 32;
+
+
+// QThreadStorage object which marks the thread's ring as finished when the thread exits.
+class QJniCapturedExceptionRingHandle
+{
+public:
+	explicit QJniCapturedExceptionRingHandle(QJniCapturedExceptionRing * ring): ring_(ring) {}
+	~QJniCapturedExceptionRingHandle() noexcept;
+	QJniCapturedExceptionRing * ring() const { return ring_; }
+
+private:
+	QJniCapturedExceptionRing * const ring_;
+};
+
 QRecursiveMutex g_PreloadedClassesMutex;
 PreloadedClasses g_PreloadedClasses;
 QThreadStorage<QJniEnvPtrThreadDetacher*> g_JavaThreadDetacher;
+QJniClassMetadataCache g_ClassMetadataCache;
+std::atomic<bool> g_CaptureExceptions(false);
+std::atomic<quint64> g_DroppedCapturedExceptions(0);
+QMutex g_CapturedExceptionsMutex;
+std::vector<QJniCapturedExceptionRing*> g_CapturedExceptionRings;
+QThreadStorage<QJniCapturedExceptionRingHandle*> g_CapturedExceptionRing;
+std::atomic<bool> g_ImplicitAttachAllowed(true);
+// Global ref to the class loader set by QJniEnvPtr::setCurrentThreadClassLoader().
+thread_local jobject g_ThreadClassLoader = nullptr;
 QJniClassUnloader g_ClassUnloader;
 
 
+
+QJniCapturedExceptionRingHandle::~QJniCapturedExceptionRingHandle() noexcept
+{
+	QMutexLocker locker(&g_CapturedExceptionsMutex);
+	ring_->thread_finished = true;
+}
+
+
+// Must be called with g_CapturedExceptionsMutex locked.
+void releaseCapturedExceptions(JNIEnv * env, QJniCapturedExceptionRing * ring)
+{
+	for (int i = 0; i < ring->count; ++i)
+	{
+		env->DeleteGlobalRef(ring->items[(ring->first + i) % QJniCapturedExceptionRing::c_capacity].throwable);
+	}
+	g_DroppedCapturedExceptions += static_cast<quint64>(ring->count);
+	ring->first = 0;
+	ring->count = 0;
+}
+
+
+QJniCapturedExceptionRing * currentThreadExceptionRing(JNIEnv * env)
+{
+	if (g_CapturedExceptionRing.hasLocalData())
+	{
+		return g_CapturedExceptionRing.localData()->ring();
+	}
+	QJniCapturedExceptionRing * ring = new QJniCapturedExceptionRing();
+	ring->thread_id = static_cast<int>(gettid());
+	{
+		QMutexLocker locker(&g_CapturedExceptionsMutex);
+		// Don't let rings of finished threads accumulate if nobody drains them.
+		int finished = 0;
+		for (QJniCapturedExceptionRing * r: g_CapturedExceptionRings)
+		{
+			finished += (r->thread_finished) ? 1 : 0;
+		}
+		for (auto it = g_CapturedExceptionRings.begin();
+			finished >= c_max_finished_exception_rings && it != g_CapturedExceptionRings.end(); )
+		{
+			if ((*it)->thread_finished)
+			{
+				releaseCapturedExceptions(env, *it);
+				delete *it;
+				it = g_CapturedExceptionRings.erase(it);
+				--finished;
+			}
+			else
+			{
+				++it;
+			}
+		}
+		g_CapturedExceptionRings.push_back(ring);
+	}
+	g_CapturedExceptionRing.setLocalData(new QJniCapturedExceptionRingHandle(ring));
+	return ring;
+}
+
+
+// Takes the pending exception and puts it into the current thread's ring.
+// The exception is cleared in any case.
+void captureException(JNIEnv * env)
+{
+	jthrowable throwable = env->ExceptionOccurred();
+	env->ExceptionClear();
+	if (!throwable)
+	{
+		return;
+	}
+	const jthrowable global = static_cast<jthrowable>(env->NewGlobalRef(throwable));
+	env->DeleteLocalRef(throwable);
+	if (!global)
+	{
+		env->ExceptionClear();
+		++g_DroppedCapturedExceptions;
+		return;
+	}
+	QJniCapturedExceptionRing * ring = currentThreadExceptionRing(env);
+	QMutexLocker locker(&g_CapturedExceptionsMutex);
+	if (ring->count == QJniCapturedExceptionRing::c_capacity)
+	{
+		// Drop the oldest one
+		env->DeleteGlobalRef(ring->items[ring->first].throwable);
+		ring->first = (ring->first + 1) % QJniCapturedExceptionRing::c_capacity;
+		--ring->count;
+		++g_DroppedCapturedExceptions;
+	}
+	QJniCapturedExceptionRing::Item & item =
+		ring->items[(ring->first + ring->count) % QJniCapturedExceptionRing::c_capacity];
+	item.throwable = global;
+	item.timestamp = QDateTime::currentMSecsSinceEpoch();
+	++ring->count;
+}
+
+
+// Equivalent of: StringWriter sw; throwable.printStackTrace(new PrintWriter(sw)); return sw.toString();
+// Using plain JNI because QJniObject would capture any exceptions thrown here again.
+QString formatThrowable(QJniEnvPtr & jep, jthrowable throwable)
+{
+	JNIEnv * env = jep.env();
+	QString result;
+	const jclass string_writer_class = jep.findClass("java/io/StringWriter");
+	const jclass print_writer_class = jep.findClass("java/io/PrintWriter");
+	const jclass throwable_class = jep.findClass("java/lang/Throwable");
+	if (string_writer_class && print_writer_class && throwable_class)
+	{
+		const jmethodID string_writer_init = env->GetMethodID(string_writer_class, "<init>", "()V");
+		const jmethodID print_writer_init = env->GetMethodID(print_writer_class, "<init>", "(Ljava/io/Writer;)V");
+		const jmethodID print_writer_flush = env->GetMethodID(print_writer_class, "flush", "()V");
+		const jmethodID print_stack_trace = env->GetMethodID(throwable_class, "printStackTrace", "(Ljava/io/PrintWriter;)V");
+		const jmethodID to_string = env->GetMethodID(string_writer_class, "toString", "()Ljava/lang/String;");
+		if (!jep.clearException(false)
+			&& string_writer_init && print_writer_init && print_writer_flush && print_stack_trace && to_string)
+		{
+			QJniLocalRef string_writer(jep, env->NewObject(string_writer_class, string_writer_init));
+			if (!jep.clearException(false) && string_writer.jObject())
+			{
+				QJniLocalRef print_writer(jep, env->NewObject(print_writer_class, print_writer_init, string_writer.jObject()));
+				if (!jep.clearException(false) && print_writer.jObject())
+				{
+					env->CallVoidMethod(throwable, print_stack_trace, print_writer.jObject());
+					env->CallVoidMethod(print_writer.jObject(), print_writer_flush);
+					if (!jep.clearException(false))
+					{
+						QJniLocalRef text(jep, env->CallObjectMethod(string_writer.jObject(), to_string));
+						if (!jep.clearException(false) && text.jObject())
+						{
+							result = jep.toQString(static_cast<jstring>(text.jObject()));
+						}
+					}
+				}
+			}
+		}
+	}
+	jep.clearException(false);
+	if (result.isEmpty())
+	{
+		result = QStringLiteral("<failed to format Java exception>");
+	}
+	return result;
+}
+
+
+// Load class via the class loader set for current thread. Returns local ref or 0.
+jclass loadClassWithThreadClassLoader(JNIEnv * env, const char * name)
+{
+	if (!g_ThreadClassLoader)
+	{
+		return 0;
+	}
+	QJniLocalRef loader_class(env, env->GetObjectClass(g_ThreadClassLoader));
+	const jmethodID load_class = env->GetMethodID(
+		static_cast<jclass>(loader_class.jObject()),
+		"loadClass",
+		"(Ljava/lang/String;)Ljava/lang/Class;");
+	if (!load_class)
+	{
+		env->ExceptionClear();
+		return 0;
+	}
+	QJniLocalRef java_name(env, env->NewStringUTF(QByteArray(name).replace('/', '.').constData()));
+	const jobject result = env->CallObjectMethod(g_ThreadClassLoader, load_class, java_name.jObject());
+	if (env->ExceptionCheck())
+	{
+		env->ExceptionClear();
+		return 0;
+	}
+	return static_cast<jclass>(result);
+}
+
 #if defined(Q_OS_ANDROID)
 
 void AutoSetJavaVM()
@@ -328,6 +786,13 @@ QJniEnvPtr::QJniEnvPtr(JNIEnv * env)
 		int errsv = jvm->GetEnv(reinterpret_cast<void**>(&env_), JNI_VERSION_1_6);
 		if (errsv == JNI_EDETACHED)
 		{
+			if (!g_ImplicitAttachAllowed)
+			{
+				throw QJniThreadAttachException(
+					QString(QLatin1String("Implicit attach of thread %1 is not allowed"))
+						.arg(gettid())
+						.toLatin1());
+			}
 			VERBOSE(qWarning("Current thread %d is not attached, attaching it...", (int)gettid()));
 			errsv = jvm->AttachCurrentThread(&env_, 0);
 			if (errsv != 0)
@@ -496,6 +961,7 @@ void QJniEnvPtr::unloadAllClasses()
 		env_->DeleteGlobalRef(it.value());
 	}
 	g_PreloadedClasses.clear();
+	g_ClassMetadataCache.clear(env_);
 }
 
 
@@ -516,10 +982,14 @@ jclass QJniEnvPtr::findClass(const char * name)
 	// If it wasn't preloaded, try to load it in JNI (will fail for custom classes in native-created threads)
 	VERBOSE(qWarning("Trying to construct the class directly: \"%s\" in tid %d", name, (int)gettid()));
 	QJniLocalRef cls(env_, env_->FindClass(name)); // jclass
-	if (clearException())
+	if (clearException(!g_ThreadClassLoader))
 	{
-		qWarning("Failed to find class \"%s\"", name);
-		return 0;
+		cls = QJniLocalRef(env_, loadClassWithThreadClassLoader(env_, name));
+		if (!cls.jObject())
+		{
+			qWarning("Failed to find class \"%s\"", name);
+			return 0;
+		}
 	}
 
 	// We must store class ref in a global ref
@@ -556,6 +1026,97 @@ bool QJniEnvPtr::isCurrentThreadAttached()
 }
 
 
+void QJniEnvPtr::setImplicitAttachAllowed(bool allowed)
+{
+	g_ImplicitAttachAllowed = allowed;
+}
+
+
+bool QJniEnvPtr::isImplicitAttachAllowed()
+{
+	return g_ImplicitAttachAllowed;
+}
+
+
+bool QJniEnvPtr::attachCurrentThread(const char * thread_name)
+{
+	#if defined(Q_OS_ANDROID) || defined(ANDROID)
+		AutoSetJavaVM();
+	#endif
+	JavaVM * jvm = g_JavaVm;
+	if (!jvm)
+	{
+		qWarning("Cannot attach thread %d: Java VM pointer is not set.", static_cast<int>(gettid()));
+		return false;
+	}
+	JNIEnv * env = nullptr;
+	if (jvm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK)
+	{
+		return true;
+	}
+	JavaVMAttachArgs args;
+	args.version = JNI_VERSION_1_6;
+	args.name = const_cast<char *>(thread_name);
+	args.group = nullptr;
+	const int errsv = jvm->AttachCurrentThread(&env, &args);
+	if (errsv != JNI_OK || !env)
+	{
+		qWarning("Failed to attach thread %d: %d", static_cast<int>(gettid()), errsv);
+		return false;
+	}
+	VERBOSE(qWarning("Explicitly attached thread %d as \"%s\".", (int)gettid(), thread_name));
+	return true;
+}
+
+
+void QJniEnvPtr::detachCurrentThread()
+{
+	JavaVM * jvm = g_JavaVm;
+	if (!jvm)
+	{
+		return;
+	}
+	JNIEnv * env = nullptr;
+	if (jvm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK)
+	{
+		return;
+	}
+	setCurrentThreadClassLoader(nullptr);
+	if (g_JavaThreadDetacher.hasLocalData())
+	{
+		// The detacher detaches the thread in its destructor.
+		g_JavaThreadDetacher.setLocalData(nullptr);
+	}
+	else
+	{
+		const int errsv = jvm->DetachCurrentThread();
+		if (errsv != JNI_OK)
+		{
+			qWarning("Thread %d detach failed: %d", static_cast<int>(gettid()), errsv);
+		}
+	}
+}
+
+
+void QJniEnvPtr::setCurrentThreadClassLoader(jobject class_loader)
+{
+	if (!class_loader && !g_ThreadClassLoader)
+	{
+		return;
+	}
+	QJniEnvPtr jep;
+	if (g_ThreadClassLoader)
+	{
+		jep.env()->DeleteGlobalRef(g_ThreadClassLoader);
+		g_ThreadClassLoader = nullptr;
+	}
+	if (class_loader)
+	{
+		g_ThreadClassLoader = jep.env()->NewGlobalRef(class_loader);
+	}
+}
+
+
 void QJniEnvPtr::setJavaVM(JavaVM * vm)
 {
 	g_JavaVm = vm;
@@ -847,6 +1408,11 @@ bool QJniEnvPtr::clearException(bool describe /*= true*/)
 	{
 		if (describe)
 		{
+			if (g_CaptureExceptions)
+			{
+				captureException(env_);
+				return true;
+			}
 			env_->ExceptionDescribe();
 		}
 		env_->ExceptionClear();
@@ -859,6 +1425,80 @@ bool QJniEnvPtr::clearException(bool describe /*= true*/)
 }
 
 
+void QJniEnvPtr::setExceptionCaptureEnabled(bool enabled)
+{
+	g_CaptureExceptions = enabled;
+}
+
+
+bool QJniEnvPtr::isExceptionCaptureEnabled()
+{
+	return g_CaptureExceptions;
+}
+
+
+std::vector<QJniCapturedException> QJniEnvPtr::takeCapturedExceptions()
+{
+	struct Taken
+	{
+		jthrowable throwable;
+		int thread_id;
+		qint64 timestamp;
+	};
+	// Collect the refs under the lock and format them after releasing it,
+	// as formatting calls Java code.
+	std::vector<Taken> taken;
+	{
+		QMutexLocker locker(&g_CapturedExceptionsMutex);
+		for (auto it = g_CapturedExceptionRings.begin(); it != g_CapturedExceptionRings.end(); )
+		{
+			QJniCapturedExceptionRing * ring = *it;
+			for (int i = 0; i < ring->count; ++i)
+			{
+				const QJniCapturedExceptionRing::Item & item =
+					ring->items[(ring->first + i) % QJniCapturedExceptionRing::c_capacity];
+				taken.push_back({item.throwable, ring->thread_id, item.timestamp});
+			}
+			ring->first = 0;
+			ring->count = 0;
+			if (ring->thread_finished)
+			{
+				delete ring;
+				it = g_CapturedExceptionRings.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	std::vector<QJniCapturedException> result;
+	if (taken.empty())
+	{
+		return result;
+	}
+	result.reserve(taken.size());
+	QJniEnvPtr jep;
+	for (const Taken & t: taken)
+	{
+		QJniCapturedException e;
+		e.description = formatThrowable(jep, t.throwable);
+		e.thread_id = t.thread_id;
+		e.timestamp = t.timestamp;
+		jep.env()->DeleteGlobalRef(t.throwable);
+		result.push_back(std::move(e));
+	}
+	return result;
+}
+
+
+quint64 QJniEnvPtr::droppedCapturedExceptionsCount()
+{
+	return g_DroppedCapturedExceptions;
+}
+
+
 
 /////////////////////////////////////////////////////////////////////////////
 // QJniClass
@@ -943,6 +1583,7 @@ QJniClass::QJniClass(const QJniClass & other)
 	if (other)
 	{
 		initClass(QJniEnvPtr().env(), other.class_);
+		class_identity_.store(other.class_identity_.load(std::memory_order_relaxed), std::memory_order_relaxed);
 	}
 }
 
@@ -951,6 +1592,7 @@ QJniClass::QJniClass(QJniClass && other)
 {
 	class_ = other.class_;
 	other.class_ = 0;
+	class_identity_.store(other.class_identity_.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
 	construction_class_name_ = std::move(other.construction_class_name_);
 }
 
@@ -961,6 +1603,7 @@ QJniClass & QJniClass::operator=(const QJniClass & other)
 	{
 		construction_class_name_ = other.construction_class_name_;
 		initClass(QJniEnvPtr().env(), other.jClass());
+		class_identity_.store(other.class_identity_.load(std::memory_order_relaxed), std::memory_order_relaxed);
 	}
 	return *this;
 }
@@ -973,6 +1616,7 @@ QJniClass & QJniClass::operator=(QJniClass && other)
 		clearClass(QJniEnvPtr().env());
 		class_ = other.class_;
 		other.class_ = 0;
+		class_identity_.store(other.class_identity_.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
 		construction_class_name_ = std::move(other.construction_class_name_);
 	}
 	return *this;
@@ -1014,9 +1658,18 @@ bool QJniClass::classAvailable(const char * full_class_name)
 
 bool QJniClass::isCastableTo(const QJniClass & other) const
 {
-	return QJniEnvPtr().env()->IsAssignableFrom(
-		checkedClass("castableTo(clazz1)"),
-		other.checkedClass("castableTo(clazz2)"));
+	const jclass from = checkedClass("castableTo(clazz1)");
+	const jclass to = other.checkedClass("castableTo(clazz2)");
+	QJniEnvPtr jep;
+	bool result = false;
+	const jint from_identity = classIdentity(jep.env());
+	const jint to_identity = other.classIdentity(jep.env());
+	if (!g_ClassMetadataCache.findCastable(jep.env(), from, from_identity, to, to_identity, &result))
+	{
+		result = jep.env()->IsAssignableFrom(from, to);
+		g_ClassMetadataCache.storeCastable(jep.env(), from, from_identity, to, to_identity, result);
+	}
+	return result;
 }
 
 
@@ -1042,6 +1695,20 @@ void QJniClass::clearClass(JNIEnv * env)
 		env->DeleteGlobalRef(class_);
 		class_ = 0;
 	}
+	class_identity_.store(0, std::memory_order_relaxed);
+}
+
+
+jint QJniClass::classIdentity(JNIEnv * env) const
+{
+	// 0 means "not computed yet"; a class which really hashes to 0 is just looked up again.
+	jint identity = class_identity_.load(std::memory_order_relaxed);
+	if (!identity && class_)
+	{
+		identity = classIdentityHash(env, class_);
+		class_identity_.store(identity, std::memory_order_relaxed);
+	}
+	return identity;
 }
 
 
@@ -1793,11 +2460,20 @@ QString QJniClass::getClassName(bool simple) const
 	QString result;
 	if (jClass())
 	{
+		QJniEnvPtr jep;
+		const QJniClassMetadataCache::NameKind kind =
+			(simple) ? QJniClassMetadataCache::SimpleName : QJniClassMetadataCache::FullName;
+		const jint identity = classIdentity(jep.env());
+		QByteArray cached;
+		if (g_ClassMetadataCache.findName(jep.env(), jClass(), identity, kind, &cached))
+		{
+			return QString::fromUtf8(cached);
+		}
 		// Not recursing into QJniObject::QJniObject to avoid stack overflow in case we want to
 		// print class names from there. Otherwise we could simply do something like this:
 		// return QJniObject(QJniEnvPtr().env()->GetObjectClass(jClass()), true)
 		//     .callString("getSimpleName");
-		QJniEnvPtr jep;
+		bool succeeded = false;
 		if (jclass classClazz = jep.env()->GetObjectClass(jClass()))
 		{
 			if (jmethodID methodId = jep.env()->GetMethodID(
@@ -1810,11 +2486,19 @@ QString QJniClass::getClassName(bool simple) const
 				{
 					result = jep.toQString(className);
 					jep.env()->DeleteLocalRef(className);
+					succeeded = true;
 				}
 			}
 			jep.env()->DeleteLocalRef(classClazz);
 		}
-		jep.clearException();
+		if (jep.clearException())
+		{
+			succeeded = false;
+		}
+		if (succeeded)
+		{
+			g_ClassMetadataCache.storeName(jep.env(), jClass(), identity, kind, result.toUtf8());
+		}
 	}
 	return result;
 }
@@ -1822,16 +2506,26 @@ QString QJniClass::getClassName(bool simple) const
 
 QByteArray QJniClass::debugClassName() const
 {
+	// Both branches normally return an implicitly shared copy of an already existing
+	// QByteArray, so this is cheap enough to call when composing exceptions and logs.
 	if (!construction_class_name_.isEmpty())
 	{
 		return construction_class_name_;
 	}
-	const QString java_name = getClassName(false);
-	if (java_name.isEmpty())
+	if (!jClass())
 	{
-		return "<unknown>";
+		return QByteArrayLiteral("<unknown>");
 	}
-	return java_name.toLatin1();
+	QJniEnvPtr jep;
+	const jint identity = classIdentity(jep.env());
+	QByteArray result;
+	if (!g_ClassMetadataCache.findName(jep.env(), jClass(), identity, QJniClassMetadataCache::DebugName, &result))
+	{
+		const QString java_name = getClassName(false);
+		result = (java_name.isEmpty()) ? QByteArrayLiteral("<unknown>") : java_name.toLatin1();
+		g_ClassMetadataCache.storeName(jep.env(), jClass(), identity, QJniClassMetadataCache::DebugName, result);
+	}
+	return result;
 }
 
 
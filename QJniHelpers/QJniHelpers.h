@@ -35,6 +35,7 @@
 */
 
 #pragma once
+#include <atomic>
 #include <initializer_list>
 #include <string>
 #include <jni.h>
@@ -118,6 +119,18 @@ public:
 class QJniObject;
 
 
+// Java exception captured by QJniEnvPtr::clearException() in exception capture mode.
+struct QJniCapturedException
+{
+	// Throwable.toString() followed by the stack trace, as printed by Throwable.printStackTrace().
+	QString description;
+	// Id of the thread which has cleared the exception.
+	int thread_id = 0;
+	// Capture time, milliseconds since epoch.
+	qint64 timestamp = 0;
+};
+
+
 // Basic functionality to get JNIEnv valid for current thread and scope.
 // Using this object across threads is UB.
 class QJniEnvPtr
@@ -144,6 +157,28 @@ public:
 	// Check if current thread looks properly attached to JNI.
 	static bool isCurrentThreadAttached();
 
+	// Policy for threads which are not attached to JNI. By default, QJniEnvPtr constructor
+	// attaches such threads implicitly. When it is not allowed, the constructor throws
+	// QJniThreadAttachException instead, so any JNI use from unexpected threads shows up
+	// immediately. Threads can still be attached with attachCurrentThread().
+	static void setImplicitAttachAllowed(bool allowed);
+	static bool isImplicitAttachAllowed();
+
+	// Explicitly attach current thread using the given Java thread name (can be nullptr).
+	// The thread is not detached automatically, call detachCurrentThread() before it finishes.
+	// Returns true if the thread is attached (or has already been attached).
+	static bool attachCurrentThread(const char * thread_name);
+
+	// Detach current thread, attached either explicitly or implicitly.
+	// Also resets current thread class loader.
+	static void detachCurrentThread();
+
+	// Set java.lang.ClassLoader used by findClass() in current thread for classes which
+	// are not preloaded and not found by FindClass() (in threads created in native code it only
+	// sees system classes). Pass nullptr to reset. The loader must be reset before the thread
+	// finishes, otherwise its global ref leaks.
+	static void setCurrentThreadClassLoader(jobject class_loader);
+
 	// Preload a class by its name, e.g.: "ru/dublgis/offscreenview/OffscreenWebView".
 	// Required as Android's JNIEnv->FindClass doesn't work in threads created in native code.
 	// After preloading, any thread can instantiate class via QJniEnvPtr::findClass().
@@ -189,9 +224,26 @@ public:
 	// Clears Java exception without taking any specific actions.
 	// If describe == true it will call ExceptionDescribe() to print the exception
 	// description into stderr.
+	// In exception capture mode (see setExceptionCaptureEnabled()) describe == true captures
+	// the exception instead of printing it.
 	// Returns false if there was no exception.
 	bool clearException(bool describe = true);
 
+	// Exception capture mode. When enabled, clearException(true) doesn't call ExceptionDescribe(),
+	// which formats and prints the stack trace synchronously on the current thread, but stores
+	// a global ref to the Throwable in a bounded per-thread ring. The Throwables are formatted
+	// only by takeCapturedExceptions(). Disabled by default.
+	static void setExceptionCaptureEnabled(bool enabled);
+	static bool isExceptionCaptureEnabled();
+
+	// Format and return exceptions captured in all threads (in order of capture for each thread)
+	// and release the Java references. Call it from a non-critical thread, e.g. when preparing
+	// data for a crash report.
+	static std::vector<QJniCapturedException> takeCapturedExceptions();
+
+	// Number of captured exceptions which have been dropped because of the ring size limits.
+	static quint64 droppedCapturedExceptionsCount();
+
 #if !defined(QTANDROIDEXTENSIONS_NO_DEPRECATES)
 	[[deprecated("Use toJString()")]] jstring JStringFromQString(const QString & qstring)
 	{ return toJString(qstring); }
@@ -244,7 +296,7 @@ public:
 	static bool classAvailable(const char * full_class_name);
 
 	// True if: 'other' is the same class, OR 'this' is a subclass of 'other',
-	// OR 'other' is one of 'this's interfaces.
+	// OR 'other' is one of 'this's interfaces. The result is cached per pair of classes.
 	bool isCastableTo(const QJniClass & other) const;
 
 	void callStaticVoid(const char * method_name);
@@ -294,10 +346,13 @@ public:
 
 	// Retrieve class name (via JNI). If 'simple' is true then only the class name is returned
 	// (e.g.: "String"), if it's false then full name with class path (e.g.: "java/lang/String").
+	// The names are cached per class, so only the first call for a class goes to Java.
 	QString getClassName(bool simple = false) const;
 
 	const QByteArray & constructionClassName() const { return construction_class_name_; }
 
+	// Class name for exception messages and logs. Does not allocate after the first call
+	// for a class: returns a shared copy of the construction name or of a cached name.
 	QByteArray debugClassName() const;
 
 #if !defined(QTANDROIDEXTENSIONS_NO_DEPRECATES)
@@ -321,9 +376,12 @@ protected:
 	void initClass(JNIEnv * env, jclass clazz);
 	void clearClass(JNIEnv * env);
 	inline jclass checkedClass(const char * call_point_info) const;
+	// System.identityHashCode() of the class, computed once: the key of the metadata cache.
+	jint classIdentity(JNIEnv * env) const;
 
 private:
 	jclass class_ = 0;
+	mutable std::atomic<jint> class_identity_{0};
 	QByteArray construction_class_name_;
 };
 
@@ -6,6 +6,8 @@ android-g++ {
     HEADERS += \
         $$PWD/QJniHelpers.h \
         $$PWD/QJniLangUtils.h \
+        $$PWD/QJniRingBuffer.h \
+        $$PWD/QJniThreadPool.h \
         $$PWD/QAndroidQPAPluginGap.h \
         $$PWD/IJniObjectLinker.h \
         $$PWD/TJniObjectLinker.h \
@@ -13,5 +15,7 @@ android-g++ {
     SOURCES += \
         $$PWD/QJniHelpers.cpp \
         $$PWD/QJniLangUtils.cpp \
+        $$PWD/QJniRingBuffer.cpp \
+        $$PWD/QJniThreadPool.cpp \
         $$PWD/QAndroidQPAPluginGap.cpp \
 }
@@ -0,0 +1,394 @@
+/*
+  QJniHelpers library
+
+  Authors:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+	may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <QtCore/QDebug>
+#include "QAndroidQPAPluginGap.h"
+#include "QJniRingBuffer.h"
+
+namespace QJniHelpers {
+
+static const char * const c_ring_buffer_class_name = "ru/dublgis/qjnihelpers/RingBuffer";
+
+//! Memory and wakeup fd of a ring, shared by QJniRingBuffer and its Java endpoints.
+struct QJniRingBufferShared
+{
+	std::atomic<int> refs{1};
+	char * memory = nullptr;
+	int event_fd = -1;
+
+	std::atomic<uint32_t> & field(int offset) const
+	{
+		return *reinterpret_cast<std::atomic<uint32_t> *>(memory + offset);
+	}
+};
+
+static void wakeEventFd(int fd)
+{
+	if (fd >= 0)
+	{
+		const uint64_t one = 1;
+		ssize_t written = 0;
+		do
+		{
+			written = ::write(fd, &one, sizeof(one));
+		}
+		while (written < 0 && errno == EINTR);
+	}
+}
+
+static int roundUpToPowerOf2(int x)
+{
+	int p = 1;
+	while (p < x)
+	{
+		p <<= 1;
+	}
+	return p;
+}
+
+
+QJniRingBuffer::QJniRingBuffer(int record_size, int capacity)
+	: record_size_(qMax(1, record_size))
+	, capacity_(roundUpToPowerOf2(qMax(1, capacity)))
+{
+	size_ = static_cast<size_t>(c_data_offset) + static_cast<size_t>(record_size_) * static_cast<size_t>(capacity_);
+	void * memory = nullptr;
+	if (posix_memalign(&memory, 64, size_) != 0)
+	{
+		qCritical() << "QJniRingBuffer: failed to allocate" << size_ << "bytes";
+		return;
+	}
+	memset(memory, 0, size_);
+	memory_ = static_cast<char *>(memory);
+	shared_ = new QJniRingBufferShared();
+	shared_->memory = memory_;
+	field(0).store(static_cast<uint32_t>(c_magic), std::memory_order_relaxed);
+	field(4).store(static_cast<uint32_t>(record_size_), std::memory_order_relaxed);
+	field(8).store(static_cast<uint32_t>(capacity_), std::memory_order_relaxed);
+	field(12).store(static_cast<uint32_t>(c_data_offset), std::memory_order_relaxed);
+	armed().store(1, std::memory_order_release);
+
+	event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (event_fd_ < 0)
+	{
+		qWarning() << "QJniRingBuffer: eventfd failed, errno:" << errno;
+	}
+	shared_->event_fd = event_fd_;
+}
+
+
+QJniRingBuffer::~QJniRingBuffer()
+{
+	if (shared_)
+	{
+		sharedRelease(shared_);
+	}
+}
+
+
+void QJniRingBuffer::preloadJavaClasses()
+{
+	QAndroidQPAPluginGap::preloadJavaClass(c_ring_buffer_class_name);
+}
+
+
+QJniObject QJniRingBuffer::createJavaEndpoint()
+{
+	if (!isValid())
+	{
+		return QJniObject();
+	}
+	try
+	{
+		QJniEnvPtr jep;
+		QJniLocalRef buffer(jep, jep.env()->NewDirectByteBuffer(memory_, static_cast<jlong>(size_)));
+		if (jep.clearException() || !buffer.jObject())
+		{
+			qCritical() << "QJniRingBuffer: failed to create direct buffer";
+			return QJniObject();
+		}
+		// The reference is passed to the Java object, which releases it in close().
+		// If creating the object fails the reference is leaked: the Java object may have
+		// been constructed, and freeing the memory under it would be worse than a leak.
+		shared_->refs.fetch_add(1, std::memory_order_relaxed);
+		return QJniObject(
+			c_ring_buffer_class_name,
+			"Ljava/nio/ByteBuffer;J",
+			buffer.jObject(),
+			static_cast<jlong>(reinterpret_cast<intptr_t>(shared_)));
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+	return QJniObject();
+}
+
+
+int QJniRingBuffer::available() const
+{
+	if (!isValid())
+	{
+		return 0;
+	}
+	return static_cast<int>(
+		writeIndex().load(std::memory_order_acquire) - readIndex().load(std::memory_order_relaxed));
+}
+
+
+bool QJniRingBuffer::read(void * record)
+{
+	if (available() == 0)
+	{
+		return false;
+	}
+	const uint32_t read = readIndex().load(std::memory_order_relaxed);
+	memcpy(record, recordAt(read), static_cast<size_t>(record_size_));
+	readIndex().store(read + 1, std::memory_order_release);
+	return true;
+}
+
+
+bool QJniRingBuffer::waitForData(int timeout_ms)
+{
+	if (available() > 0)
+	{
+		return true;
+	}
+	if (event_fd_ < 0)
+	{
+		return false;
+	}
+	arm();
+	if (available() > 0)
+	{
+		return true;
+	}
+	pollfd pfd;
+	pfd.fd = event_fd_;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	int result = 0;
+	do
+	{
+		result = poll(&pfd, 1, timeout_ms);
+	}
+	while (result < 0 && errno == EINTR);
+	clearWakeup();
+	return available() > 0;
+}
+
+
+int QJniRingBuffer::droppedCount() const
+{
+	return isValid() ? static_cast<int>(field(68).load(std::memory_order_relaxed)) : 0;
+}
+
+
+bool QJniRingBuffer::write(const void * record)
+{
+	if (!isValid())
+	{
+		return false;
+	}
+	const uint32_t write = writeIndex().load(std::memory_order_relaxed);
+	if (write - readIndex().load(std::memory_order_acquire) >= static_cast<uint32_t>(capacity_))
+	{
+		field(68).fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	memcpy(recordAt(write), record, static_cast<size_t>(record_size_));
+	writeIndex().store(write + 1, std::memory_order_seq_cst);
+	if (armed().load(std::memory_order_seq_cst))
+	{
+		armed().store(0, std::memory_order_relaxed);
+		wake();
+	}
+	return true;
+}
+
+
+void QJniRingBuffer::wake()
+{
+	wakeEventFd(event_fd_);
+}
+
+
+void QJniRingBuffer::sharedWake(QJniRingBufferShared * shared)
+{
+	wakeEventFd(shared->event_fd);
+}
+
+
+void QJniRingBuffer::sharedPublish(QJniRingBufferShared * shared, uint32_t write_index)
+{
+	// Same as the end of write().
+	shared->field(64).store(write_index, std::memory_order_seq_cst);
+	if (shared->field(132).load(std::memory_order_seq_cst))
+	{
+		shared->field(132).store(0, std::memory_order_relaxed);
+		wakeEventFd(shared->event_fd);
+	}
+}
+
+
+uint32_t QJniRingBuffer::sharedReadIndex(QJniRingBufferShared * shared)
+{
+	return shared->field(128).load(std::memory_order_acquire);
+}
+
+
+void QJniRingBuffer::sharedSetDropped(QJniRingBufferShared * shared, uint32_t dropped)
+{
+	shared->field(68).store(dropped, std::memory_order_relaxed);
+}
+
+
+void QJniRingBuffer::sharedRelease(QJniRingBufferShared * shared)
+{
+	if (shared->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		if (shared->event_fd >= 0)
+		{
+			close(shared->event_fd);
+		}
+		free(shared->memory);
+		delete shared;
+	}
+}
+
+
+void QJniRingBuffer::arm()
+{
+	armed().store(1, std::memory_order_seq_cst);
+}
+
+
+void QJniRingBuffer::clearWakeup()
+{
+	if (event_fd_ >= 0)
+	{
+		uint64_t counter = 0;
+		ssize_t result = 0;
+		do
+		{
+			result = ::read(event_fd_, &counter, sizeof(counter));
+		}
+		while (result < 0 && errno == EINTR);
+	}
+}
+
+
+std::atomic<uint32_t> & QJniRingBuffer::field(int offset) const
+{
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Unexpected std::atomic size");
+	return *reinterpret_cast<std::atomic<uint32_t> *>(memory_ + offset);
+}
+
+
+char * QJniRingBuffer::recordAt(uint32_t index) const
+{
+	return memory_ + c_data_offset
+		+ static_cast<size_t>(index & static_cast<uint32_t>(capacity_ - 1)) * static_cast<size_t>(record_size_);
+}
+
+
+} // namespace QJniHelpers
+
+
+extern "C" {
+
+using QJniHelpers::QJniRingBuffer;
+using QJniHelpers::QJniRingBufferShared;
+
+static inline QJniRingBufferShared * ringBufferShared(jlong shared_ptr)
+{
+	return reinterpret_cast<QJniRingBufferShared *>(static_cast<intptr_t>(shared_ptr));
+}
+
+JNIEXPORT void JNICALL Java_ru_dublgis_qjnihelpers_RingBuffer_nativeWake(JNIEnv *, jclass, jlong shared_ptr) noexcept;
+JNIEXPORT void JNICALL Java_ru_dublgis_qjnihelpers_RingBuffer_nativePublish(JNIEnv *, jclass, jlong shared_ptr, jint write_index) noexcept;
+JNIEXPORT jint JNICALL Java_ru_dublgis_qjnihelpers_RingBuffer_nativeReadIndex(JNIEnv *, jclass, jlong shared_ptr) noexcept;
+JNIEXPORT void JNICALL Java_ru_dublgis_qjnihelpers_RingBuffer_nativeSetDropped(JNIEnv *, jclass, jlong shared_ptr, jint dropped) noexcept;
+JNIEXPORT void JNICALL Java_ru_dublgis_qjnihelpers_RingBuffer_nativeRelease(JNIEnv *, jclass, jlong shared_ptr) noexcept;
+
+//! Called by RingBuffer.java after publishing records into an armed buffer.
+JNIEXPORT void JNICALL Java_ru_dublgis_qjnihelpers_RingBuffer_nativeWake(JNIEnv *, jclass, jlong shared_ptr) noexcept
+{
+	if (shared_ptr)
+	{
+		QJniRingBuffer::sharedWake(ringBufferShared(shared_ptr));
+	}
+}
+
+//! Called by RingBuffer.java to publish a record on Android versions without VarHandle.
+JNIEXPORT void JNICALL Java_ru_dublgis_qjnihelpers_RingBuffer_nativePublish(JNIEnv *, jclass, jlong shared_ptr, jint write_index) noexcept
+{
+	if (shared_ptr)
+	{
+		QJniRingBuffer::sharedPublish(ringBufferShared(shared_ptr), static_cast<uint32_t>(write_index));
+	}
+}
+
+JNIEXPORT jint JNICALL Java_ru_dublgis_qjnihelpers_RingBuffer_nativeReadIndex(JNIEnv *, jclass, jlong shared_ptr) noexcept
+{
+	return (shared_ptr)? static_cast<jint>(QJniRingBuffer::sharedReadIndex(ringBufferShared(shared_ptr))): 0;
+}
+
+JNIEXPORT void JNICALL Java_ru_dublgis_qjnihelpers_RingBuffer_nativeSetDropped(JNIEnv *, jclass, jlong shared_ptr, jint dropped) noexcept
+{
+	if (shared_ptr)
+	{
+		QJniRingBuffer::sharedSetDropped(ringBufferShared(shared_ptr), static_cast<uint32_t>(dropped));
+	}
+}
+
+//! Called by RingBuffer.close() to drop the reference of the Java endpoint.
+JNIEXPORT void JNICALL Java_ru_dublgis_qjnihelpers_RingBuffer_nativeRelease(JNIEnv *, jclass, jlong shared_ptr) noexcept
+{
+	if (shared_ptr)
+	{
+		QJniRingBuffer::sharedRelease(ringBufferShared(shared_ptr));
+	}
+}
+
+} // extern "C"
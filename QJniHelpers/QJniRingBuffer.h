@@ -0,0 +1,191 @@
+/*
+  QJniHelpers library
+
+  Authors:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+	may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include "QJniHelpers.h"
+
+namespace QJniHelpers {
+
+struct QJniRingBufferShared;
+
+/*!
+ * Single-producer / single-consumer ring buffer of fixed-size records placed in memory
+ * shared with Java via a direct ByteBuffer. It allows passing high-rate event streams
+ * (sensor samples, NMEA sentences, touch events...) from Java to C++ without an array
+ * allocation per event. On Android 13+ the Java producer publishes records without JNI calls
+ * (except for wakeups); on older versions each published record still costs one JNI call.
+ *
+ * The producer is normally Java (see createJavaEndpoint() and ru.dublgis.qjnihelpers.RingBuffer),
+ * but records can also be written from C++ with write(). The consumer is C++.
+ *
+ * Wakeup: the consumer arms the buffer when it has drained it (see consume()), and the producer
+ * signals wakeupFd() (an eventfd) only when publishing into an armed buffer. Use wakeupFd() with
+ * QSocketNotifier to drain the buffer from an event loop, or waitForData() in a plain thread.
+ *
+ * The memory is reference-counted and shared with the Java endpoints, so they can outlive
+ * the ring: records written after its destruction are simply lost.
+ *
+ * Memory layout (native byte order, must match RingBuffer.java):
+ *  0: magic, 4: record size, 8: capacity (power of 2), 12: offset of the first record,
+ *  64: write index, 68: count of records dropped by producer because the buffer was full,
+ *  128: read index, 132: "armed" flag, c_data_offset: records.
+ */
+class QJniRingBuffer
+{
+public:
+	static const int32_t c_magic = 0x42524A51; // "QJRB"
+	static const int c_data_offset = 192;
+
+	// Capacity is rounded up to a power of 2.
+	QJniRingBuffer(int record_size, int capacity);
+	~QJniRingBuffer();
+
+	QJniRingBuffer(const QJniRingBuffer &) = delete;
+	QJniRingBuffer & operator=(const QJniRingBuffer &) = delete;
+
+	//! Call from main thread so the Java class can be found from any thread.
+	static void preloadJavaClasses();
+
+	bool isValid() const { return memory_ != nullptr; }
+	int recordSize() const { return record_size_; }
+	int capacity() const { return capacity_; }
+
+	//! Create ru.dublgis.qjnihelpers.RingBuffer object working as the producer.
+	QJniObject createJavaEndpoint();
+
+	//! File descriptor which becomes readable when the consumer should drain the buffer.
+	int wakeupFd() const { return event_fd_; }
+
+	//
+	// Consumer functions
+	//
+
+	//! Number of records available for reading.
+	int available() const;
+
+	//! Copy the oldest record into 'record' (recordSize() bytes). Returns false if empty.
+	bool read(void * record);
+
+	/*!
+	 * Call f(const char * record) for each available record, then clear the wakeup fd
+	 * and arm the buffer for the next wakeup. Returns number of processed records.
+	 */
+	template<class F> int consume(F && f)
+	{
+		if (!isValid())
+		{
+			return 0;
+		}
+		int processed = 0;
+		for (;;)
+		{
+			processed += consumeAvailable(f);
+			clearWakeup();
+			arm();
+			// Anything published before the producer could see the flag
+			// won't generate a wakeup, so check again.
+			if (available() == 0)
+			{
+				break;
+			}
+		}
+		return processed;
+	}
+
+	//! Block until there is something to read or timeout expires (-1 for infinite).
+	bool waitForData(int timeout_ms);
+
+	//! Records dropped by the producer because the buffer was full.
+	int droppedCount() const;
+
+	//
+	// Producer function, for C++ producers
+	//
+
+	//! Publish one record. Returns false if the buffer is full.
+	bool write(const void * record);
+
+	//! Called by the producer after publishing when the buffer has been armed.
+	void wake();
+
+	//
+	// Access to the shared memory of a Java endpoint, which may outlive the ring.
+	//
+	static void sharedWake(QJniRingBufferShared * shared);
+	static void sharedPublish(QJniRingBufferShared * shared, uint32_t write_index);
+	static uint32_t sharedReadIndex(QJniRingBufferShared * shared);
+	static void sharedSetDropped(QJniRingBufferShared * shared, uint32_t dropped);
+	static void sharedRelease(QJniRingBufferShared * shared);
+
+private:
+	template<class F> int consumeAvailable(F & f)
+	{
+		if (!isValid())
+		{
+			return 0;
+		}
+		const uint32_t write = writeIndex().load(std::memory_order_acquire);
+		uint32_t read = readIndex().load(std::memory_order_relaxed);
+		int processed = 0;
+		for (; read != write; ++read, ++processed)
+		{
+			f(recordAt(read));
+			readIndex().store(read + 1, std::memory_order_release);
+		}
+		return processed;
+	}
+
+	void arm();
+	void clearWakeup();
+	std::atomic<uint32_t> & field(int offset) const;
+	std::atomic<uint32_t> & writeIndex() const { return field(64); }
+	std::atomic<uint32_t> & readIndex() const { return field(128); }
+	std::atomic<uint32_t> & armed() const { return field(132); }
+	char * recordAt(uint32_t index) const;
+
+private:
+	int record_size_ = 0;
+	int capacity_ = 0;
+	size_t size_ = 0;
+	//! Owner of memory_ and event_fd_, one reference is held by the ring.
+	QJniRingBufferShared * shared_ = nullptr;
+	char * memory_ = nullptr;
+	int event_fd_ = -1;
+};
+
+} // namespace QJniHelpers
@@ -0,0 +1,165 @@
+/*
+  QJniHelpers library
+
+  Authors:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+	may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <pthread.h>
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+#include "QAndroidQPAPluginGap.h"
+#include "QJniThreadPool.h"
+
+namespace QJniHelpers {
+
+
+QJniThreadPool::QJniThreadPool(int thread_count, const QByteArray & name_prefix)
+	: name_prefix_(name_prefix)
+{
+	try
+	{
+		QJniEnvPtr jep;
+		QJniObject context(QAndroidQPAPluginGap::getCurrentContextNoThrow(jep.env()), true);
+		if (context)
+		{
+			class_loader_ = context.callObj("getClassLoader", "java/lang/ClassLoader");
+		}
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+	if (!class_loader_)
+	{
+		qWarning() << "QJniThreadPool" << name_prefix_ << "will run without application class loader.";
+	}
+	const int count = qMax(1, thread_count);
+	threads_.reserve(static_cast<size_t>(count));
+	for (int i = 0; i < count; ++i)
+	{
+		threads_.emplace_back(&QJniThreadPool::workerMain, this, i);
+	}
+}
+
+
+QJniThreadPool::~QJniThreadPool()
+{
+	{
+		QMutexLocker locker(&mutex_);
+		finishing_ = true;
+		has_tasks_.wakeAll();
+	}
+	for (std::thread & thread: threads_)
+	{
+		thread.join();
+	}
+}
+
+
+void QJniThreadPool::post(Task && task)
+{
+	QMutexLocker locker(&mutex_);
+	if (finishing_)
+	{
+		qWarning() << "QJniThreadPool" << name_prefix_ << "is finishing, the task is dropped.";
+		return;
+	}
+	tasks_.push_back(std::move(task));
+	has_tasks_.wakeOne();
+}
+
+
+int QJniThreadPool::pendingTaskCount() const
+{
+	QMutexLocker locker(&mutex_);
+	return static_cast<int>(tasks_.size());
+}
+
+
+void QJniThreadPool::workerMain(int index)
+{
+	const QByteArray name = name_prefix_ + '-' + QByteArray::number(index);
+	// Linux limits thread names to 15 characters.
+	pthread_setname_np(pthread_self(), name.left(15).constData());
+
+	const bool attached = QJniEnvPtr::attachCurrentThread(name.constData());
+	if (attached && class_loader_)
+	{
+		try
+		{
+			QJniEnvPtr::setCurrentThreadClassLoader(class_loader_.jObject());
+		}
+		catch (const std::exception & e)
+		{
+			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+		}
+	}
+
+	for (;;)
+	{
+		Task task;
+		{
+			QMutexLocker locker(&mutex_);
+			while (tasks_.empty() && !finishing_)
+			{
+				has_tasks_.wait(&mutex_);
+			}
+			if (tasks_.empty())
+			{
+				break;
+			}
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+		}
+		try
+		{
+			task();
+		}
+		catch (const std::exception & e)
+		{
+			qCritical() << "Exception in QJniThreadPool task:" << e.what();
+		}
+		catch (...)
+		{
+			qCritical() << "Unknown exception in QJniThreadPool task";
+		}
+	}
+
+	if (attached)
+	{
+		QJniEnvPtr::detachCurrentThread();
+	}
+}
+
+
+} // namespace QJniHelpers
@@ -0,0 +1,91 @@
+/*
+  QJniHelpers library
+
+  Authors:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+	may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include "QJniHelpers.h"
+
+namespace QJniHelpers {
+
+// A pool of native worker threads for running short tasks which use JNI.
+// Each worker is attached to Java once when it starts, gets a readable thread name
+// ("<name_prefix>-<N>"), and is detached when the pool is destroyed, so the tasks
+// don't pay for attaching / detaching every time like with QtConcurrent or std::async.
+// Workers use class loader of the current Context (captured in the constructor),
+// so QJniEnvPtr::findClass() finds application classes there even if they were not preloaded.
+class QJniThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+	// Starts thread_count workers. Should be called when JavaVM and Context are already available.
+	explicit QJniThreadPool(int thread_count = 2, const QByteArray & name_prefix = "QJniPool");
+
+	// Executes all already queued tasks and joins the workers.
+	~QJniThreadPool();
+
+	QJniThreadPool(const QJniThreadPool &) = delete;
+	QJniThreadPool & operator=(const QJniThreadPool &) = delete;
+
+	// Queue the task for execution in any of the workers.
+	// Exceptions thrown by the task are logged and don't affect the pool.
+	void post(Task && task);
+
+	int threadCount() const { return static_cast<int>(threads_.size()); }
+	int pendingTaskCount() const;
+
+private:
+	void workerMain(int index);
+
+private:
+	const QByteArray name_prefix_;
+	QJniObject class_loader_;
+	mutable QMutex mutex_;
+	QWaitCondition has_tasks_;
+	// Guarded by mutex_
+	std::deque<Task> tasks_;
+	bool finishing_ = false;
+	std::vector<std::thread> threads_;
+};
+
+} // namespace QJniHelpers
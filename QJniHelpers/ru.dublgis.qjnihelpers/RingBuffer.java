@@ -0,0 +1,241 @@
+/*
+  QJniHelpers library
+
+  Authors:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+package ru.dublgis.qjnihelpers;
+
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import android.os.Build;
+
+
+/*!
+ * Java (producer) endpoint of QJniRingBuffer: a single-producer / single-consumer
+ * ring of fixed-size records in memory shared with C++. Created from C++ by
+ * QJniRingBuffer::createJavaEndpoint(). Must be used from one producer thread at a time.
+ *
+ * The endpoint keeps the shared memory alive, so it stays safe to use after the C++ ring
+ * has been destroyed (the records just go nowhere). Call close() from the producer thread
+ * when done to release the memory without waiting for the garbage collector.
+ *
+ * Usage:
+ *     int offset = ring.beginWrite();
+ *     if (offset >= 0) {
+ *         ring.buffer().putFloat(offset, x);
+ *         ring.buffer().putFloat(offset + 4, y);
+ *         ring.endWrite();
+ *     }
+ */
+public class RingBuffer
+{
+    // Must match QJniRingBuffer.h
+    private static final int MAGIC = 0x42524A51;
+    private static final int OFFSET_MAGIC = 0;
+    private static final int OFFSET_RECORD_SIZE = 4;
+    private static final int OFFSET_CAPACITY = 8;
+    private static final int OFFSET_DATA = 12;
+    private static final int OFFSET_WRITE_INDEX = 64;
+    private static final int OFFSET_DROPPED = 68;
+    private static final int OFFSET_READ_INDEX = 128;
+    private static final int OFFSET_ARMED = 132;
+
+    // Java memory model gives no ordering guarantees for plain ByteBuffer accesses, so
+    // the indices are accessed with VarHandle atomics where available (Android 13+).
+    // Otherwise they are accessed via C++, which does the atomic operations.
+    private static final boolean USE_VAR_HANDLES = Build.VERSION.SDK_INT >= 33;
+
+    // Loaded only if USE_VAR_HANDLES.
+    private static final class SharedInts
+    {
+        private static final VarHandle INT =
+            MethodHandles.byteBufferViewVarHandle(int[].class, ByteOrder.nativeOrder());
+
+        static int getAcquire(final ByteBuffer buffer, final int offset) { return (int)INT.getAcquire(buffer, offset); }
+        static int getVolatile(final ByteBuffer buffer, final int offset) { return (int)INT.getVolatile(buffer, offset); }
+        static void setVolatile(final ByteBuffer buffer, final int offset, final int value) { INT.setVolatile(buffer, offset, value); }
+        static void setOpaque(final ByteBuffer buffer, final int offset, final int value) { INT.setOpaque(buffer, offset, value); }
+    }
+
+    private final ByteBuffer buffer_;
+    private final int record_size_;
+    private final int capacity_;
+    private final int data_offset_;
+    // Reference to the shared memory, 0 when closed.
+    private long shared_ptr_;
+    private int write_index_ = 0;
+    // Last read index seen; the real one is reloaded only when the ring looks full.
+    private int read_index_ = 0;
+    private int dropped_ = 0;
+
+    public RingBuffer(final ByteBuffer buffer, final long shared_ptr)
+    {
+        buffer_ = buffer;
+        buffer_.order(ByteOrder.nativeOrder());
+        if (buffer_.getInt(OFFSET_MAGIC) != MAGIC)
+        {
+            throw new IllegalArgumentException("RingBuffer: invalid shared memory header");
+        }
+        record_size_ = buffer_.getInt(OFFSET_RECORD_SIZE);
+        capacity_ = buffer_.getInt(OFFSET_CAPACITY);
+        data_offset_ = buffer_.getInt(OFFSET_DATA);
+        write_index_ = buffer_.getInt(OFFSET_WRITE_INDEX);
+        // Owned from here on, so finalize() of a failed object doesn't release it.
+        shared_ptr_ = shared_ptr;
+        read_index_ = loadReadIndex();
+    }
+
+    public ByteBuffer buffer()
+    {
+        return buffer_;
+    }
+
+    public int recordSize()
+    {
+        return record_size_;
+    }
+
+    public int capacity()
+    {
+        return capacity_;
+    }
+
+    //! Returns absolute offset in buffer() to write the next record to, or -1 if the ring is full
+    //! (the record is counted as dropped then) or closed.
+    public int beginWrite()
+    {
+        if (shared_ptr_ == 0)
+        {
+            return -1;
+        }
+        if (write_index_ - read_index_ >= capacity_)
+        {
+            // Acquire: don't overwrite the slot before the consumer has finished reading it.
+            read_index_ = loadReadIndex();
+            if (write_index_ - read_index_ >= capacity_)
+            {
+                ++dropped_;
+                if (USE_VAR_HANDLES)
+                {
+                    SharedInts.setOpaque(buffer_, OFFSET_DROPPED, dropped_);
+                }
+                else
+                {
+                    nativeSetDropped(shared_ptr_, dropped_);
+                }
+                return -1;
+            }
+        }
+        return data_offset_ + (write_index_ & (capacity_ - 1)) * record_size_;
+    }
+
+    //! Publishes the record started by beginWrite() and wakes the consumer if it waits for data.
+    public void endWrite()
+    {
+        if (shared_ptr_ == 0)
+        {
+            return;
+        }
+        ++write_index_;
+        if (USE_VAR_HANDLES)
+        {
+            // Sequentially consistent: the record must be visible before the index, and
+            // the index must be published before checking the flag.
+            SharedInts.setVolatile(buffer_, OFFSET_WRITE_INDEX, write_index_);
+            if (SharedInts.getVolatile(buffer_, OFFSET_ARMED) != 0)
+            {
+                SharedInts.setVolatile(buffer_, OFFSET_ARMED, 0);
+                nativeWake(shared_ptr_);
+            }
+        }
+        else
+        {
+            nativePublish(shared_ptr_, write_index_);
+        }
+    }
+
+    //! Convenience function to write a record of floats (the rest of the record is not touched).
+    public boolean write(final float[] values)
+    {
+        final int offset = beginWrite();
+        if (offset < 0)
+        {
+            return false;
+        }
+        final int count = Math.min(values.length, record_size_ / 4);
+        for (int i = 0; i < count; ++i)
+        {
+            buffer_.putFloat(offset + i * 4, values[i]);
+        }
+        endWrite();
+        return true;
+    }
+
+    //! Release the shared memory. buffer() must not be used after this.
+    public synchronized void close()
+    {
+        if (shared_ptr_ != 0)
+        {
+            final long ptr = shared_ptr_;
+            shared_ptr_ = 0;
+            nativeRelease(ptr);
+        }
+    }
+
+    @Override
+    protected void finalize() throws Throwable
+    {
+        try
+        {
+            close();
+        }
+        finally
+        {
+            super.finalize();
+        }
+    }
+
+    private int loadReadIndex()
+    {
+        return (USE_VAR_HANDLES)? SharedInts.getAcquire(buffer_, OFFSET_READ_INDEX): nativeReadIndex(shared_ptr_);
+    }
+
+    private static native void nativeWake(long shared_ptr);
+    private static native void nativePublish(long shared_ptr, int write_index);
+    private static native int nativeReadIndex(long shared_ptr);
+    private static native void nativeSetDropped(long shared_ptr, int dropped);
+    private static native void nativeRelease(long shared_ptr);
+}
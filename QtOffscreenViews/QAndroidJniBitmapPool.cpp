@@ -0,0 +1,201 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "QAndroidJniBitmapPool.h"
+#include <iterator>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+
+
+using namespace QJniHelpers;
+
+
+namespace {
+
+// Enough for a few full-screen 32-bit bitmaps on typical devices.
+const qint64 c_default_memory_budget = 32 * 1024 * 1024;
+
+} // anonymous namespace
+
+
+QAndroidJniBitmapPool & QAndroidJniBitmapPool::instance()
+{
+	static QAndroidJniBitmapPool pool;
+	// The pool outlives the application object, so its global references
+	// have to be dropped while JNI is still usable. A zero budget also
+	// stops bitmaps of views destroyed after that from being pooled again.
+	static const bool quit_handler_connected = []() {
+		QCoreApplication * app = QCoreApplication::instance();
+		if (!app)
+		{
+			qWarning() << "QAndroidJniBitmapPool is used before QCoreApplication is created.";
+			return false;
+		}
+		QObject::connect(app, &QCoreApplication::aboutToQuit, app, []() {
+			instance().setMemoryBudget(0);
+		});
+		return true;
+	}();
+	Q_UNUSED(quit_handler_connected)
+	return pool;
+}
+
+
+QAndroidJniBitmapPool::QAndroidJniBitmapPool()
+	: memory_budget_(c_default_memory_budget)
+	, pooled_bytes_(0)
+	, hits_(0)
+	, misses_(0)
+	, evictions_(0)
+{
+}
+
+
+qint64 QAndroidJniBitmapPool::bitmapBytes(const QSize & size, int bitness)
+{
+	return qint64(size.width()) * qint64(size.height()) * ((bitness == 16)? 2: 4);
+}
+
+
+QJniObject QAndroidJniBitmapPool::take(const QSize & size, int bitness)
+{
+	QMutexLocker locker(&mutex_);
+	// Search from the most recently returned bitmap
+	for (auto it = entries_.rbegin(); it != entries_.rend(); ++it)
+	{
+		if (it->size == size && it->bitness == bitness)
+		{
+			QJniObject result = std::move(it->bitmap);
+			pooled_bytes_ -= it->bytes;
+			entries_.erase(std::next(it).base());
+			++hits_;
+			return std::move(result);
+		}
+	}
+	++misses_;
+	return {};
+}
+
+
+void QAndroidJniBitmapPool::put(QJniObject bitmap, const QSize & size, int bitness)
+{
+	if (!bitmap || size.isEmpty())
+	{
+		return;
+	}
+	QMutexLocker locker(&mutex_);
+	const qint64 bytes = bitmapBytes(size, bitness);
+	if (bytes > memory_budget_)
+	{
+		// Dropping the reference lets Java collect the bitmap
+		return;
+	}
+	evict(bytes);
+	entries_.push_back(Entry{std::move(bitmap), size, bitness, bytes});
+	pooled_bytes_ += bytes;
+}
+
+
+void QAndroidJniBitmapPool::evict(qint64 reserve)
+{
+	while (!entries_.empty() && pooled_bytes_ + reserve > memory_budget_)
+	{
+		pooled_bytes_ -= entries_.front().bytes;
+		entries_.pop_front();
+		++evictions_;
+	}
+}
+
+
+void QAndroidJniBitmapPool::clear()
+{
+	QMutexLocker locker(&mutex_);
+	entries_.clear();
+	pooled_bytes_ = 0;
+}
+
+
+qint64 QAndroidJniBitmapPool::memoryBudget() const
+{
+	QMutexLocker locker(&mutex_);
+	return memory_budget_;
+}
+
+
+void QAndroidJniBitmapPool::setMemoryBudget(qint64 bytes)
+{
+	QMutexLocker locker(&mutex_);
+	memory_budget_ = qMax(qint64(0), bytes);
+	evict(0);
+}
+
+
+qint64 QAndroidJniBitmapPool::pooledBytes() const
+{
+	QMutexLocker locker(&mutex_);
+	return pooled_bytes_;
+}
+
+
+quint64 QAndroidJniBitmapPool::allocationsAvoided() const
+{
+	QMutexLocker locker(&mutex_);
+	return hits_;
+}
+
+
+quint64 QAndroidJniBitmapPool::allocationsMissed() const
+{
+	QMutexLocker locker(&mutex_);
+	return misses_;
+}
+
+
+quint64 QAndroidJniBitmapPool::evictions() const
+{
+	QMutexLocker locker(&mutex_);
+	return evictions_;
+}
+
+
+void QAndroidJniBitmapPool::resetStatistics()
+{
+	QMutexLocker locker(&mutex_);
+	hits_ = 0;
+	misses_ = 0;
+	evictions_ = 0;
+}
@@ -0,0 +1,118 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include <deque>
+#include <jni.h>
+#include <QtCore/QMutex>
+#include <QtCore/QSize>
+#include <QJniHelpers/QJniHelpers.h>
+
+/*!
+ * Process-wide pool of released Android bitmaps. Offscreen views return their bitmaps
+ * here when they are resized or destroyed, and QAndroidJniImagePair takes a bitmap of
+ * the exact requested size from here before creating a new one via JNI. Together with
+ * size bucketing in QAndroidOffscreenView this avoids large Java allocations (and GC)
+ * during animated resizes and when views are re-created.
+ *
+ * The pool keeps at most memoryBudget() bytes of bitmaps; when a returned bitmap
+ * does not fit, the least recently returned ones are released first.
+ */
+class QAndroidJniBitmapPool
+{
+public:
+	static QAndroidJniBitmapPool & instance();
+
+	/*!
+	 * Take a pooled bitmap of exactly this size and bitness (16 or 32).
+	 * \return null object if there is no such bitmap in the pool.
+	 */
+	QJniHelpers::QJniObject take(const QSize & size, int bitness);
+
+	/*!
+	 * Return a bitmap to the pool. The bitmap must not be in use by Java or
+	 * have its pixels locked. Bitmaps that don't fit into the budget are dropped.
+	 */
+	void put(QJniHelpers::QJniObject bitmap, const QSize & size, int bitness);
+
+	//! Release all pooled bitmaps.
+	void clear();
+
+	//! Maximum amount of memory kept in the pool, in bytes. Zero disables pooling.
+	qint64 memoryBudget() const;
+	void setMemoryBudget(qint64 bytes);
+
+	//! Memory currently held by pooled bitmaps, in bytes.
+	qint64 pooledBytes() const;
+
+	//! Number of bitmap allocations which have been served from the pool.
+	quint64 allocationsAvoided() const;
+
+	//! Number of requests which the pool could not serve, i.e. new bitmaps created.
+	quint64 allocationsMissed() const;
+
+	//! Number of bitmaps released to stay within the memory budget.
+	quint64 evictions() const;
+
+	void resetStatistics();
+
+	static qint64 bitmapBytes(const QSize & size, int bitness);
+
+private:
+	QAndroidJniBitmapPool();
+	QAndroidJniBitmapPool(const QAndroidJniBitmapPool &) = delete;
+	QAndroidJniBitmapPool & operator=(const QAndroidJniBitmapPool &) = delete;
+
+	//! Drop the oldest bitmaps until pooled_bytes_ + reserve fits into the budget.
+	void evict(qint64 reserve);
+
+	struct Entry
+	{
+		QJniHelpers::QJniObject bitmap;
+		QSize size;
+		int bitness;
+		qint64 bytes;
+	};
+
+	mutable QMutex mutex_;
+	//! Oldest entries first.
+	std::deque<Entry> entries_;
+	qint64 memory_budget_;
+	qint64 pooled_bytes_;
+	quint64 hits_;
+	quint64 misses_;
+	quint64 evictions_;
+};
@@ -37,6 +37,8 @@
   THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include "QAndroidJniImagePair.h"
+#include "QAndroidJniBitmapPool.h"
+#include "QAndroidTiledPixelConverter.h"
 
 #include <QtCore/QDebug>
 #include <QtCore/QMetaEnum>
@@ -101,6 +103,7 @@ bool QAndroidJniImagePair::isSupportedBitness(int bitness)
 
 QAndroidJniImagePair::QAndroidJniImagePair(int bitness)
 	: bitness_(bitness)
+	, pool_(nullptr)
 {
 	dispose();
 }
@@ -111,6 +114,7 @@ QAndroidJniImagePair::QAndroidJniImagePair(
 		bool convertForAndroidNow,
 		int bitness)
 	: bitness_(isSupportedBitness(bitness) ? bitness : 32)
+	, pool_(nullptr)
 {
 	assign(sourceImage, convertForAndroidNow, bitness_);
 }
@@ -165,10 +169,32 @@ void QAndroidJniImagePair::preloadJavaClasses()
 void QAndroidJniImagePair::dispose()
 {
 	mImageOnBitmap = QImage {};
+	mRgbaImageOnBitmap = QImage {};
 	mBitmap = {};
 }
 
 
+QJniObject QAndroidJniImagePair::releaseBitmap()
+{
+	if (mBitmap)
+	{
+		try
+		{
+			QJniEnvPtr jep;
+			// The pixels have been locked in doResize() for the lifetime of the QImage
+			AndroidBitmap_unlockPixels(jep.env(), mBitmap.jObject());
+		}
+		catch(const std::exception & e)
+		{
+			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+		}
+	}
+	QJniObject result = std::move(mBitmap);
+	dispose();
+	return std::move(result);
+}
+
+
 QJniObject QAndroidJniImagePair::createBitmap(const QSize & size)
 {
 	// qDebug()<<"createBitmap:"<<size.width()<<"size.height()"<<size.height()<<"Bits:"<<bitness_;
@@ -230,8 +256,16 @@ bool QAndroidJniImagePair::doResize(const QSize & size)
 	// We'll need a new bitmap for the new size
 	QImage::Format format = qtImageFormatForBitness(bitness_);
 
-	// Create new Android bitmap
-	QJniObject newBitmap(createBitmap(size));
+	// Reuse a pooled Android bitmap or create a new one
+	QJniObject newBitmap;
+	if (pool_)
+	{
+		newBitmap = pool_->take(size, bitness_);
+	}
+	if (!newBitmap)
+	{
+		newBitmap = createBitmap(size);
+	}
 
 	if (!newBitmap)
 	{
@@ -343,6 +377,16 @@ bool QAndroidJniImagePair::doResize(const QSize & size)
 		return false;
 	}
 
+	// The second QImage over the same memory describes the actual byte order of
+	// the 32-bit Android bitmap. It is a separate QImage object (not a copy of
+	// mImageOnBitmap) so bits() does not detach either of them.
+	mRgbaImageOnBitmap = QImage(
+		static_cast<uchar *>(ptr),
+		static_cast<int>(bwidth),
+		static_cast<int>(bheight),
+		static_cast<int>(bstride),
+		(format == QImage::Format_ARGB32_Premultiplied)? QImage::Format_RGBA8888_Premultiplied: format);
+
 	mBitmap = std::move(newBitmap);
 	return true;
 }
@@ -370,22 +414,15 @@ void QAndroidJniImagePair::convert32BitImage(QImage & image)
 			image.format() == QImage::Format::Format_ARGB32_Premultiplied
 		))
 	{
-#if defined(__arm__)
-		// Suppress "cast increases required alignment of target type":
-		typedef uchar __attribute__((aligned(4))) AlignedUchar;
-		AlignedUchar * bits = image.scanLine(0);
-		quint32 * ptr = reinterpret_cast<quint32 *>(bits);
-#else
-		quint32 * ptr = reinterpret_cast<quint32 *>(image.scanLine(0));
-#endif
-		const QSize sz = image.size();
-		const int nquads = sz.width() * sz.height();
-		for (int i = 0; i < nquads; ++i, ++ptr)
-		{
-			quint32 c = *ptr;
-			// Source: ARGB; formula: R | B00 | A0G0 => ABGR
-			*ptr = ((c >> 16) & 0xFF) | ((c & 0xFF) << 16) | (c & 0xFF00FF00);
-		}
+		// Source: ARGB => ABGR, in place. bits() detaches before we read.
+		uchar * bits = image.bits();
+		QAndroidTiledPixelConverter::swapRedBlue(
+			bits,
+			image.bytesPerLine(),
+			bits,
+			image.bytesPerLine(),
+			image.width(),
+			image.height());
 	}
 }
 
@@ -411,27 +448,14 @@ void QAndroidJniImagePair::convert32BitImageFromQtToAndroid(QImage & out_image)
 			return;
 		}
 
-#if defined(__arm__)
-		// Suppress "cast increases required alignment of target type":
-		typedef uchar __attribute__((aligned(4))) AlignedUchar;
-		const AlignedUchar * bits = mImageOnBitmap.scanLine(0);
-		const quint32 * src = reinterpret_cast<const quint32 *>(bits);
-
-		AlignedUchar * out_bits = out_image.scanLine(0);
-		quint32 * dest = reinterpret_cast<quint32 *>(out_bits);
-#else
-		const quint32 * src = reinterpret_cast<const quint32 *>(mImageOnBitmap.scanLine(0));
-		quint32 * dest = reinterpret_cast<quint32 *>(out_image.scanLine(0));
-#endif
-		QSize sz = mImageOnBitmap.size();
-		int nquads = sz.width() * sz.height();
-
-		for (int i = 0; i < nquads; ++i, ++src, ++dest)
-		{
-			quint32 c = *src;
-			// Source: ARGB; formula: R | B00 | A0G0 => ABGR
-			*dest = ((c >> 16) & 0xFF) | ((c & 0xFF) << 16) | (c & 0xFF00FF00);
-		}
+		// Source: ARGB => ABGR
+		QAndroidTiledPixelConverter::swapRedBlue(
+			mImageOnBitmap.constBits(),
+			mImageOnBitmap.bytesPerLine(),
+			out_image.bits(),
+			out_image.bytesPerLine(),
+			mImageOnBitmap.width(),
+			mImageOnBitmap.height());
 	}
 	else
 	{
@@ -456,6 +480,34 @@ void QAndroidJniImagePair::convert32BitImageFromAndroidToQt(QImage & out_image)
 }
 
 
+void QAndroidJniImagePair::convert32BitImageFromAndroidToQt(QImage & out_image, const QRect & area) const
+{
+	if (bitness_ != 32
+		|| out_image.size() != mImageOnBitmap.size()
+		|| out_image.format() != mImageOnBitmap.format())
+	{
+		convert32BitImageFromAndroidToQt(out_image);
+		return;
+	}
+
+	const QRect rect = area & mImageOnBitmap.rect();
+	if (rect.isEmpty())
+	{
+		return;
+	}
+
+	// Source: ABGR => ARGB
+	const int offset = rect.left() * 4;
+	QAndroidTiledPixelConverter::swapRedBlue(
+		mImageOnBitmap.constScanLine(rect.top()) + offset,
+		mImageOnBitmap.bytesPerLine(),
+		out_image.scanLine(rect.top()) + offset,
+		out_image.bytesPerLine(),
+		rect.width(),
+		rect.height());
+}
+
+
 bool QAndroidJniImagePair::isAllocated() const
 {
 	return mBitmap && !mImageOnBitmap.isNull();
@@ -42,18 +42,22 @@
 #include <QtGui/QImage>
 #include <QtGui/QPainter>
 #include <QtCore/QSize>
+#include <QtCore/QRect>
 #include <QtCore/QObject>
 #include <QtCore/QScopedPointer>
 #include <QJniHelpers/QAndroidQPAPluginGap.h>
 #include <QJniHelpers/QJniHelpers.h>
 
+class QAndroidJniBitmapPool;
+
 /*!
  * This class holds QImage and Android Bitmap sharing the same pixel buffer.
  * For 16 bit, the image can be used in Android and in Qt at the same time.
  * The 16 bit mode may have visible color errors and has no significant
  * performance benefits comparing to 32 bits.
  * For 32 bit, it is necessary to call convert32BitImageFromQtToAndroid() /
- * convert32BitImageFromAndroidToQt() to fix color plane order.
+ * convert32BitImageFromAndroidToQt() to fix color plane order, or to use
+ * rgbaQImage() which reads Android pixels as they are.
  */
 
 
@@ -88,6 +92,20 @@ public:
 	 */
 	void dispose();
 
+	/*!
+	 * Unlock the bitmap pixels and give up the Java-side Bitmap without destroying it,
+	 * e.g. to return it into a QAndroidJniBitmapPool. The pair becomes unallocated.
+	 * \return Global reference to the bitmap or null object if the pair was not allocated.
+	 */
+	QJniHelpers::QJniObject releaseBitmap();
+
+	/*!
+	 * Make resize() take bitmaps of the requested size from the pool before creating
+	 * new ones. The pool is not owned. Pass nullptr to always create new bitmaps (default).
+	 */
+	void setBitmapPool(QAndroidJniBitmapPool * pool) { pool_ = pool; }
+	QAndroidJniBitmapPool * bitmapPool() const { return pool_; }
+
 	/*!
 	 * Global Java reference to the Java-side Bitmap.
 	 * The reference may be null if image is not allocated (or disposed).
@@ -97,6 +115,13 @@ public:
 	//! Reference to the const QImage.
 	const QImage & qImage() const { return mImageOnBitmap; }
 
+	/*!
+	 * QImage over the same pixels which describes the Android byte order, i.e.
+	 * has Format_RGBA8888_Premultiplied for 32 bit (and is the same as qImage() for 16 bit).
+	 * Can be used to draw the Android image in Qt without any color plane conversion.
+	 */
+	const QImage & rgbaQImage() const { return mRgbaImageOnBitmap; }
+
 	//! Can be used to directly write to pixels, e.g. using glReadPixels(). Very unsafe!
 	uchar * bits() { return mImageOnBitmap.bits(); }
 	const uchar * bits() const  { return mImageOnBitmap.bits(); }
@@ -122,6 +147,12 @@ public:
 	//! Swap color planes so Android image starts to look correct on Qt.
 	void convert32BitImageFromAndroidToQt(QImage & out_image) const;
 
+	/*!
+	 * Same as above, but converts only pixels within 'area' if out_image already has
+	 * the proper size and format, i.e. is supposed to contain the previous image.
+	 */
+	void convert32BitImageFromAndroidToQt(QImage & out_image, const QRect & area) const;
+
 	//! Returns true if shared bitmap is allocated.
 	bool isAllocated() const;
 
@@ -175,6 +206,8 @@ protected:
 private:
 	QJniHelpers::QJniObject mBitmap;
 	QImage mImageOnBitmap;
+	QImage mRgbaImageOnBitmap;
 	int bitness_;
+	QAndroidJniBitmapPool * pool_;
 };
 
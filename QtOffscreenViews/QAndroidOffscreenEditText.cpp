@@ -34,7 +34,9 @@
   THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <QtCore/QMetaMethod>
 #include <QtCore/QMetaObject>
+#include <QtCore/QMutexLocker>
 #include <QJniHelpers/QAndroidQPAPluginGap.h>
 #include "QAndroidOffscreenEditText.h"
 
@@ -71,6 +73,38 @@ Q_DECL_EXPORT void JNICALL Java_AndroidOffscreenEditText_nativeOnTextChanged(
 	}
 }
 
+Q_DECL_EXPORT jboolean JNICALL Java_AndroidOffscreenEditText_nativeOnTextDelta(
+	JNIEnv * env,
+	jobject,
+	jlong param,
+	jstring inserted,
+	jint start,
+	jint before,
+	jint count,
+	jint length)
+{
+	if (param)
+	{
+		if (QAndroidOffscreenEditText * edit = qobject_cast<QAndroidOffscreenEditText*>(
+			reinterpret_cast<QAndroidOffscreenView*>(reinterpret_cast<void*>(param))))
+		{
+			try
+			{
+				return static_cast<jboolean>(edit->javaOnTextDelta(QJniEnvPtr(env).toQString(inserted), start, before, count, length));
+			}
+			catch (const std::exception & e)
+			{
+				qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+			}
+		}
+	}
+	else
+	{
+		qWarning() << __PRETTY_FUNCTION__ << "Zero param!";
+	}
+	return JNI_FALSE;
+}
+
 Q_DECL_EXPORT jboolean JNICALL Java_AndroidOffscreenEditText_nativeOnKey(
 	JNIEnv *,
 	jobject,
@@ -125,7 +159,7 @@ Q_DECL_EXPORT void JNICALL Java_AndroidOffscreenEditText_nativeSetSelectionInfo(
 		if (QAndroidOffscreenEditText * edit = qobject_cast<QAndroidOffscreenEditText*>(
 			reinterpret_cast<QAndroidOffscreenView*>(reinterpret_cast<void*>(param))))
 		{
-			QMetaObject::invokeMethod(edit, "javaSetSelectionInfo", Q_ARG(int, top),  Q_ARG(int, bottom));
+			edit->javaSetSelectionInfo(top, bottom);
 		}
 	}
 	else
@@ -146,7 +180,7 @@ Q_DECL_EXPORT void JNICALL Java_AndroidOffscreenEditText_nativeTextSelectionChan
 		if (QAndroidOffscreenEditText * edit = qobject_cast<QAndroidOffscreenEditText*>(
 				reinterpret_cast<QAndroidOffscreenView*>(reinterpret_cast<void*>(param))))
 		{
-			QMetaObject::invokeMethod(edit, "javaSetTextSelection", Q_ARG(int, start),  Q_ARG(int, end));
+			edit->javaSetTextSelection(start, end);
 		}
 	}
 	else
@@ -209,6 +243,7 @@ QAndroidOffscreenEditText::QAndroidOffscreenEditText(
 		{
 			view.registerNativeMethods({
 				{ "nativeOnTextChanged", "(JLjava/lang/String;III)V", reinterpret_cast<void*>(Java_AndroidOffscreenEditText_nativeOnTextChanged) },
+				{ "nativeOnTextDelta", "(JLjava/lang/String;IIII)Z", reinterpret_cast<void*>(Java_AndroidOffscreenEditText_nativeOnTextDelta) },
 				{ "nativeOnKey", "(JZI)Z", reinterpret_cast<void*>(Java_AndroidOffscreenEditText_nativeOnKey) },
 				{ "nativeOnEditorAction", "(JI)V", reinterpret_cast<void*>(Java_AndroidOffscreenEditText_nativeOnEditorAction) },
 				{ "nativeSetSelectionInfo", "(JII)V", reinterpret_cast<void*>(Java_AndroidOffscreenEditText_nativeSetSelectionInfo) },
@@ -240,10 +275,47 @@ void QAndroidOffscreenEditText::preloadJavaClasses()
 
 void QAndroidOffscreenEditText::javaOnTextChanged(const QString & str, int start, int before, int count)
 {
+	{
+		QMutexLocker locker(&text_mutex_);
+		text_.setText(str);
+		text_resync_pending_ = false;
+	}
 	emit onTextChanged(str, start, before, count);
 	emit onTextChanged();
 }
 
+bool QAndroidOffscreenEditText::javaOnTextDelta(const QString & inserted, int start, int before, int count, int length)
+{
+	if (inserted.length() != count)
+	{
+		qWarning() << __FUNCTION__ << "Inserted text length mismatch:" << inserted.length() << "vs." << count;
+		return false;
+	}
+	QString text;
+	{
+		QMutexLocker locker(&text_mutex_);
+		// Returning false makes Java send the whole text via javaOnTextChanged().
+		if (text_resync_pending_ || !text_.replace(start, before, inserted) || text_.length() != length)
+		{
+			return false;
+		}
+		// Only assemble the text for the receivers which need it.
+		static const QMetaMethod full_text_signal = QMetaMethod::fromSignal(
+			static_cast<void (QAndroidOffscreenEditText::*)(QString, int, int, int)>(&QAndroidOffscreenEditText::onTextChanged));
+		if (isSignalConnected(full_text_signal))
+		{
+			text = text_.text();
+		}
+	}
+	emit onTextDelta(start, before, inserted);
+	if (!text.isNull())
+	{
+		emit onTextChanged(text, start, before, count);
+	}
+	emit onTextChanged();
+	return true;
+}
+
 bool QAndroidOffscreenEditText::javaOnKey(bool down, int androidKey)
 {
 	switch(androidKey)
@@ -285,20 +357,42 @@ void QAndroidOffscreenEditText::javaOnEditorAction(int action)
 
 void QAndroidOffscreenEditText::javaSetSelectionInfo(int top, int bottom)
 {
-	selection_top_ = top;
-	selection_bottom_ = bottom;
-	emit selectionChanged();
+	if ((selection_top_.exchange(top) != top) | (selection_bottom_.exchange(bottom) != bottom))
+	{
+		QMetaObject::invokeMethod(this, "selectionChanged", Qt::QueuedConnection);
+	}
 }
 
 void QAndroidOffscreenEditText::javaSetTextSelection(int start, int end)
 {
-	selection_start_ = start;
-	selection_end_ = end;
-	emit textSelectionChanged();
+	if ((selection_start_.exchange(start) != start) | (selection_end_.exchange(end) != end))
+	{
+		QMetaObject::invokeMethod(this, "textSelectionChanged", Qt::QueuedConnection);
+	}
+}
+
+void QAndroidOffscreenEditText::setTextMirror(const QString & text)
+{
+	// Java will confirm the text via onTextChanged(), but getText() should
+	// return the new value immediately.
+	QMutexLocker locker(&text_mutex_);
+	text_.setText(text);
+	// The next delta from Java may still be based on the previous text.
+	text_resync_pending_ = delta_text_changes_;
+}
+
+void QAndroidOffscreenEditText::applyBatch(const QAndroidOffscreenEditTextBatch & batch)
+{
+	if (batch.hasText())
+	{
+		setTextMirror(batch.text());
+	}
+	QAndroidOffscreenView::applyBatch(batch);
 }
 
 void QAndroidOffscreenEditText::setText(const QString & text)
 {
+	setTextMirror(text);
 	try
 	{
 		if (QJniObject & view = offscreenView())
@@ -314,18 +408,28 @@ void QAndroidOffscreenEditText::setText(const QString & text)
 
 QString QAndroidOffscreenEditText::getText() const
 {
+	QMutexLocker locker(&text_mutex_);
+	return text_.text();
+}
+
+void QAndroidOffscreenEditText::setDeltaTextChanges(bool enable)
+{
+	if (delta_text_changes_ == enable)
+	{
+		return;
+	}
+	delta_text_changes_ = enable;
 	try
 	{
-		if (QJniObject & view = const_cast<QAndroidOffscreenEditText*>(this)->offscreenView())
+		if (QJniObject & view = offscreenView())
 		{
-			return view.callString("getText");
+			view.callVoid("setDeltaTextChanges", jboolean(enable));
 		}
 	}
 	catch (const std::exception & e)
 	{
 		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
 	}
-	return QString();
 }
 
 void QAndroidOffscreenEditText::setTextSize(float size, int unit)
@@ -1196,3 +1300,80 @@ void QAndroidOffscreenEditText::javaOnHasAcceptableInputChanged(bool hasAcceptab
 		emit hasAcceptableInputChanged(hasAcceptableInput_);
 	}
 }
+
+
+QAndroidOffscreenEditTextBatch & QAndroidOffscreenEditTextBatch::setText(const QString & text)
+{
+	appendOpcode(OpSetText);
+	appendString(text);
+	has_text_ = true;
+	text_ = text;
+	return *this;
+}
+
+void QAndroidOffscreenEditTextBatch::clear()
+{
+	QAndroidOffscreenViewBatch::clear();
+	has_text_ = false;
+	text_.clear();
+}
+
+QAndroidOffscreenEditTextBatch & QAndroidOffscreenEditTextBatch::setTextSize(float size, int unit)
+{
+	appendOpcode(OpSetTextSize);
+	appendFloat(size);
+	appendInt(unit);
+	return *this;
+}
+
+QAndroidOffscreenEditTextBatch & QAndroidOffscreenEditTextBatch::setTextColor(int color)
+{
+	appendOpcode(OpSetTextColor);
+	appendInt(color);
+	return *this;
+}
+
+QAndroidOffscreenEditTextBatch & QAndroidOffscreenEditTextBatch::setTextScaleX(float size)
+{
+	appendOpcode(OpSetTextScaleX);
+	appendFloat(size);
+	return *this;
+}
+
+QAndroidOffscreenEditTextBatch & QAndroidOffscreenEditTextBatch::setHint(const QString & hint)
+{
+	appendOpcode(OpSetHint);
+	appendString(hint);
+	return *this;
+}
+
+QAndroidOffscreenEditTextBatch & QAndroidOffscreenEditTextBatch::setHintTextColor(int color)
+{
+	appendOpcode(OpSetHintTextColor);
+	appendInt(color);
+	return *this;
+}
+
+QAndroidOffscreenEditTextBatch & QAndroidOffscreenEditTextBatch::setHighlightColor(int color)
+{
+	appendOpcode(OpSetHighlightColor);
+	appendInt(color);
+	return *this;
+}
+
+QAndroidOffscreenEditTextBatch & QAndroidOffscreenEditTextBatch::setGravity(int gravity)
+{
+	appendOpcode(OpSetGravity);
+	appendInt(gravity);
+	return *this;
+}
+
+QAndroidOffscreenEditTextBatch & QAndroidOffscreenEditTextBatch::setPadding(int left, int top, int right, int bottom)
+{
+	appendOpcode(OpSetPadding);
+	appendInt(left);
+	appendInt(top);
+	appendInt(right);
+	appendInt(bottom);
+	return *this;
+}
@@ -35,7 +35,54 @@
 */
 
 #pragma once
+#include <QtCore/QMutex>
+#include <QtCore/QString>
 #include "QAndroidOffscreenView.h"
+#include "QAndroidOffscreenViewBatch.h"
+#include "QAndroidTextPieceTable.h"
+
+/*!
+ * Batch of EditText setter calls, see QAndroidOffscreenViewBatch.
+ * Opcodes must match BATCH_OP_* constants in OffscreenEditText.java.
+ */
+class QAndroidOffscreenEditTextBatch
+	: public QAndroidOffscreenViewBatch
+{
+public:
+	enum EditTextOpcode
+	{
+		OpSetText = OpUser,
+		OpSetTextSize,
+		OpSetTextColor,
+		OpSetTextScaleX,
+		OpSetHint,
+		OpSetHintTextColor,
+		OpSetHighlightColor,
+		OpSetGravity,
+		OpSetPadding
+	};
+
+	QAndroidOffscreenEditTextBatch & setText(const QString & text);
+	QAndroidOffscreenEditTextBatch & setTextSize(float size, int unit);
+	QAndroidOffscreenEditTextBatch & setTextColor(int color);
+	QAndroidOffscreenEditTextBatch & setTextScaleX(float size);
+	QAndroidOffscreenEditTextBatch & setHint(const QString & hint);
+	QAndroidOffscreenEditTextBatch & setHintTextColor(int color);
+	QAndroidOffscreenEditTextBatch & setHighlightColor(int color);
+	QAndroidOffscreenEditTextBatch & setGravity(int gravity);
+	QAndroidOffscreenEditTextBatch & setPadding(int left, int top, int right, int bottom);
+
+	void clear();
+
+	//! Whether the batch contains setText(), and the last text set by it.
+	bool hasText() const { return has_text_; }
+	const QString & text() const { return text_; }
+
+private:
+	bool has_text_ = false;
+	QString text_;
+};
+
 
 class QAndroidOffscreenEditText
 	: public QAndroidOffscreenView
@@ -59,6 +106,10 @@ public:
 	void setText(const QString & text);
 	QString getText() const;
 
+	using QAndroidOffscreenView::applyBatch;
+	//! Same as QAndroidOffscreenView::applyBatch(), also updates getText() if the batch sets the text.
+	void applyBatch(const QAndroidOffscreenEditTextBatch & batch);
+
 
 	/*!
 	 * Return internal height
@@ -365,6 +416,15 @@ public:
 	void setMaxLength(int length);
 	void setRichTextMode(bool enabled);
 
+	/*!
+	 * In delta mode Java sends only the replaced part of the text on each change,
+	 * so typing in a long text does not transfer and convert the whole text every time.
+	 * The text is kept in a piece table and assembled by getText() or when something
+	 * is connected to onTextChanged(QString,int,int,int). Off by default.
+	 */
+	void setDeltaTextChanges(bool enable);
+	bool deltaTextChanges() const { return delta_text_changes_; }
+
 	//! mask for input validation
 	void setInputMask(const QString & inputMask);
 
@@ -388,6 +448,12 @@ signals:
 	//! Simple notification that the text has been changed.
 	void onTextChanged();
 
+	/*!
+	 * Emitted in delta mode (see setDeltaTextChanges()): \a before characters at \a start
+	 * have been replaced with \a inserted. May be emitted in Android UI thread.
+	 */
+	void onTextDelta(int start, int before, QString inserted);
+
 	//! Emitted when KEYCODE_DPAD_CENTER or KEYCODE_ENTER has been released.
 	void onEnter();
 
@@ -604,30 +670,45 @@ signals:
 
 protected:
 	virtual void javaOnTextChanged(const QString & str, int start, int before, int count);
+	//! \return false if the delta does not apply to the current text.
+	virtual bool javaOnTextDelta(const QString & inserted, int start, int before, int count, int length);
 	virtual bool javaOnKey(bool down, int androidKey);
 	virtual void javaOnEditorAction(int action);
 
 private slots:
-	void javaSetSelectionInfo(int top, int bottom);
-	void javaSetTextSelection(int start, int end);
 	void javaOnContentHeightChanged(int height);
 	void javaOnHasAcceptableInputChanged(bool hasAcceptableInput);
 
 private:
 	friend void JNICALL Java_AndroidOffscreenEditText_nativeOnTextChanged(JNIEnv * env, jobject jo, jlong param, jstring str, jint start, jint before, jint count);
+	friend jboolean JNICALL Java_AndroidOffscreenEditText_nativeOnTextDelta(JNIEnv * env, jobject jo, jlong param, jstring inserted, jint start, jint before, jint count, jint length);
 	friend jboolean JNICALL Java_AndroidOffscreenEditText_nativeOnKey(JNIEnv * env, jobject jo, jlong param, jboolean down, jint keycode);
 	friend void JNICALL Java_AndroidOffscreenEditText_nativeOnEditorAction(JNIEnv *, jobject, jlong param, jint action);
 	friend void JNICALL Java_AndroidOffscreenEditText_nativeSetSelectionInfo(JNIEnv *, jobject, jlong param, jint top, jint bottom);
+	friend void JNICALL Java_AndroidOffscreenEditText_nativeTextSelectionChanged(JNIEnv *, jobject, jlong param, jint start, jint end);
 	friend void JNICALL Java_AndroidOffscreenEditText_nativeOnContentHeightChanged(JNIEnv *, jobject, jlong param, jint height);
 	friend void JNICALL Java_AndroidOffscreenEditText_nativeOnHasAcceptableInputChanged(JNIEnv *, jobject, jlong param, jboolean hasAcceptableInput);
 
+private:
+	void setTextMirror(const QString & text);
+	//! Called in Android UI thread: the values are mirrored right away, the signals are queued.
+	void javaSetSelectionInfo(int top, int bottom);
+	void javaSetTextSelection(int start, int end);
+
 private:
 	int paint_flags_;
-	int selection_start_ = 0;
-	int selection_end_ = 0;
-	int selection_top_ = 0;
-	int selection_bottom_ = 0;
+	//! Written in Android UI thread, see javaSetTextSelection() and javaSetSelectionInfo().
+	std::atomic<int> selection_start_{0};
+	std::atomic<int> selection_end_{0};
+	std::atomic<int> selection_top_{0};
+	std::atomic<int> selection_bottom_{0};
 	int content_height_ = 0;
 	bool hasAcceptableInput_ = true;
+	//! Last text reported by Java (or set by setText()), so getText() does not call Java.
+	mutable QMutex text_mutex_;
+	QAndroidTextPieceTable text_;
+	//! setText() has been called in delta mode and Java has not sent the whole text since.
+	bool text_resync_pending_ = false;
+	bool delta_text_changes_ = false;
 };
 
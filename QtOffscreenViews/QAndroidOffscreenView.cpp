@@ -34,9 +34,12 @@
   THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <cmath>
 #include <mutex>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 #include <QtCore/QThread>
@@ -44,8 +47,10 @@
 #include <QtCore/QMutexLocker>
 #include <QtCore/QCoreApplication>
 #include <QJniHelpers/QAndroidQPAPluginGap.h>
+#include "QAndroidJniBitmapPool.h"
 #include "QAndroidJniImagePair.h"
 #include "QAndroidOffscreenView.h"
+#include "QAndroidOffscreenViewPool.h"
 
 using namespace QJniHelpers;
 
@@ -54,6 +59,14 @@ using namespace QJniHelpers;
 static bool s_have_to_adjust_size_to_pot = true;
 static QSize s_max_gl_size;
 
+//! Same as Android's SystemClock.uptimeMillis().
+static long long uptimeMillis()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<long long>(ts.tv_sec) * 1000LL + ts.tv_nsec / 1000000;
+}
+
 //! Calculate smallest power of 2 which is greater than x.
 static int potSize(int x, int max_possible)
 {
@@ -85,9 +98,39 @@ static QSize potSize(const QSize & size, const QSize & maxsize)
 	return result;
 }
 
+static QAndroidOffscreenView::BitmapSlackPolicy s_bitmap_slack_policy;
+
+//! Size of the bitmaps to allocate for a view of the given size.
+static QSize bitmapSizeForView(const QSize & size)
+{
+	if (s_have_to_adjust_size_to_pot)
+	{
+		return potSize(size, s_max_gl_size);
+	}
+	const QAndroidOffscreenView::BitmapSlackPolicy & policy = s_bitmap_slack_policy;
+	auto grow = [&policy](int x, int max_possible)
+	{
+		x += x * qMax(0, policy.slack_percent) / 100;
+		if (policy.granularity > 1)
+		{
+			x = (x + policy.granularity - 1) / policy.granularity * policy.granularity;
+		}
+		return (max_possible > 0)? qMin(x, max_possible): x;
+	};
+	return QSize(grow(size.width(), s_max_gl_size.width()), grow(size.height(), s_max_gl_size.height()));
+}
+
+//! Check if the bitmaps are too large for a view of the given size and would be smaller if reallocated.
+static bool bitmapsShouldShrink(const QSize & bitmapsize, const QSize & viewsize)
+{
+	return qint64(viewsize.width()) * qint64(viewsize.height()) * 100
+			< qint64(bitmapsize.width()) * qint64(bitmapsize.height()) * s_bitmap_slack_policy.shrink_percent
+		&& bitmapSizeForView(viewsize) != bitmapsize;
+}
+
 static const QString c_class_path_(QLatin1String("ru/dublgis/offscreenview/"));
 
-Q_DECL_EXPORT void JNICALL Java_OffscreenView_nativeUpdate(JNIEnv *, jobject, jlong param)
+Q_DECL_EXPORT void JNICALL Java_OffscreenView_nativeUpdate(JNIEnv *, jobject, jlong param, int left, int top, int right, int bottom, int frames, jfloat scale)
 {
 	if (param)
 	{
@@ -95,13 +138,38 @@ Q_DECL_EXPORT void JNICALL Java_OffscreenView_nativeUpdate(JNIEnv *, jobject, jl
 		QAndroidOffscreenView * proxy = reinterpret_cast<QAndroidOffscreenView*>(vp);
 		if (proxy)
 		{
-			proxy->javaUpdate();
+			proxy->javaUpdate(left, top, right, bottom, frames, static_cast<float>(scale));
 			return;
 		}
 	}
 	qWarning()<<__FUNCTION__<<"Zero param!";
 }
 
+Q_DECL_EXPORT jint JNICALL Java_OffscreenView_nativeExchangeBitmap(JNIEnv * env, jclass, jobject exchange, jint value)
+{
+	// The only read-modify-write operation on the exchange buffer which Java cannot do by itself.
+	void * address = (exchange)? env->GetDirectBufferAddress(exchange): nullptr;
+	if (address)
+	{
+		QAndroidOffscreenView::BitmapExchange * be = static_cast<QAndroidOffscreenView::BitmapExchange *>(address);
+		return be->state.exchange(value, std::memory_order_acq_rel);
+	}
+	qWarning()<<__FUNCTION__<<"Invalid exchange buffer!";
+	return value & QAndroidOffscreenView::BitmapExchange::c_index_mask;
+}
+
+Q_DECL_EXPORT jint JNICALL Java_OffscreenView_nativeLoadExchange(JNIEnv * env, jclass, jobject exchange)
+{
+	// Plain ByteBuffer reads give Java no ordering guarantees against the C++ side.
+	void * address = (exchange)? env->GetDirectBufferAddress(exchange): nullptr;
+	if (address)
+	{
+		return static_cast<QAndroidOffscreenView::BitmapExchange *>(address)->state.load(std::memory_order_acquire);
+	}
+	qWarning()<<__FUNCTION__<<"Invalid exchange buffer!";
+	return 0;
+}
+
 Q_DECL_EXPORT void JNICALL Java_OffscreenView_nativeViewCreated(JNIEnv *, jobject, jlong param)
 {
 	if (param)
@@ -117,6 +185,27 @@ Q_DECL_EXPORT void JNICALL Java_OffscreenView_nativeViewCreated(JNIEnv *, jobjec
 	qWarning()<<__FUNCTION__<<"Zero param!";
 }
 
+Q_DECL_EXPORT void JNICALL Java_OffscreenView_nativeViewStateChanged(JNIEnv *, jobject, jlong param, jint scroll_x, jint scroll_y, jint measured_width, jint measured_height)
+{
+	if (param)
+	{
+		void * vp = reinterpret_cast<void*>(param);
+		QAndroidOffscreenView * proxy = reinterpret_cast<QAndroidOffscreenView*>(vp);
+		if (proxy)
+		{
+			proxy->javaViewStateChanged(scroll_x, scroll_y, measured_width, measured_height);
+			return;
+		}
+	}
+	qWarning()<<__FUNCTION__<<"Zero param!";
+}
+
+Q_DECL_EXPORT void JNICALL Java_OffscreenView_nativeTrimMemory(JNIEnv *, jclass, jint level)
+{
+	qDebug() << __FUNCTION__ << level;
+	QOpenGLTextureHolder::requestTexturePoolTrim();
+}
+
 Q_DECL_EXPORT void JNICALL Java_OffscreenView_onVisibleRect(JNIEnv *, jobject, jlong param, int left, int top, int right, int bottom)
 {
 	if (param)
@@ -144,9 +233,14 @@ QAndroidOffscreenView::QAndroidOffscreenView(
 	, tex_()
 	, android_to_qt_buffer_()
 	, last_qt_buffer_(-1)
+	, bitmap_buffer_zero_copy_(false)
 	, bitmap_a_(32)
 	, bitmap_b_(32)
+	, bitmap_c_(32)
+	, qt_bitmap_(2)
+	, input_batch_interval_ms_(8)
 	, size_(defsize)
+	, render_scale_(1.0f)
 	, fill_color_(Qt::white)
 	, need_update_texture_(false)
 	, view_painted_(false)
@@ -155,9 +249,31 @@ QAndroidOffscreenView::QAndroidOffscreenView(
 	, is_visible_(false)
 	, is_enabled_(true)
 	, view_created_(false)
+	, scroll_x_(0)
+	, scroll_y_(0)
+	, measured_width_(-1)
+	, measured_height_(-1)
 	, last_texture_width_(0)
 	, last_texture_height_(0)
+	, coalesce_updates_(true)
+	, updates_received_(0)
+	, updates_presented_(0)
+	, first_frame_start_ms_(uptimeMillis())
+	, first_frame_latency_ms_(-1)
+	, taken_from_pool_(false)
 {
+	static_assert(sizeof(BitmapExchange) == 4 + 3 * 6 * 4, "BitmapExchange layout must match OffscreenView.java");
+	bitmap_exchange_.state.store(1);
+	memset(bitmap_exchange_.frames, 0, sizeof(bitmap_exchange_.frames));
+	bitmap_a_.setBitmapPool(&QAndroidJniBitmapPool::instance());
+	bitmap_b_.setBitmapPool(&QAndroidJniBitmapPool::instance());
+	bitmap_c_.setBitmapPool(&QAndroidJniBitmapPool::instance());
+
+	bitmap_shrink_timer_.setSingleShot(true);
+	connect(&bitmap_shrink_timer_, SIGNAL(timeout()), this, SLOT(shrinkOversizedBitmaps()));
+	input_flush_timer_.setSingleShot(true);
+	connect(&input_flush_timer_, SIGNAL(timeout()), this, SLOT(flushInputEvents()));
+
 	connect(
 		QApplicationActivityObserver::instance(),
 		SIGNAL(applicationActiveStateChanged()),
@@ -254,17 +370,30 @@ void QAndroidOffscreenView::preloadJavaClasses()
 	std::call_once(s_once, []() {
 		try
 		{
-			QApplicationActivityObserver::instance();
+			// Pooled textures are of no use in background, and are freed there like on low memory.
+			QApplicationActivityObserver * observer = QApplicationActivityObserver::instance();
+			QObject::connect(observer, &QApplicationActivityObserver::applicationActiveStateChanged, [observer]() {
+				const bool active = observer->isApplicationActive();
+				QOpenGLTextureHolder::setTexturePoolEnabled(active);
+				if (!active)
+				{
+					QOpenGLTextureHolder::requestTexturePoolTrim();
+				}
+			});
 
 			QJniHelpers::QAndroidQPAPluginGap::preloadJavaClasses();
 			QJniHelpers::QAndroidQPAPluginGap::preloadJavaClass("ru/dublgis/offscreenview/OffscreenView");
 			QAndroidJniImagePair::preloadJavaClasses();
 
 			QJniHelpers::QJniClass("ru/dublgis/offscreenview/OffscreenView").registerNativeMethods({
-				{"nativeUpdate", "(J)V", reinterpret_cast<void*>(Java_OffscreenView_nativeUpdate)},
+				{"nativeUpdate", "(JIIIIIF)V", reinterpret_cast<void*>(Java_OffscreenView_nativeUpdate)},
 				{"nativeViewCreated", "(J)V", reinterpret_cast<void*>(Java_OffscreenView_nativeViewCreated)},
+				{"nativeExchangeBitmap", "(Ljava/nio/ByteBuffer;I)I", reinterpret_cast<void*>(Java_OffscreenView_nativeExchangeBitmap)},
+				{"nativeLoadExchange", "(Ljava/nio/ByteBuffer;)I", reinterpret_cast<void*>(Java_OffscreenView_nativeLoadExchange)},
 				{"getActivity", "()Landroid/app/Activity;", reinterpret_cast<void*>(QJniHelpers::QAndroidQPAPluginGap::getActivityNoThrow)},
 				{"nativeOnVisibleRect", "(JIIII)V", reinterpret_cast<void*>(Java_OffscreenView_onVisibleRect)},
+				{"nativeViewStateChanged", "(JIIII)V", reinterpret_cast<void*>(Java_OffscreenView_nativeViewStateChanged)},
+				{"nativeTrimMemory", "(I)V", reinterpret_cast<void*>(Java_OffscreenView_nativeTrimMemory)},
 			});
 		}
 		catch (const std::exception & e)
@@ -392,13 +521,17 @@ void QAndroidOffscreenView::initializeGL()
 
 		// Check for max texture size and limit control size
 		size_ = QSize(qMin(s_max_gl_size.width(), size_.width()), qMin(s_max_gl_size.height(), size_.height()));
-		tex_.setTextureSize(size_);
+		tex_.setTextureSize(renderSize());
 
 		try
 		{
 			offscreen_view_.callParamVoid("SetTexture", "I", jint(tex_.getTexture()));
 			offscreen_view_.callParamVoid("SetInitialWidth", "I", jint(size_.width()));
 			offscreen_view_.callParamVoid("SetInitialHeight", "I", jint(size_.height()));
+			if (render_scale_ != 1.0f)
+			{
+				offscreen_view_.callParamVoid("setRenderScale", "F", jfloat(render_scale_));
+			}
 			offscreen_view_.callVoid("initializeGL");
 		}
 		catch (const std::exception & e)
@@ -423,15 +556,19 @@ void QAndroidOffscreenView::initializeBitmap()
 			return;
 		}
 		// qDebug()<<__PRETTY_FUNCTION__;
-		QSize bitmapsize = (s_have_to_adjust_size_to_pot)? potSize(size_, s_max_gl_size): size_;
+		QSize bitmapsize = bitmapSizeForView(renderSize());
 		bitmap_a_.resize(bitmapsize);
 		bitmap_b_.resize(bitmapsize);
+		bitmap_c_.resize(bitmapsize);
 		last_qt_buffer_ = -1;
+		markBitmapsDamaged();
 		offscreen_view_.callParamVoid("SetInitialWidth", "I", jint(size_.width()));
 		offscreen_view_.callParamVoid("SetInitialHeight", "I", jint(size_.height()));
-		offscreen_view_.callParamVoid("initializeBitmap",
-			"Landroid/graphics/Bitmap;Landroid/graphics/Bitmap;",
-			bitmap_a_.jbitmap(), bitmap_b_.jbitmap());
+		if (render_scale_ != 1.0f)
+		{
+			offscreen_view_.callParamVoid("setRenderScale", "F", jfloat(render_scale_));
+		}
+		passBitmapsToJava("initializeBitmap");
 	}
 	catch (const std::exception & e)
 	{
@@ -457,13 +594,20 @@ void QAndroidOffscreenView::deleteAndroidView()
 
 void QAndroidOffscreenView::deinitialize()
 {
+	input_flush_timer_.stop();
+	input_queue_.clear();
 	QMutexLocker locker(&bitmaps_mutex_);
 	try
 	{
+		if (offscreen_view_ && bitmap_a_.isAllocated())
+		{
+			// Java must stop using the exchange buffer which is a part of this object.
+			passBitmapsToJava("setBitmaps", true);
+		}
 		deleteAndroidView();
 		tex_.deallocateTexture();
-		bitmap_a_.dispose();
-		bitmap_b_.dispose();
+		bitmap_shrink_timer_.stop();
+		releaseBitmaps();
 		last_qt_buffer_ = -1;
 		android_to_qt_buffer_ = QImage();
 	}
@@ -493,12 +637,9 @@ void QAndroidOffscreenView::paintGL(int l, int b, int w, int h, bool reverse_y)
 		&& ((tex_.getTextureSize().height() != last_texture_height_ && last_texture_height_ > 0)
 			|| (tex_.getTextureSize().width() != last_texture_width_ && last_texture_width_ > 0)))
 	{
-		glViewport(l, b, last_texture_width_, last_texture_height_);
-		const QSize size(
-			last_texture_width_, 
-			last_texture_height_
-		);
-		
+		const QSize size = unscaledSize(QSize(last_texture_width_, last_texture_height_));
+		glViewport(l, b, size.width(), size.height());
+
 		tex_.blitTexture(
 			QRect(QPoint(0, 0), size) // target rect (relatively to viewport)
 			, QRect(QPoint(0, 0), size) // source rect (in texture)
@@ -523,8 +664,33 @@ void QAndroidOffscreenView::paintGL(int l, int b, int w, int h, bool reverse_y)
 	}
 }
 
+bool QAndroidOffscreenView::addToTextureBatch(QOpenGLTextureBatch & batch, const QRect & target_rect, bool reverse_y)
+{
+	if (target_rect.isEmpty())
+	{
+		return false;
+	}
+	if (tex_.isAllocated() && !view_painted_
+		&& ((tex_.getTextureSize().height() != last_texture_height_ && last_texture_height_ > 0)
+			|| (tex_.getTextureSize().width() != last_texture_width_ && last_texture_width_ > 0)))
+	{
+		// Keep showing the previous image in its own size until the resized view is painted,
+		// like paintGL() does.
+		batch.add(tex_, QRect(target_rect.topLeft(), unscaledSize(QSize(last_texture_width_, last_texture_height_))), QRect(), reverse_y);
+		return true;
+	}
+	if (updateGLTextureInHolder())
+	{
+		batch.add(tex_, target_rect, QRect(), reverse_y);
+		return true;
+	}
+	return false;
+}
+
 bool QAndroidOffscreenView::updateGLTextureInHolder()
 {
+	QOpenGLTextureHolder::collectTexturePool();
+
 	//
 	// GL texture + GL in Qt
 	//
@@ -557,141 +723,289 @@ bool QAndroidOffscreenView::updateGLTextureInHolder()
 // Public version
 const QImage * QAndroidOffscreenView::getBitmapBuffer(bool * out_texture_updated)
 {
-	return getBitmapBuffer(out_texture_updated, true);
+	QMutexLocker locker(&bitmaps_mutex_);
+	const QImage * buffer = getBitmapBuffer(out_texture_updated, true);
+	if (!buffer)
+	{
+		return nullptr;
+	}
+	// The bitmap may be larger than the view (see BitmapSlackPolicy), so return a view
+	// of its top-left part, sharing the pixels with it.
+	const QSize content = bitmapContentSize().boundedTo(buffer->size());
+	if (content == buffer->size())
+	{
+		return buffer;
+	}
+	if (bitmap_buffer_crop_.constBits() != buffer->constBits()
+		|| bitmap_buffer_crop_.size() != content
+		|| bitmap_buffer_crop_.format() != buffer->format())
+	{
+		bitmap_buffer_crop_ = QImage(
+			buffer->constBits(), content.width(), content.height(), buffer->bytesPerLine(), buffer->format());
+	}
+	return &bitmap_buffer_crop_;
+}
+
+QSize QAndroidOffscreenView::bitmapContentSize() const
+{
+	return (last_texture_width_ > 0 && last_texture_height_ > 0)
+		? QSize(last_texture_width_, last_texture_height_)
+		: renderSize();
 }
 
-const QImage * QAndroidOffscreenView::getPreviousBitmapBuffer(bool convert_from_android_format)
+QAndroidJniImagePair & QAndroidOffscreenView::bitmap(int index)
 {
-	if (!view_painted_)
+	switch (index)
 	{
-		return 0; // No previous buffer
+	case 0:
+		return bitmap_a_;
+	case 1:
+		return bitmap_b_;
+	default:
+		return bitmap_c_;
 	}
-	const QImage * result = 0;
-	if (convert_from_android_format)
+}
+
+bool QAndroidOffscreenView::bitmapsAllocated() const
+{
+	return bitmap_a_.isAllocated() && bitmap_b_.isAllocated() && bitmap_c_.isAllocated();
+}
+
+void QAndroidOffscreenView::passBitmapsToJava(const char * method, bool detach)
+{
+	// Java resets the exchange state so that it paints into bitmap 0, bitmap 1
+	// is the latest (not fresh) one and bitmap 2 belongs to Qt.
+	qt_bitmap_ = 2;
+	QJniEnvPtr jep;
+	QJniLocalRef exchange(jep, (detach)? nullptr: jep.env()->NewDirectByteBuffer(
+		&bitmap_exchange_,
+		static_cast<jlong>(sizeof(bitmap_exchange_))));
+	if (jep.clearException() || (!detach && !exchange.jObject()))
+	{
+		qCritical() << "Failed to create the bitmap exchange buffer";
+		return;
+	}
+	offscreen_view_.callParamVoid(method,
+		"Landroid/graphics/Bitmap;Landroid/graphics/Bitmap;Landroid/graphics/Bitmap;Ljava/nio/ByteBuffer;",
+		(detach)? nullptr: bitmap_a_.jbitmap(),
+		(detach)? nullptr: bitmap_b_.jbitmap(),
+		(detach)? nullptr: bitmap_c_.jbitmap(),
+		exchange.jObject());
+}
+
+bool QAndroidOffscreenView::acquireBitmapBuffer()
+{
+	if (!(bitmap_exchange_.state.load(std::memory_order_acquire) & BitmapExchange::c_fresh))
 	{
-		result = &android_to_qt_buffer_;
+		return false;
 	}
-	else
+	// Give our bitmap back and take the latest one. Java may publish a newer frame at any
+	// moment, in this case we get it instead and the damage covers the skipped frame too.
+	const int32_t state = bitmap_exchange_.state.exchange(qt_bitmap_, std::memory_order_acq_rel);
+	qt_bitmap_ = state & BitmapExchange::c_index_mask;
+	last_qt_buffer_ = qt_bitmap_;
+
+	const int32_t * frame = bitmap_exchange_.frames[qt_bitmap_];
+	const QRect damage(frame[0], frame[1], frame[2] - frame[0], frame[3] - frame[1]);
+	qt_buffer_damage_ |= damage;
+	gl_texture_damage_ |= damage;
+	last_texture_width_ = frame[4];
+	last_texture_height_ = frame[5];
+	return true;
+}
+
+void QAndroidOffscreenView::setBitmapBufferZeroCopy(bool zero_copy)
+{
+	QMutexLocker locker(&bitmaps_mutex_);
+	if (zero_copy != bitmap_buffer_zero_copy_)
 	{
-		const QAndroidJniImagePair & pair = (last_qt_buffer_ == 0)? bitmap_a_: bitmap_b_;
-		if (!pair.isAllocated())
-		{
-			return 0; // No previous buffer
-		}
-		result = &pair.qImage();
+		bitmap_buffer_zero_copy_ = zero_copy;
+		// The intermediate buffer is not needed in zero-copy mode, and when switching back
+		// it has to be refilled completely.
+		android_to_qt_buffer_ = QImage();
+		qt_buffer_damage_ = QRect(QPoint(0, 0), bitmap_a_.size());
 	}
-	if (result->isNull())
+}
+
+void QAndroidOffscreenView::markBitmapsDamaged()
+{
+	const QRect all(QPoint(0, 0), bitmap_a_.size());
+	qt_buffer_damage_ = all;
+	gl_texture_damage_ = all;
+}
+
+void QAndroidOffscreenView::reallocateBitmaps(const QSize & bitmapsize)
+{
+	QMutexLocker locker(&bitmaps_mutex_);
+	const QSize oldsize = bitmap_a_.size();
+	// Java may keep painting into the old bitmaps until setBitmaps() returns,
+	// so they may go to the pool only after that.
+	QJniObject old_a = bitmap_a_.releaseBitmap();
+	QJniObject old_b = bitmap_b_.releaseBitmap();
+	QJniObject old_c = bitmap_c_.releaseBitmap();
+	bitmap_a_.resize(bitmapsize);
+	bitmap_b_.resize(bitmapsize);
+	bitmap_c_.resize(bitmapsize);
+	bitmap_a_.fill(fill_color_, true);
+	bitmap_b_.fill(fill_color_, true);
+	bitmap_c_.fill(fill_color_, true);
+	last_qt_buffer_ = -1;
+	markBitmapsDamaged();
+	if (offscreen_view_)
 	{
-		return 0; // No previous buffer
+		passBitmapsToJava("setBitmaps");
 	}
-	return result;
+	QAndroidJniBitmapPool & pool = QAndroidJniBitmapPool::instance();
+	pool.put(std::move(old_a), oldsize, bitmap_a_.bitness());
+	pool.put(std::move(old_b), oldsize, bitmap_b_.bitness());
+	pool.put(std::move(old_c), oldsize, bitmap_c_.bitness());
+	qDebug() << __PRETTY_FUNCTION__ << viewObjectName() << oldsize << "->" << bitmapsize
+		<< "Pool: allocations avoided:" << pool.allocationsAvoided()
+		<< "missed:" << pool.allocationsMissed() << "pooled bytes:" << pool.pooledBytes();
+}
+
+void QAndroidOffscreenView::releaseBitmaps()
+{
+	QMutexLocker locker(&bitmaps_mutex_);
+	bitmap_buffer_crop_ = QImage();
+	const QSize size = bitmap_a_.size();
+	QAndroidJniBitmapPool & pool = QAndroidJniBitmapPool::instance();
+	pool.put(bitmap_a_.releaseBitmap(), size, bitmap_a_.bitness());
+	pool.put(bitmap_b_.releaseBitmap(), size, bitmap_b_.bitness());
+	pool.put(bitmap_c_.releaseBitmap(), size, bitmap_c_.bitness());
+}
+
+void QAndroidOffscreenView::shrinkOversizedBitmaps()
+{
+	QMutexLocker locker(&bitmaps_mutex_);
+	const QSize render_size = renderSize();
+	if (bitmapsAllocated() && bitmapsShouldShrink(bitmap_a_.size(), render_size))
+	{
+		qDebug() << __PRETTY_FUNCTION__ << viewObjectName() << bitmap_a_.size() << "->" << bitmapSizeForView(render_size);
+		reallocateBitmaps(bitmapSizeForView(render_size));
+		// Keep showing the current texture until the view is painted into the new bitmaps.
+		view_painted_ = false;
+		invalidate();
+	}
+}
+
+QAndroidOffscreenView::BitmapSlackPolicy QAndroidOffscreenView::bitmapSlackPolicy()
+{
+	return s_bitmap_slack_policy;
+}
+
+void QAndroidOffscreenView::setBitmapSlackPolicy(const BitmapSlackPolicy & policy)
+{
+	s_bitmap_slack_policy = policy;
 }
 
 // Protected version with some low-level functionality
 const QImage * QAndroidOffscreenView::getBitmapBuffer(
 	bool * out_texture_updated,
-	bool convert_from_android_format)
+	bool convert_from_android_format,
+	QRect * out_damage)
 {
 	QMutexLocker locker(&bitmaps_mutex_);
 	if (out_texture_updated)
 	{
 		*out_texture_updated = false;
 	}
-	if (bitmap_a_.isAllocated() && bitmap_b_.isAllocated()
-		&& view_painted_ && offscreen_view_ && offscreen_view_.jObject())
+	if (out_damage)
 	{
-		try
-		{
-			if (need_update_texture_ ||
-				(convert_from_android_format &&
-					(android_to_qt_buffer_.isNull() || android_to_qt_buffer_.size() != size())) ||
-				(!convert_from_android_format && last_qt_buffer_ < 0))
-			{
-				need_update_texture_ = false;
-				int buffer_index = offscreen_view_.callInt("getQtPaintingTexture");
-				if (buffer_index < 0)
-				{
-					return getPreviousBitmapBuffer(convert_from_android_format);
-				}
-				if (out_texture_updated)
-				{
-					*out_texture_updated = true;
-				}
-				last_texture_width_ = offscreen_view_.callInt("getLastTextureWidth");
-				last_texture_height_ = offscreen_view_.callInt("getLastTextureHeight");
+		*out_damage = QRect();
+	}
+	if (!bitmapsAllocated() || !view_painted_)
+	{
+		// qDebug()<<__PRETTY_FUNCTION__<<"Returning 0!";
+		return nullptr;  // No buffer created
+	}
 
-				// Updating texture
-				if (convert_from_android_format)
-				{
-					const QAndroidJniImagePair & pair = (buffer_index == 0)? bitmap_a_: bitmap_b_;
-					pair.convert32BitImageFromAndroidToQt(android_to_qt_buffer_);
-					return &android_to_qt_buffer_;
-				}
-				else
-				{
-					last_qt_buffer_ = buffer_index;
-					return (buffer_index == 0)? &bitmap_a_.qImage(): &bitmap_b_.qImage();
-				}
-			}
-			else
-			{
-				return getPreviousBitmapBuffer(convert_from_android_format);
-			}
+	// No JNI calls here: the latest frame is taken from the exchange buffer.
+	need_update_texture_ = false;
+	acquireBitmapBuffer();
+	if (last_qt_buffer_ < 0)
+	{
+		return nullptr; // Java has not painted anything yet
+	}
+
+	const QAndroidJniImagePair & pair = bitmap(last_qt_buffer_);
+	const bool copy_buffer = convert_from_android_format && !bitmap_buffer_zero_copy_;
+	// The raster buffer and the texture track changes separately as they are updated independently.
+	QRect & pending_damage = (convert_from_android_format)? qt_buffer_damage_: gl_texture_damage_;
+	if (copy_buffer && (android_to_qt_buffer_.isNull() || android_to_qt_buffer_.size() != pair.size()))
+	{
+		pending_damage = QRect(QPoint(0, 0), pair.size());
+	}
+	const QRect damage = pending_damage;
+	pending_damage = QRect();
+	if (!damage.isEmpty())
+	{
+		if (out_texture_updated)
+		{
+			*out_texture_updated = true;
 		}
-		catch (const std::exception & e)
+		if (out_damage)
 		{
-			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
-			return nullptr;
+			*out_damage = damage;
+		}
+		if (copy_buffer)
+		{
+			// Only the changed area is converted if the buffer already holds the previous image.
+			pair.convert32BitImageFromAndroidToQt(android_to_qt_buffer_, damage);
 		}
 	}
-	else
+
+	if (copy_buffer)
 	{
-		// qDebug()<<__PRETTY_FUNCTION__<<"Returning 0!";
-		return nullptr;  // No buffer created
+		return (android_to_qt_buffer_.isNull())? nullptr: &android_to_qt_buffer_;
 	}
+	return (convert_from_android_format)? &pair.rgbaQImage(): &pair.qImage();
 }
 
 bool QAndroidOffscreenView::updateBitmapToGlTexture()
 {
 	QMutexLocker locker(&bitmaps_mutex_);
 	bool updated_texture = true;
+	QRect damage;
 	// Get bitmap buffer in Android format (for 32 bits it is ABGR (in Qt) aka RGBA (in Android)).
 	// We don't need conversion to Qt format because GL can hangle Android formats directly.
-	const QImage * qtbuffer = getBitmapBuffer(&updated_texture, false);
+	const QImage * qtbuffer = getBitmapBuffer(&updated_texture, false, &damage);
 	if (qtbuffer && !qtbuffer->isNull())
 	{
-		if (updated_texture || !tex_.isAllocated())
+		if (!tex_.isAllocated())
 		{
 			tex_.allocateTexture(*qtbuffer, true);
 		}
-		return true; // Texture is correct
-	}
-	return false; // Texture contains no valid data
-}
-
-bool QAndroidOffscreenView::isCreated() const
-{
-	if (view_created_)
-	{
-		return true;
-	}
-	if (offscreen_view_)
-	{
-		try
+		else if (updated_texture && !damage.isEmpty())
 		{
-			bool result = const_cast<QAndroidOffscreenView*>(this)->offscreen_view_.callBool("isViewCreated");
-			if (result)
+			// Upload only the changed area into the existing texture: asynchronously via
+			// pixel buffer objects if possible, directly otherwise.
+			if (!tex_.streamTexture(*qtbuffer, damage, true)
+				&& !tex_.updateTexture(*qtbuffer, damage, true))
 			{
-				view_created_ = true;
+				tex_.allocateTexture(*qtbuffer, true);
 			}
-			return result;
 		}
-		catch (const std::exception & e)
+		if (tex_.isAllocated())
 		{
-			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+			// The view is painted into the top-left part of the bitmap (see BitmapSlackPolicy).
+			// Map the texture coordinates to it, flipping Y axis as the bitmap rows go top down.
+			const QSize content = bitmapContentSize();
+			const GLfloat fx = qMin(1.0f, GLfloat(content.width()) / GLfloat(qtbuffer->width()));
+			const GLfloat fy = qMin(1.0f, GLfloat(content.height()) / GLfloat(qtbuffer->height()));
+			tex_.setTransformation(
+				fx,   0.0f,
+				0.0f, -fy,
+				0.0f, fy);
 		}
+		return true; // Texture is correct
 	}
-	return false;
+	return false; // Texture contains no valid data
+}
+
+bool QAndroidOffscreenView::isCreated() const
+{
+	return view_created_;
 }
 
 bool QAndroidOffscreenView::hasValidImage() const
@@ -753,10 +1067,12 @@ void QAndroidOffscreenView::setFillColor(const QColor & color)
 			}
 			{
 				QMutexLocker locker(&bitmaps_mutex_);
-				if (bitmap_a_.isAllocated() && bitmap_b_.isAllocated())
+				if (bitmapsAllocated())
 				{
 					bitmap_a_.fill(fill_color_, true);
 					bitmap_b_.fill(fill_color_, true);
+					bitmap_c_.fill(fill_color_, true);
+					markBitmapsDamaged();
 					need_update_texture_ = true;
 					invalidate();
 				}
@@ -925,6 +1241,73 @@ void QAndroidOffscreenView::setHideKeyboardOnFocusLoss(bool hide)
 	}
 }
 
+void QAndroidOffscreenView::setCoalesceUpdates(bool coalesce)
+{
+	coalesce_updates_ = coalesce;
+	if (offscreen_view_)
+	{
+		try
+		{
+			offscreen_view_.callVoid("setCoalesceUpdates", jboolean(coalesce));
+		}
+		catch (const std::exception & e)
+		{
+			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+		}
+	}
+}
+
+void QAndroidOffscreenView::resetUpdateCounters()
+{
+	updates_received_ = 0;
+	updates_presented_ = 0;
+}
+
+qint64 QAndroidOffscreenView::firstFrameLatency() const
+{
+	const qint64 latency = first_frame_latency_ms_.load();
+	return (latency < 0)? -1: latency;
+}
+
+void QAndroidOffscreenView::restartFirstFrameMeasurement(bool pooled)
+{
+	// Read by javaUpdate() in Android UI thread after it sees the latency reset to -1,
+	// so the other values must be stored first.
+	taken_from_pool_ = pooled;
+	first_frame_start_ms_ = uptimeMillis();
+	if (pooled && view_painted_)
+	{
+		// The pooled view has painted at its current size (resize() resets the flag), so the
+		// frame is there already and Java may not paint again until the content changes.
+		first_frame_latency_ms_ = 0;
+		QAndroidOffscreenViewPool::reportFirstFrameLatency(true, 0);
+		return;
+	}
+	first_frame_latency_ms_ = -1;
+}
+
+void QAndroidOffscreenView::suspendFirstFrameMeasurement()
+{
+	first_frame_latency_ms_ = -2;
+}
+
+void QAndroidOffscreenView::setViewObjectName(const QString & name)
+{
+	view_object_name_ = name;
+	setObjectName(name);
+	try
+	{
+		if (offscreen_view_)
+		{
+			offscreen_view_.callVoid("SetObjectName", view_object_name_);
+		}
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+}
+
 void QAndroidOffscreenView::setShowKeyboardOnFocusIn(bool show)
 {
 	if (offscreen_view_)
@@ -939,11 +1322,29 @@ void QAndroidOffscreenView::setShowKeyboardOnFocusIn(bool show)
 		}
 	}
 }
-void QAndroidOffscreenView::javaUpdate()
+void QAndroidOffscreenView::javaUpdate(int left, int top, int right, int bottom, int frames, float scale)
 {
-	// qDebug()<<__PRETTY_FUNCTION__<<view_object_name_;
+	// qDebug()<<__PRETTY_FUNCTION__<<view_object_name_<<left<<top<<right<<bottom<<frames;
+	updates_received_ += static_cast<quint64>(qMax(frames, 1));
+	++updates_presented_;
+	qint64 waiting_for_first_frame = -1;
+	const qint64 latency = uptimeMillis() - first_frame_start_ms_.load();
+	if (first_frame_latency_ms_.compare_exchange_strong(waiting_for_first_frame, latency))
+	{
+		QAndroidOffscreenViewPool::reportFirstFrameLatency(taken_from_pool_, latency);
+	}
 	need_update_texture_ = true;
 	view_painted_ = true;
+	QRect damage(left, top, right - left, bottom - top);
+	// Java reports the damage in texture pixels together with the scale the frame was
+	// painted with: render_scale_ belongs to the Qt thread and may be changing right now.
+	if (scale > 0.0f && scale != 1.0f)
+	{
+		damage = QRect(
+			QPoint(static_cast<int>(left / scale), static_cast<int>(top / scale))
+			, QPoint(static_cast<int>(std::ceil(right / scale)) - 1, static_cast<int>(std::ceil(bottom / scale)) - 1));
+	}
+	emit damaged(damage);
 	emit updated();
 }
 
@@ -953,6 +1354,22 @@ void QAndroidOffscreenView::javaViewCreated()
 	emit viewCreated();
 }
 
+void QAndroidOffscreenView::javaViewStateChanged(int scroll_x, int scroll_y, int measured_width, int measured_height)
+{
+	const bool scroll_changed = (scroll_x_.exchange(scroll_x) != scroll_x) | (scroll_y_.exchange(scroll_y) != scroll_y);
+	const bool size_changed = (measured_width_.exchange(measured_width) != measured_width) | (measured_height_.exchange(measured_height) != measured_height);
+	// Called in Android UI thread: the values are available right away, the signals
+	// are delivered in the thread of this object.
+	if (scroll_changed)
+	{
+		QMetaObject::invokeMethod(this, "scrollChanged", Qt::QueuedConnection, Q_ARG(int, scroll_x), Q_ARG(int, scroll_y));
+	}
+	if (size_changed)
+	{
+		QMetaObject::invokeMethod(this, "measuredSizeChanged", Qt::QueuedConnection, Q_ARG(int, measured_width), Q_ARG(int, measured_height));
+	}
+}
+
 void QAndroidOffscreenView::javaVisibleRectReceived(int left, int top, int right, int bottom)
 {
 	int width = right - left, height = bottom - top;
@@ -1026,70 +1443,122 @@ QJniHelpers::QJniObject QAndroidOffscreenView::getView()
 
 void QAndroidOffscreenView::mouse(int android_action, int x, int y, long long timestamp_uptime_millis)
 {
-	if (offscreen_view_)
+	touch(android_action, QVector<TouchPoint>{TouchPoint{0, x, y}}, 0, timestamp_uptime_millis);
+}
+
+static inline void appendRaw(QByteArray & data, const void * value, int size)
+{
+	data.append(static_cast<const char *>(value), size);
+}
+
+void QAndroidOffscreenView::queueTouchEvent(int android_action, const QVector<TouchPoint> & points, int action_pointer_id, long long timestamp_uptime_millis)
+{
+	const int32_t header[2] = { int32_t(android_action), int32_t(action_pointer_id) };
+	// Queued moves would get the same time on Java side, breaking velocity tracking.
+	const int64_t timestamp = (timestamp_uptime_millis)? timestamp_uptime_millis: uptimeMillis();
+	const int32_t count = points.size();
+	appendRaw(input_queue_, header, sizeof(header));
+	appendRaw(input_queue_, &timestamp, sizeof(timestamp));
+	appendRaw(input_queue_, &count, sizeof(count));
+	for (const TouchPoint & point : points)
+	{
+		const int32_t p[3] = { int32_t(point.id), int32_t(point.x), int32_t(point.y) };
+		appendRaw(input_queue_, p, sizeof(p));
+	}
+}
+
+void QAndroidOffscreenView::touch(int android_action, const QVector<TouchPoint> & points, int action_pointer_id, long long timestamp_uptime_millis)
+{
+	if (!offscreen_view_ || points.isEmpty())
 	{
-		try
-		{
-			offscreen_view_.callParamVoid(
-				"ProcessMouseEvent",
-				"IIIJ",
-				jint(android_action),
-				jint(x),
-				jint(y),
-				jlong(timestamp_uptime_millis));
-		}
-		catch (const std::exception & e)
-		{
-			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
-		}
+		return;
+	}
+	if (points.size() > 32)
+	{
+		qWarning() << __PRETTY_FUNCTION__ << "Too many touch points:" << points.size();
+		return;
+	}
+	queueTouchEvent(android_action, points, action_pointer_id, timestamp_uptime_millis);
+	if (android_action != ANDROID_MOTIONEVENT_ACTION_MOVE || input_batch_interval_ms_ < 0)
+	{
+		flushInputEvents();
+	}
+	else if (!input_flush_timer_.isActive())
+	{
+		input_flush_timer_.start(input_batch_interval_ms_);
 	}
 }
 
-void QAndroidOffscreenView::requestVisibleRect()
+void QAndroidOffscreenView::setInputBatchInterval(int ms)
 {
-	if (offscreen_view_)
+	input_batch_interval_ms_ = ms;
+	if (ms < 0)
 	{
-		try
-		{
-			offscreen_view_.callVoid("queryVisibleRect");
-		}
-		catch (const std::exception & e)
-		{
-			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
-		}
+		flushInputEvents();
 	}
 }
 
-int QAndroidOffscreenView::getScrollX()
+void QAndroidOffscreenView::flushInputEvents()
 {
+	input_flush_timer_.stop();
+	if (input_queue_.isEmpty())
+	{
+		return;
+	}
 	if (offscreen_view_)
 	{
 		try
 		{
-			return offscreen_view_.callInt("getScrollX");
+			// Java decodes the buffer before returning from ProcessTouchEvents(), so it is safe
+			// to wrap our own memory into the direct buffer.
+			QJniEnvPtr jep;
+			QJniLocalRef buffer(jep, jep.env()->NewDirectByteBuffer(
+				input_queue_.data(),
+				static_cast<jlong>(input_queue_.size())));
+			if (jep.clearException() || !buffer.jObject())
+			{
+				qCritical() << "Failed to create a direct buffer for touch events";
+			}
+			else
+			{
+				offscreen_view_.callParamVoid(
+					"ProcessTouchEvents",
+					"Ljava/nio/ByteBuffer;I",
+					buffer.jObject(),
+					jint(input_queue_.size()));
+			}
 		}
 		catch (const std::exception & e)
 		{
 			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
 		}
 	}
-	return 0; // No scroll yet
+	input_queue_.resize(0); // Keeps the capacity
 }
 
-int QAndroidOffscreenView::getScrollY()
+void QAndroidOffscreenView::requestVisibleRect()
 {
 	if (offscreen_view_)
 	{
 		try
 		{
-			return offscreen_view_.callInt("getScrollY");
+			offscreen_view_.callVoid("queryVisibleRect");
 		}
 		catch (const std::exception & e)
 		{
 			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
 		}
 	}
-	return 0; // No scroll yet
+}
+
+int QAndroidOffscreenView::getScrollX() const
+{
+	return scroll_x_.load(std::memory_order_relaxed);
+}
+
+int QAndroidOffscreenView::getScrollY() const
+{
+	return scroll_y_.load(std::memory_order_relaxed);
 }
 
 void QAndroidOffscreenView::setScrollX(int x)
@@ -1104,6 +1573,11 @@ void QAndroidOffscreenView::setScrollX(int x)
 		{
 			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
 		}
+		// Java reports the actual position later, which may differ if the view clamps it.
+		if (scroll_x_.exchange(x) != x)
+		{
+			emit scrollChanged(x, scroll_y_.load());
+		}
 	}
 }
 
@@ -1119,39 +1593,57 @@ void QAndroidOffscreenView::setScrollY(int y)
 		{
 			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
 		}
+		// Java reports the actual position later, which may differ if the view clamps it.
+		if (scroll_y_.exchange(y) != y)
+		{
+			emit scrollChanged(scroll_x_.load(), y);
+		}
 	}
 }
 
-int QAndroidOffscreenView::getMeasuredWidth()
+void QAndroidOffscreenView::applyBatch(const QAndroidOffscreenViewBatch & batch)
 {
+	if (batch.isEmpty())
+	{
+		return;
+	}
 	if (offscreen_view_)
 	{
 		try
 		{
-			return offscreen_view_.callInt("getMeasuredWidth");
+			// Java decodes the buffer before returning from applyBatch(), so it is safe
+			// to wrap our own memory into the direct buffer.
+			QJniEnvPtr jep;
+			const QByteArray & data = batch.data();
+			QJniLocalRef buffer(jep, jep.env()->NewDirectByteBuffer(
+				const_cast<char *>(data.constData()),
+				static_cast<jlong>(data.size())));
+			if (jep.clearException() || !buffer.jObject())
+			{
+				qCritical() << "Failed to create a direct buffer for" << batch.commandCount() << "batched commands";
+				return;
+			}
+			offscreen_view_.callParamVoid(
+				"applyBatch",
+				"Ljava/nio/ByteBuffer;I",
+				buffer.jObject(),
+				jint(data.size()));
 		}
 		catch (const std::exception & e)
 		{
 			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
 		}
 	}
-	return -1;
 }
 
-int QAndroidOffscreenView::getMeasuredHeight()
+int QAndroidOffscreenView::getMeasuredWidth() const
 {
-	if (offscreen_view_)
-	{
-		try
-		{
-			return offscreen_view_.callInt("getMeasuredHeight");
-		}
-		catch (const std::exception & e)
-		{
-			qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
-		}
-	}
-	return -1;
+	return measured_width_.load(std::memory_order_relaxed);
+}
+
+int QAndroidOffscreenView::getMeasuredHeight() const
+{
+	return measured_height_.load(std::memory_order_relaxed);
 }
 
 void QAndroidOffscreenView::resize(const QSize & newsize)
@@ -1173,27 +1665,7 @@ void QAndroidOffscreenView::resize(const QSize & newsize)
 			qDebug() << __PRETTY_FUNCTION__ << "Apply resize:" << size_
 				<< "->" << newsize << "->" << size;
 			size_ = size;
-			{
-				QMutexLocker locker(&bitmaps_mutex_);
-				if (bitmap_a_.isAllocated())
-				{
-					QSize bitmapsize = (s_have_to_adjust_size_to_pot)
-						? potSize(size_, s_max_gl_size)
-						: size_;
-					bitmap_a_.resize(bitmapsize);
-					bitmap_b_.resize(bitmapsize);
-					bitmap_a_.fill(fill_color_, true);
-					bitmap_b_.fill(fill_color_, true);
-					last_qt_buffer_ = -1;
-					if (offscreen_view_)
-					{
-						offscreen_view_.callParamVoid("setBitmaps",
-							"Landroid/graphics/Bitmap;Landroid/graphics/Bitmap;",
-							bitmap_a_.jbitmap(), bitmap_b_.jbitmap());
-						//QMetaObject::invokeMethod(this, "invalidate", Qt::QueuedConnection);
-					}
-				}
-			}
+			fitBitmapsToRenderSize();
 			if (offscreen_view_)
 			{
 				// The view texture is now contains wrongly sized image and should not be used
@@ -1205,7 +1677,11 @@ void QAndroidOffscreenView::resize(const QSize & newsize)
 					jint(size.width()),
 					jint(size.height()));
 			}
-			tex_.setTextureSize(size);
+			if (!bitmap_a_.isAllocated())
+			{
+				// In Bitmap mode the texture has the size of the bitmaps, see updateBitmapToGlTexture().
+				tex_.setTextureSize(renderSize());
+			}
 		}
 		catch (const std::exception & e)
 		{
@@ -1214,6 +1690,85 @@ void QAndroidOffscreenView::resize(const QSize & newsize)
 	}
 }
 
+QSize QAndroidOffscreenView::renderSize() const
+{
+	if (render_scale_ == 1.0f)
+	{
+		return size_;
+	}
+	// Must give the same result as OffscreenView.scaledSize().
+	return QSize(
+		qMax(1, static_cast<int>(std::ceil(size_.width() * render_scale_)))
+		, qMax(1, static_cast<int>(std::ceil(size_.height() * render_scale_))));
+}
+
+QSize QAndroidOffscreenView::unscaledSize(const QSize & render_size) const
+{
+	if (render_scale_ == 1.0f)
+	{
+		return render_size;
+	}
+	return QSize(qRound(render_size.width() / render_scale_), qRound(render_size.height() / render_scale_));
+}
+
+void QAndroidOffscreenView::fitBitmapsToRenderSize()
+{
+	QMutexLocker locker(&bitmaps_mutex_);
+	if (!bitmap_a_.isAllocated())
+	{
+		return;
+	}
+	const QSize render_size = renderSize();
+	const QSize bitmapsize = bitmap_a_.size();
+	if (bitmapsize.width() >= render_size.width() && bitmapsize.height() >= render_size.height())
+	{
+		// The view still fits into the bitmaps, so keep them: Java repaints the view
+		// at the new size. Shrink them only if the view stays small for a while.
+		if (bitmapsShouldShrink(bitmapsize, render_size))
+		{
+			bitmap_shrink_timer_.start(qMax(0, s_bitmap_slack_policy.shrink_delay_ms));
+		}
+		else
+		{
+			bitmap_shrink_timer_.stop();
+		}
+	}
+	else
+	{
+		bitmap_shrink_timer_.stop();
+		reallocateBitmaps(bitmapSizeForView(render_size));
+	}
+}
+
+void QAndroidOffscreenView::setRenderScale(float scale)
+{
+	scale = qBound(0.05f, scale, 1.0f);
+	if (scale == render_scale_)
+	{
+		return;
+	}
+	qDebug() << __PRETTY_FUNCTION__ << viewObjectName() << render_scale_ << "->" << scale;
+	render_scale_ = scale;
+	try
+	{
+		fitBitmapsToRenderSize();
+		if (offscreen_view_)
+		{
+			// Keep showing the current image until the view is painted at the new scale.
+			view_painted_ = false;
+			offscreen_view_.callParamVoid("setRenderScale", "F", jfloat(scale));
+		}
+		if (!bitmap_a_.isAllocated())
+		{
+			tex_.setTextureSize(renderSize());
+		}
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+}
+
 void QAndroidOffscreenView::setSoftInputModeResize()
 {
 	if (offscreen_view_)
@@ -36,15 +36,20 @@
 
 #pragma once
 #include <atomic>
+#include <stdint.h>
 #include <QtGui/QColor>
 #include <QtCore/QSize>
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
 #include <QtCore/QRect>
 #include <QtCore/QScopedPointer>
 #include <QtCore/QMutex>
+#include <QtCore/QTimer>
 #include <QJniHelpers/QJniHelpers.h>
 #include "QAndroidJniImagePair.h"
 #include "QOpenGLTextureHolder.h"
 #include "QApplicationActivityObserver.h"
+#include "QAndroidOffscreenViewBatch.h"
 
 /*!
  * A general wrapper for Android offscreen views.f
@@ -58,6 +63,14 @@ class QAndroidOffscreenView: public QObject
 	Q_PROPERTY(QColor fillColor READ fillColor WRITE setFillColor)
 	Q_PROPERTY(bool visible READ visible WRITE setVisible)
 	Q_PROPERTY(bool enabled READ enabled WRITE setEnabled)
+	Q_PROPERTY(bool bitmapBufferZeroCopy READ bitmapBufferZeroCopy WRITE setBitmapBufferZeroCopy)
+	Q_PROPERTY(bool coalesceUpdates READ coalesceUpdates WRITE setCoalesceUpdates)
+	Q_PROPERTY(float renderScale READ renderScale WRITE setRenderScale)
+	Q_PROPERTY(bool created READ isCreated NOTIFY viewCreated)
+	Q_PROPERTY(int scrollX READ getScrollX WRITE setScrollX NOTIFY scrollChanged)
+	Q_PROPERTY(int scrollY READ getScrollY WRITE setScrollY NOTIFY scrollChanged)
+	Q_PROPERTY(int measuredWidth READ getMeasuredWidth NOTIFY measuredSizeChanged)
+	Q_PROPERTY(int measuredHeight READ getMeasuredHeight NOTIFY measuredSizeChanged)
 protected:
 	/*!
 	 * \param classname - name of Java class of the View wrapper.
@@ -129,6 +142,13 @@ public:
 	 */
 	virtual void paintGL(int l, int b, int w, int h, bool reverse_y);
 
+	/*!
+	 * True if the view composes its image itself (e.g. WebView in tiled mode), so it
+	 * has to be drawn with paintGL() and the texture holder and bitmap buffer don't
+	 * contain the image.
+	 */
+	virtual bool requiresPaintGL() const { return false; }
+
 	/*!
 	 * Makes sure that the GL texture holder contains actual image, if possible.
 	 * This function should only be called if \ref getGLTextureHolder() is used to access
@@ -145,6 +165,15 @@ public:
 	 */
 	const QOpenGLTextureHolder & getGLTextureHolder() const { return tex_; }
 
+	/*!
+	 * Same as paintGL(), but instead of drawing the view adds its texture to the batch,
+	 * so screens with many views can draw all of them with one QOpenGLTextureBatch::draw().
+	 * \param target_rect - view position in the batch viewport, Y axis going down.
+	 * \return false if the view has no image to show yet; the caller should fill
+	 *  target_rect with fillColor() then.
+	 */
+	bool addToTextureBatch(QOpenGLTextureBatch & batch, const QRect & target_rect, bool reverse_y = false);
+
 	/*!
 	 * Used in Bitmap mode. Instead of paintGL(), get current bitmap buffer
 	 * using getBitmapBuffer() and paint it by yourself.
@@ -155,9 +184,40 @@ public:
 	 * \param out_texture_updated: the bool value is set to true/false to indicate
 	 *  that the image has been actually changed since the last call to getBitmapBuffer().
 	 *  This can be used, for example, to avoid reloading the bitmap into GL texture.
+	 * \note By default the image is a converted copy in QImage::Format_ARGB32_Premultiplied.
+	 *  In zero-copy mode (see setBitmapBufferZeroCopy()) it has
+	 *  QImage::Format_RGBA8888_Premultiplied and refers directly to the Android bitmap.
 	 */
 	const QImage * getBitmapBuffer(bool * out_texture_updated = 0);
 
+	/*!
+	 * If true, getBitmapBuffer() returns the Android bitmap itself (as an RGBA QImage)
+	 * instead of converting it into an intermediate ARGB buffer on every frame.
+	 * Enable it if the consumer can paint Format_RGBA8888_Premultiplied images
+	 * (e.g. QPainter) to save the conversion. Default: false.
+	 */
+	bool bitmapBufferZeroCopy() const { return bitmap_buffer_zero_copy_; }
+	void setBitmapBufferZeroCopy(bool zero_copy);
+
+	/*!
+	 * Allocation policy for the bitmaps in Bitmap mode. The bitmaps may be larger than the view,
+	 * which is then rendered into their top-left part, so small resizes (e.g. animated layout
+	 * transitions) don't reallocate them. Released bitmaps go to QAndroidJniBitmapPool.
+	 */
+	struct BitmapSlackPolicy
+	{
+		//! Bitmap width and height are rounded up to a multiple of this (size buckets).
+		int granularity = 64;
+		//! Extra space, in percent of the view size, added when the bitmaps have to grow.
+		int slack_percent = 10;
+		//! The bitmaps are shrunk when the view covers less than this percent of their area...
+		int shrink_percent = 50;
+		//! ...for this long, in milliseconds.
+		int shrink_delay_ms = 1000;
+	};
+	static BitmapSlackPolicy bitmapSlackPolicy();
+	static void setBitmapSlackPolicy(const BitmapSlackPolicy & policy);
+
 	//! Check if Android View already exists.
 	bool isCreated() const;
 
@@ -166,6 +226,18 @@ public:
 
 	QSize size() const { return size_; }
 	virtual void resize(const QSize & newsize);
+
+	/*!
+	 * Render the view at a reduced resolution, e.g. 0.5 or 0.25 for thumbnails and previews.
+	 * Java draws into a texture / bitmaps of renderSize() and paintGL() scales the image up
+	 * to size(). The Android view keeps its layout size, so its contents and the coordinates
+	 * of mouse() events are the same as with scale 1. Scale is bounded to [0.05, 1].
+	 */
+	float renderScale() const { return render_scale_; }
+	void setRenderScale(float scale);
+
+	//! Size of the image rendered by Java: size() multiplied by renderScale() and rounded up.
+	QSize renderSize() const;
 	QColor fillColor() const { return fill_color_; }
 	virtual void setFillColor(const QColor & color);
 
@@ -253,17 +325,44 @@ public:
 	 */
 	void setShowKeyboardOnFocusIn(bool show);
 
+	/*!
+	 * When enabled (default), the view notifies about its changes (damaged() / updated())
+	 * at most once per display frame, with the union of the areas changed during the frame,
+	 * no matter how often the Android View repaints itself. The frame is driven by Android
+	 * Choreographer (vsync) on the Android UI thread.
+	 */
+	bool coalesceUpdates() const { return coalesce_updates_; }
+	void setCoalesceUpdates(bool coalesce);
+
+	//! Number of frames painted by the Android View since creation or resetUpdateCounters().
+	quint64 updatesReceived() const { return updates_received_; }
+
+	//! Number of update notifications sent for them; less than updatesReceived() when coalescing.
+	quint64 updatesPresented() const { return updates_presented_; }
+
+	void resetUpdateCounters();
+
+	/*!
+	 * Time from construction of the view (or from taking it from QAndroidOffscreenViewPool)
+	 * to the first frame painted by the Android View, in milliseconds; -1 until then.
+	 */
+	qint64 firstFrameLatency() const;
+
 	//
 	// Handling of user input events
 	//
 	static const int
 		ANDROID_MOTIONEVENT_ACTION_DOWN = 0,
 		ANDROID_MOTIONEVENT_ACTION_UP = 1,
-		ANDROID_MOTIONEVENT_ACTION_MOVE = 2;
+		ANDROID_MOTIONEVENT_ACTION_MOVE = 2,
+		ANDROID_MOTIONEVENT_ACTION_CANCEL = 3,
+		ANDROID_MOTIONEVENT_ACTION_POINTER_DOWN = 5,
+		ANDROID_MOTIONEVENT_ACTION_POINTER_UP = 6;
 
 	/*!
 	 * Single-touch / mouse support.
 	 * Typically, this function is called from Qt mouse event handlers.
+	 * Same as touch() with one pointer with id 0.
 	 * \param android_action can be ANDROID_MOTIONEVENT_ACTION_DOWN, ANDROID_MOTIONEVENT_ACTION_UP,
 	 *  ANDROID_MOTIONEVENT_ACTION_MOVE.
 	 * \param timestamp_uptime_mills - this should be set either as a System.uptimeMillis() of the
@@ -275,22 +374,54 @@ public:
 	 */
 	void mouse(int android_action, int x, int y, long long timestamp_uptime_millis = 0);
 
-	//! Return the scrolled left position of this view.
-	int getScrollX();
+	struct TouchPoint
+	{
+		int id; //!< Pointer id, 0...31, stays the same while the pointer is down.
+		int x, y;
+	};
+
+	/*!
+	 * Multi-touch support.
+	 * Move events are queued and sent to Java with one JNI call per inputBatchInterval(),
+	 * where consecutive moves become one MotionEvent with historical samples. Other events
+	 * are sent immediately together with the moves queued before them, so their order is kept.
+	 * \param android_action - ANDROID_MOTIONEVENT_ACTION_*. ACTION_POINTER_DOWN / ACTION_POINTER_UP
+	 *  are used when a pointer goes down or up while another one is down.
+	 * \param points - all pointers which are down, including the one going down or up.
+	 * \param action_pointer_id - id of the pointer going down or up, for ACTION_POINTER_DOWN / UP.
+	 * \param timestamp_uptime_millis - see mouse(); if 0, the time the event is queued is used.
+	 */
+	void touch(int android_action, const QVector<TouchPoint> & points, int action_pointer_id = 0, long long timestamp_uptime_millis = 0);
+
+	/*!
+	 * How long move events may wait in the queue, in milliseconds (default 8, i.e. half of
+	 * a 60 Hz frame). 0 sends them on the next event loop iteration, a negative value
+	 * disables batching.
+	 */
+	int inputBatchInterval() const { return input_batch_interval_ms_; }
+	void setInputBatchInterval(int ms);
+
+	//! Return the scrolled left position of this view (as of the last painting).
+	int getScrollX() const;
 
-	//! Return the scrolled top position of this view.
-	int getScrollY();
+	//! Return the scrolled top position of this view (as of the last painting).
+	int getScrollY() const;
 
 	void setScrollX(int x);
 	void setScrollY(int y);
 
+	/*!
+	 * Execute all commands recorded in the batch with a single JNI call. On Java side,
+	 * the commands are run in one UI thread action and the view is invalidated once after that.
+	 * Use it instead of sequences of separate setter calls.
+	 */
+	void applyBatch(const QAndroidOffscreenViewBatch & batch);
+
 	//! Return the width measurement information for this view as computed by the most recent call to measure(int, int).
-	int getMeasuredWidth();
+	int getMeasuredWidth() const;
 
 	//! Return the height measurement information for this view as computed by the most recent call to measure(int, int).
-	int getMeasuredHeight();
-
-	//! \todo Add multi-touch support!
+	int getMeasuredHeight() const;
 
 	void setSoftInputModeResize();
 	void setSoftInputModeAdjustPan();
@@ -323,6 +454,9 @@ public slots:
 	 */
 	void requestVisibleRect();
 
+	//! Send queued touch events to Java now.
+	void flushInputEvents();
+
 
 signals:
 	/*!
@@ -331,6 +465,12 @@ signals:
 	 */
 	void updated();
 
+	/*!
+	 * Emitted right before updated() with the area of the view (in view coordinates)
+	 * which has changed since the previous update. Can be used for partial repaints.
+	 */
+	void damaged(const QRect & area);
+
 	/*!
 	 * Emitted when view has been actually created.
 	 */
@@ -341,16 +481,63 @@ signals:
 	 */
 	void visibleRectReceived(int width, int height);
 
+	//! Emitted when getScrollX() / getScrollY() change.
+	void scrollChanged(int x, int y);
+
+	//! Emitted when getMeasuredWidth() / getMeasuredHeight() change.
+	void measuredSizeChanged(int width, int height);
+
 private slots:
-	void javaUpdate();
+	void javaUpdate(int left, int top, int right, int bottom, int frames, float scale);
 	void javaViewCreated();
 	void javaVisibleRectReceived(int left, int top, int right, int bottom);
+	void shrinkOversizedBitmaps();
 
 private:
-	const QImage * getPreviousBitmapBuffer(bool convert_from_android_format);
+	/*!
+	 * Triple buffer exchange block for Bitmap mode. Shared with Java through a direct
+	 * ByteBuffer, the layout must match OffscreenView.OffscreenBitmapRenderingSurface.
+	 */
+	struct BitmapExchange
+	{
+		static const int32_t c_index_mask = 3;
+		static const int32_t c_fresh = 4;
+		//! Index of the latest bitmap published by Java, with c_fresh set until Qt takes it.
+		std::atomic<int32_t> state;
+		//! Per bitmap: damage left, top, right, bottom and painted view width, height.
+		int32_t frames[3][6];
+	};
+
+	QAndroidJniImagePair & bitmap(int index);
+	bool bitmapsAllocated() const;
+	//! Pass bitmaps and the exchange buffer to Java method 'method', or detach them if 'detach'.
+	void passBitmapsToJava(const char * method, bool detach = false);
+	//! Take the latest frame published by Java, if any. Never blocks.
+	bool acquireBitmapBuffer();
+	//! Size of the part of the bitmaps holding the latest frame.
+	QSize bitmapContentSize() const;
+	void markBitmapsDamaged();
+	//! Replace the bitmaps with ones of the new size and return the old ones to the pool.
+	void reallocateBitmaps(const QSize & bitmapsize);
+	//! Return the bitmaps to the pool (the Java side must not be using them).
+	void releaseBitmaps();
+	//! Reallocate or schedule shrinking of the bitmaps after renderSize() has changed.
+	void fitBitmapsToRenderSize();
+	//! View size of the image of the given size in the texture.
+	QSize unscaledSize(const QSize & render_size) const;
+	//! Called by Java when scroll position or measured size of the view change.
+	void javaViewStateChanged(int scroll_x, int scroll_y, int measured_width, int measured_height);
+	//! Append the event to input_queue_, see OffscreenView.ProcessTouchEvents() for the layout.
+	void queueTouchEvent(int android_action, const QVector<TouchPoint> & points, int action_pointer_id, long long timestamp_uptime_millis);
+	//! Used by QAndroidOffscreenViewPool when handing out a pre-created view.
+	void setViewObjectName(const QString & name);
+	//! Start measuring firstFrameLatency() from now, or report 0 if a pooled view has painted already.
+	void restartFirstFrameMeasurement(bool pooled);
+	//! Don't measure the latency while the view is waiting in QAndroidOffscreenViewPool.
+	void suspendFirstFrameMeasurement();
 
 protected:
-	const QImage * getBitmapBuffer(bool * out_texture_updated, bool convert_from_android_format);
+	const QImage * getBitmapBuffer(bool * out_texture_updated, bool convert_from_android_format, QRect * out_damage = nullptr);
 	bool updateGlTexture();
 	bool updateBitmapToGlTexture();
 	QJniHelpers::QJniObject & offscreenView() { return offscreen_view_; }
@@ -364,17 +551,36 @@ private:
 	QOpenGLTextureHolder tex_;
 
 	//! Intermediate buffer used in Bitmap mode to convert Android's BGR to RGB.
+	//! Stays empty in zero-copy mode.
 	QImage android_to_qt_buffer_;
+	//! Part of the buffer returned by public getBitmapBuffer() when the bitmap has slack.
+	QImage bitmap_buffer_crop_;
 	int last_qt_buffer_;
+	bool bitmap_buffer_zero_copy_;
 
-	//! Double buffer for Bitmap mode.
-	QAndroidJniImagePair bitmap_a_, bitmap_b_;
+	//! Triple buffer for Bitmap mode.
+	QAndroidJniImagePair bitmap_a_, bitmap_b_, bitmap_c_;
+	BitmapExchange bitmap_exchange_;
+	//! Index of the bitmap owned by Qt side.
+	int qt_bitmap_;
 
-	//! Used to lock bitmap_a_/bitmap_b_ access.
+	//! Bitmap areas changed since the last update of the raster buffer / tex_.
+	QRect qt_buffer_damage_, gl_texture_damage_;
+
+	//! Used to lock bitmap access between Qt threads, and to resize / dispose the bitmaps.
 	QRecursiveMutex bitmaps_mutex_;
+	//! Delays shrinking of the bitmaps after the view has become smaller.
+	QTimer bitmap_shrink_timer_;
+
+	//! Touch events waiting to be sent to Java.
+	QByteArray input_queue_;
+	QTimer input_flush_timer_;
+	int input_batch_interval_ms_;
 
 	QJniHelpers::QJniObject offscreen_view_;
 	QSize size_;
+	//! Qt thread only: Java reports the scale of each painted frame with its damage.
+	float render_scale_;
 	QColor fill_color_;
 	std::atomic<bool> need_update_texture_;
 	std::atomic<bool> view_painted_;
@@ -382,13 +588,26 @@ private:
 	bool view_creation_requested_;
 	bool is_visible_;
 	bool is_enabled_;
-	mutable std::atomic<bool> view_created_; //!< Cache for isCreated()
+	std::atomic<bool> view_created_;
+	//! View state mirrored from Java by javaViewStateChanged(), so the getters don't need JNI calls.
+	std::atomic<int> scroll_x_, scroll_y_, measured_width_, measured_height_;
 	int last_texture_width_, last_texture_height_;
+	bool coalesce_updates_;
+	std::atomic<quint64> updates_received_;
+	std::atomic<quint64> updates_presented_;
+	//! See firstFrameLatency(). The latency is -1 while waiting for the first frame, -2 if not measured.
+	std::atomic<long long> first_frame_start_ms_;
+	std::atomic<qint64> first_frame_latency_ms_;
+	std::atomic<bool> taken_from_pool_;
 private:
 	Q_DISABLE_COPY(QAndroidOffscreenView)
-	friend void JNICALL Java_OffscreenView_nativeUpdate(JNIEnv * env, jobject jo, jlong param);
+	friend void JNICALL Java_OffscreenView_nativeUpdate(JNIEnv * env, jobject jo, jlong param, int left, int top, int right, int bottom, int frames, jfloat scale);
 	friend void JNICALL Java_OffscreenView_nativeViewCreated(JNIEnv *, jobject, jlong param);
 	friend void JNICALL Java_OffscreenView_onVisibleRect(JNIEnv *, jobject, jlong param, int left, int top, int right, int bottom);
+	friend void JNICALL Java_OffscreenView_nativeViewStateChanged(JNIEnv *, jobject, jlong param, jint scroll_x, jint scroll_y, jint measured_width, jint measured_height);
+	friend jint JNICALL Java_OffscreenView_nativeExchangeBitmap(JNIEnv * env, jclass, jobject exchange, jint value);
+	friend jint JNICALL Java_OffscreenView_nativeLoadExchange(JNIEnv * env, jclass, jobject exchange);
+	friend class QAndroidOffscreenViewPool;
 };
 
 int QColorToAndroidColor(const QColor & color);
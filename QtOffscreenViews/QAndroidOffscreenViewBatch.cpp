@@ -0,0 +1,92 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdint.h>
+#include "QAndroidOffscreenViewBatch.h"
+
+
+QAndroidOffscreenViewBatch & QAndroidOffscreenViewBatch::setScrollX(int x)
+{
+	appendOpcode(OpSetScrollX);
+	appendInt(x);
+	return *this;
+}
+
+QAndroidOffscreenViewBatch & QAndroidOffscreenViewBatch::setScrollY(int y)
+{
+	appendOpcode(OpSetScrollY);
+	appendInt(y);
+	return *this;
+}
+
+QAndroidOffscreenViewBatch & QAndroidOffscreenViewBatch::setPosition(int left, int top)
+{
+	appendOpcode(OpSetPosition);
+	appendInt(left);
+	appendInt(top);
+	return *this;
+}
+
+void QAndroidOffscreenViewBatch::clear()
+{
+	data_.clear();
+	command_count_ = 0;
+}
+
+void QAndroidOffscreenViewBatch::appendOpcode(int opcode)
+{
+	appendInt(opcode);
+	++command_count_;
+}
+
+void QAndroidOffscreenViewBatch::appendInt(int value)
+{
+	const int32_t v = static_cast<int32_t>(value);
+	data_.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+void QAndroidOffscreenViewBatch::appendFloat(float value)
+{
+	static_assert(sizeof(float) == 4, "Java float is 32-bit");
+	data_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void QAndroidOffscreenViewBatch::appendString(const QString & value)
+{
+	// QChar is a UTF-16 code unit, just like Java char.
+	appendInt(value.size());
+	data_.append(reinterpret_cast<const char *>(value.utf16()), value.size() * int(sizeof(ushort)));
+}
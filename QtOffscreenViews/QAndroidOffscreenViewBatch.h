@@ -0,0 +1,83 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+/*!
+ * Compact command buffer recording a sequence of calls to an offscreen view.
+ * The whole buffer is passed to Java with QAndroidOffscreenView::applyBatch()
+ * in one JNI call, and Java executes all commands in one UI thread action followed
+ * by a single invalidation of the view.
+ * Commands are stored as a 32-bit opcode followed by its arguments in native byte order:
+ * ints and floats are 4 bytes, strings are a 32-bit length followed by UTF-16 code units.
+ * Opcodes must match BATCH_OP_* constants in OffscreenView.java and its subclasses.
+ */
+class QAndroidOffscreenViewBatch
+{
+public:
+	enum Opcode
+	{
+		OpSetScrollX = 1,
+		OpSetScrollY = 2,
+		OpSetPosition = 3,
+		//! First opcode available for subclass-specific commands.
+		OpUser = 100
+	};
+
+	QAndroidOffscreenViewBatch() {}
+	virtual ~QAndroidOffscreenViewBatch() {}
+
+	QAndroidOffscreenViewBatch & setScrollX(int x);
+	QAndroidOffscreenViewBatch & setScrollY(int y);
+	QAndroidOffscreenViewBatch & setPosition(int left, int top);
+
+	bool isEmpty() const { return data_.isEmpty(); }
+	int commandCount() const { return command_count_; }
+	const QByteArray & data() const { return data_; }
+	void clear();
+
+protected:
+	void appendOpcode(int opcode);
+	void appendInt(int value);
+	void appendFloat(float value);
+	void appendString(const QString & value);
+
+private:
+	QByteArray data_;
+	int command_count_ = 0;
+};
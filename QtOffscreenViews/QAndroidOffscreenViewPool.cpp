@@ -0,0 +1,274 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QPointer>
+#include "QAndroidOffscreenView.h"
+#include "QAndroidOffscreenViewPool.h"
+#include "QApplicationActivityObserver.h"
+
+
+namespace {
+
+const int c_default_max_pooled_views = 4;
+const int c_default_warm_up_interval_ms = 300;
+
+QMutex s_latency_mutex;
+QAndroidOffscreenViewPool::LatencyStatistics s_latency_pooled;
+QAndroidOffscreenViewPool::LatencyStatistics s_latency_direct;
+
+} // anonymous namespace
+
+
+QAndroidOffscreenViewPool & QAndroidOffscreenViewPool::instance()
+{
+	// Owned by the application, so the pooled views and the timer are destroyed together
+	// with it rather than during static destruction.
+	static QPointer<QAndroidOffscreenViewPool> s_pool;
+	if (s_pool.isNull())
+	{
+		s_pool = new QAndroidOffscreenViewPool(QCoreApplication::instance());
+	}
+	return *s_pool;
+}
+
+QAndroidOffscreenViewPool::QAndroidOffscreenViewPool(QObject * parent)
+	: QObject(parent)
+	, max_pooled_views_(c_default_max_pooled_views)
+	, shutting_down_(false)
+{
+	warm_up_timer_.setSingleShot(true);
+	warm_up_timer_.setInterval(c_default_warm_up_interval_ms);
+	connect(&warm_up_timer_, SIGNAL(timeout()), this, SLOT(warmUp()));
+	connect(
+		QApplicationActivityObserver::instance(),
+		SIGNAL(applicationActiveStateChanged()),
+		this,
+		SLOT(applicationActivityStatusChanged()));
+	if (QCoreApplication * app = QCoreApplication::instance())
+	{
+		// Java views should be released while JNI is still usable.
+		connect(app, SIGNAL(aboutToQuit()), this, SLOT(applicationAboutToQuit()));
+	}
+	else
+	{
+		qWarning() << __PRETTY_FUNCTION__ << "Created before QCoreApplication, pooled views will not be released on exit.";
+	}
+}
+
+QAndroidOffscreenViewPool::~QAndroidOffscreenViewPool()
+{
+	shutting_down_ = true;
+	clear();
+}
+
+void QAndroidOffscreenViewPool::setReserve(const QString & class_name, int count, const QSize & size, const Factory & factory)
+{
+	ClassPool & pool = pools_[class_name];
+	pool.factory = factory;
+	pool.reserve = qMax(0, count);
+	if (pool.size != size)
+	{
+		// Views of another size would be resized right after taking.
+		pool.size = size;
+		qDeleteAll(pool.views);
+		pool.views.clear();
+	}
+	trim();
+	scheduleWarmUp();
+}
+
+int QAndroidOffscreenViewPool::reserved(const QString & class_name) const
+{
+	const auto it = pools_.constFind(class_name);
+	return (it != pools_.constEnd())? it->reserve: 0;
+}
+
+int QAndroidOffscreenViewPool::available(const QString & class_name) const
+{
+	const auto it = pools_.constFind(class_name);
+	return (it != pools_.constEnd())? it->views.size(): 0;
+}
+
+void QAndroidOffscreenViewPool::setMaxPooledViews(int count)
+{
+	max_pooled_views_ = qMax(0, count);
+	trim();
+	scheduleWarmUp();
+}
+
+void QAndroidOffscreenViewPool::setWarmUpIntervalMs(int ms)
+{
+	warm_up_timer_.setInterval(qMax(0, ms));
+}
+
+int QAndroidOffscreenViewPool::pooledViewCount() const
+{
+	int count = 0;
+	for (const ClassPool & pool : pools_)
+	{
+		count += pool.views.size();
+	}
+	return count;
+}
+
+void QAndroidOffscreenViewPool::clear()
+{
+	warm_up_timer_.stop();
+	for (ClassPool & pool : pools_)
+	{
+		qDeleteAll(pool.views);
+		pool.views.clear();
+	}
+	scheduleWarmUp();
+}
+
+void QAndroidOffscreenViewPool::applicationAboutToQuit()
+{
+	shutting_down_ = true;
+	clear();
+}
+
+void QAndroidOffscreenViewPool::trim()
+{
+	int count = pooledViewCount();
+	for (ClassPool & pool : pools_)
+	{
+		while (!pool.views.isEmpty() && (pool.views.size() > pool.reserve || count > max_pooled_views_))
+		{
+			delete pool.views.takeLast();
+			--count;
+		}
+	}
+}
+
+void QAndroidOffscreenViewPool::scheduleWarmUp()
+{
+	if (warm_up_timer_.isActive()
+		|| shutting_down_
+		|| !QApplicationActivityObserver::instance()->isApplicationActive()
+		|| pooledViewCount() >= max_pooled_views_)
+	{
+		return;
+	}
+	for (const ClassPool & pool : pools_)
+	{
+		if (pool.views.size() < pool.reserve)
+		{
+			warm_up_timer_.start();
+			return;
+		}
+	}
+}
+
+void QAndroidOffscreenViewPool::warmUp()
+{
+	if (shutting_down_
+		|| !QApplicationActivityObserver::instance()->isApplicationActive()
+		|| pooledViewCount() >= max_pooled_views_)
+	{
+		return;
+	}
+	for (auto it = pools_.begin(); it != pools_.end(); ++it)
+	{
+		ClassPool & pool = it.value();
+		if (pool.views.size() < pool.reserve && pool.factory)
+		{
+			QAndroidOffscreenView * view = pool.factory(QStringLiteral("Pooled") + it.key(), pool.size);
+			view->suspendFirstFrameMeasurement();
+			pool.views.append(view);
+			qDebug() << __PRETTY_FUNCTION__ << "Created pooled" << it.key() << pool.views.size() << "/" << pool.reserve;
+			break;
+		}
+	}
+	scheduleWarmUp();
+}
+
+QAndroidOffscreenView * QAndroidOffscreenViewPool::takePooled(const QString & class_name, const QString & object_name, const QSize & size, QObject * parent)
+{
+	const auto it = pools_.find(class_name);
+	if (it == pools_.end() || it->views.isEmpty())
+	{
+		return nullptr;
+	}
+	// Prefer the oldest view: its Java view has most likely been created already.
+	QAndroidOffscreenView * view = it->views.takeFirst();
+	view->setViewObjectName(object_name);
+	view->setParent(parent);
+	view->resize(size);
+	view->restartFirstFrameMeasurement(true);
+	// Replace the view after the new owner has got it shown.
+	scheduleWarmUp();
+	return view;
+}
+
+void QAndroidOffscreenViewPool::applicationActivityStatusChanged()
+{
+	if (QApplicationActivityObserver::instance()->isApplicationActive())
+	{
+		scheduleWarmUp();
+	}
+	else
+	{
+		// Don't keep memory (and WebView processes) for the views while in background.
+		clear();
+	}
+}
+
+QAndroidOffscreenViewPool::LatencyStatistics QAndroidOffscreenViewPool::firstFrameLatency(bool pooled)
+{
+	QMutexLocker locker(&s_latency_mutex);
+	return (pooled)? s_latency_pooled: s_latency_direct;
+}
+
+void QAndroidOffscreenViewPool::resetLatencyStatistics()
+{
+	QMutexLocker locker(&s_latency_mutex);
+	s_latency_pooled = LatencyStatistics();
+	s_latency_direct = LatencyStatistics();
+}
+
+void QAndroidOffscreenViewPool::reportFirstFrameLatency(bool pooled, qint64 ms)
+{
+	QMutexLocker locker(&s_latency_mutex);
+	LatencyStatistics & stats = (pooled)? s_latency_pooled: s_latency_direct;
+	++stats.views;
+	stats.total_ms += ms;
+	stats.max_ms = qMax(stats.max_ms, ms);
+}
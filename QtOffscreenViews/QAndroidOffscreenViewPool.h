@@ -0,0 +1,170 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include <functional>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QObject>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+#include <QtCore/QTimer>
+
+class QAndroidOffscreenView;
+
+/*!
+ * Pool of pre-created offscreen views. Creating a view means constructing the Java
+ * view in Android UI thread, so it takes hundreds of milliseconds before a new view
+ * can show anything. The pool creates the reserved number of hidden views of each
+ * class at idle time, and take() hands them out instead of creating new ones.
+ *
+ * A taken view is in the same state as a just constructed one: only its object name,
+ * size and parent are set by take(). Views are never returned to the pool, so nothing
+ * is left over from a previous user. Pooled views are released when the application
+ * goes to background and are created again after it has become active.
+ *
+ * Nothing is reserved by default. The pool must be used from the GUI thread after
+ * QCoreApplication has been created, and is destroyed together with it.
+ */
+class QAndroidOffscreenViewPool
+	: public QObject
+{
+	Q_OBJECT
+public:
+	static QAndroidOffscreenViewPool & instance();
+
+	/*!
+	 * Keep \a count pre-created views of class View, which must have the same constructor
+	 * as QAndroidOffscreenWebView and QAndroidOffscreenEditText do. The views are created
+	 * with \a size, so use the size they are most likely to be shown with.
+	 */
+	template<class View>
+	void reserve(int count, const QSize & size)
+	{
+		setReserve(
+			QLatin1String(View::staticMetaObject.className()),
+			count,
+			size,
+			[](const QString & object_name, const QSize & def_size) -> QAndroidOffscreenView * {
+				return new View(object_name, def_size);
+			});
+	}
+
+	/*!
+	 * Take a pre-created view of class View, or create a new one if there is none.
+	 * The view is owned by the caller (or by \a parent).
+	 */
+	template<class View>
+	View * take(const QString & object_name, const QSize & size, QObject * parent = 0)
+	{
+		if (QAndroidOffscreenView * view = takePooled(QLatin1String(View::staticMetaObject.className()), object_name, size, parent))
+		{
+			return static_cast<View*>(view);
+		}
+		return new View(object_name, size, parent);
+	}
+
+	//! Number of views reserved for the class, see reserve().
+	int reserved(const QString & class_name) const;
+
+	//! Number of views of the class ready to be taken.
+	int available(const QString & class_name) const;
+
+	//! Limit for the number of pooled views of all classes together. Default: 4.
+	int maxPooledViews() const { return max_pooled_views_; }
+	void setMaxPooledViews(int count);
+
+	//! Delay between creation of pooled views, so they don't stall the GUI thread all at once.
+	int warmUpIntervalMs() const { return warm_up_timer_.interval(); }
+	void setWarmUpIntervalMs(int ms);
+
+	struct LatencyStatistics
+	{
+		//! Number of views which have painted their first frame.
+		int views = 0;
+		qint64 total_ms = 0;
+		qint64 max_ms = 0;
+
+		qint64 averageMs() const { return (views > 0)? total_ms / views: 0; }
+	};
+
+	/*!
+	 * Statistics of QAndroidOffscreenView::firstFrameLatency() for views taken
+	 * from the pool (\a pooled) or created directly.
+	 */
+	static LatencyStatistics firstFrameLatency(bool pooled);
+	static void resetLatencyStatistics();
+
+	//! Called by views when they have received the first frame. Thread safe.
+	static void reportFirstFrameLatency(bool pooled, qint64 ms);
+
+public slots:
+	//! Release all pooled views. Reserved views are created again at idle time.
+	void clear();
+
+private slots:
+	//! Create one missing view.
+	void warmUp();
+	void applicationActivityStatusChanged();
+	void applicationAboutToQuit();
+
+private:
+	typedef std::function<QAndroidOffscreenView * (const QString & object_name, const QSize & size)> Factory;
+
+	explicit QAndroidOffscreenViewPool(QObject * parent);
+	~QAndroidOffscreenViewPool();
+	void setReserve(const QString & class_name, int count, const QSize & size, const Factory & factory);
+	QAndroidOffscreenView * takePooled(const QString & class_name, const QString & object_name, const QSize & size, QObject * parent);
+	int pooledViewCount() const;
+	//! Start warm_up_timer_ if some views are missing.
+	void scheduleWarmUp();
+	//! Delete pooled views above the reserve and the limit.
+	void trim();
+
+	struct ClassPool
+	{
+		Factory factory;
+		int reserve = 0;
+		QSize size;
+		QList<QAndroidOffscreenView *> views;
+	};
+
+	QMap<QString, ClassPool> pools_;
+	int max_pooled_views_;
+	bool shutting_down_;
+	QTimer warm_up_timer_;
+	Q_DISABLE_COPY(QAndroidOffscreenViewPool)
+};
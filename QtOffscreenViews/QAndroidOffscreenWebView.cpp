@@ -34,7 +34,22 @@
   THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <algorithm>
+#include <limits>
+#include <QtCore/QCache>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMimeDatabase>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QResource>
+#include <QtCore/QUrl>
+#include <QtCore/QtMath>
 #include <QJniHelpers/QAndroidQPAPluginGap.h>
+#include "QAndroidJniBitmapPool.h"
 #include "QAndroidOffscreenWebView.h"
 
 using namespace QJniHelpers;
@@ -233,13 +248,143 @@ Q_DECL_EXPORT void JNICALL Java_onCanGoBackOrForwardReceived(JNIEnv *, jobject,
 	}
 }
 
+Q_DECL_EXPORT void JNICALL Java_onTileRendered(JNIEnv *, jobject, jlong nativeptr, jint x, jint y, jint request, jboolean ok)
+{
+	if (QAndroidOffscreenWebView * wv = AOWW(nativeptr))
+	{
+		wv->onTileRendered(x, y, request, ok);
+	}
+}
+
+Q_DECL_EXPORT void JNICALL Java_onTilesDamaged(JNIEnv *, jobject, jlong nativeptr, jint left, jint top, jint right, jint bottom)
+{
+	if (QAndroidOffscreenWebView * wv = AOWW(nativeptr))
+	{
+		wv->onTilesDamaged(QRect(QPoint(left, top), QPoint(right - 1, bottom - 1)));
+	}
+}
+
+Q_DECL_EXPORT void JNICALL Java_onTiledScrollChanged(JNIEnv *, jobject, jlong nativeptr, jint x, jint y)
+{
+	if (QAndroidOffscreenWebView * wv = AOWW(nativeptr))
+	{
+		wv->onTiledScrollChanged(x, y);
+	}
+}
+
+Q_DECL_EXPORT void JNICALL Java_onTiledContentHeight(JNIEnv *, jobject, jlong nativeptr, jint height)
+{
+	if (QAndroidOffscreenWebView * wv = AOWW(nativeptr))
+	{
+		wv->onTiledContentHeight(height);
+	}
+}
+
+// public static native void nativeReleaseResource(long handle);
+Q_DECL_EXPORT void JNICALL Java_nativeReleaseResource(JNIEnv *, jclass, jlong handle)
+{
+	// The data holder created by QAndroidOffscreenWebView::createResourceResponse().
+	delete reinterpret_cast<QByteArray *>(static_cast<intptr_t>(handle));
+}
+
+// public native long nativeAcquireResources(long nativeptr);
+Q_DECL_EXPORT jlong JNICALL Java_nativeAcquireResources(JNIEnv *, jobject, jlong nativeptr)
+{
+	// Called with nativePtrMutex() locked: only takes a reference to the tables, so the
+	// request can be served without the lock. Returns 0 if there is nothing to serve.
+	if (QAndroidOffscreenWebView * wv = AOWW(nativeptr))
+	{
+		{
+			QMutexLocker locker(&wv->resources_->mutex);
+			if (wv->resources_->mappings.isEmpty() && wv->resources_->data.isEmpty())
+			{
+				return 0;
+			}
+		}
+		return static_cast<jlong>(reinterpret_cast<intptr_t>(
+			new QSharedPointer<QAndroidOffscreenWebView::ResourceTable>(wv->resources_)));
+	}
+	return 0;
+}
+
+// public native WebResourceResponse nativeServeResource(long resources, String url);
+Q_DECL_EXPORT jobject JNICALL Java_nativeServeResource(JNIEnv * env, jobject jo, jlong resources, jobject url)
+{
+	if (resources)
+	{
+		QSharedPointer<QAndroidOffscreenWebView::ResourceTable> * table =
+			reinterpret_cast<QSharedPointer<QAndroidOffscreenWebView::ResourceTable> *>(static_cast<intptr_t>(resources));
+		return QAndroidOffscreenWebView::serveResource(env, jo, **table, url);
+	}
+	return 0;
+}
+
+// public static native void nativeReleaseResources(long resources);
+Q_DECL_EXPORT void JNICALL Java_nativeReleaseResources(JNIEnv *, jclass, jlong resources)
+{
+	delete reinterpret_cast<QSharedPointer<QAndroidOffscreenWebView::ResourceTable> *>(static_cast<intptr_t>(resources));
+}
+
+// public native void onChannelMessages(long nativeptr, String batch);
+Q_DECL_EXPORT void JNICALL Java_onChannelMessages(JNIEnv * env, jobject, jlong nativeptr, jobject batch)
+{
+	if (QAndroidOffscreenWebView * wv = AOWW(nativeptr))
+	{
+		wv->onChannelMessages(QJniEnvPtr(env).toQString(static_cast<jstring>(batch)));
+	}
+}
+
+// public native void onJavascriptResult(long nativeptr, int request, String result);
+Q_DECL_EXPORT void JNICALL Java_onJavascriptResult(JNIEnv * env, jobject, jlong nativeptr, jint request, jobject result)
+{
+	if (QAndroidOffscreenWebView * wv = AOWW(nativeptr))
+	{
+		wv->onJavascriptResult(request, QJniEnvPtr(env).toQString(static_cast<jstring>(result)));
+	}
+}
+
+//! Max. number of tiles being rendered by Java at once, so visible tiles don't wait behind prefetched ones.
+static const int c_max_tiles_in_flight = 4;
+
+//! Delay of WebView scroll position synchronization after the last contentOffset change.
+static const int c_scroll_sync_delay_ms = 150;
+
+//! Default interval of sending messages to the page, about a frame.
+static const int c_message_batch_interval_ms = 16;
+
+//! Max. number of sent binary messages which are kept until the page loads them.
+static const int c_max_channel_blobs = 256;
+
+//! URLs of binary messages; the host can't exist, so only shouldInterceptRequest() can serve them.
+//! The rest of the URL is random, so a page can't guess the URL of data meant for another one.
+static const char * const c_channel_blob_prefix = "https://qtchannel.invalid/blob/";
+
 QAndroidOffscreenWebView::QAndroidOffscreenWebView(
 		const QString & object_name,
 		const QSize & def_size,
 		QObject * parent)
 	: QAndroidOffscreenView(QLatin1String("OffscreenWebView"), object_name, def_size, parent)
 	, ignore_ssl_errors_(false)
+	, tiled_rendering_(false)
+	, tile_size_(256)
+	, tile_cache_budget_(24 * 1024 * 1024)
+	, tile_use_counter_(0)
+	, tile_request_counter_(0)
+	, content_height_(-1)
+	, resources_(new ResourceTable())
+	, message_channel_enabled_(false)
+	, javascript_request_counter_(0)
 {
+	resources_->owner = this;
+	scroll_sync_timer_.setSingleShot(true);
+	scroll_sync_timer_.setInterval(c_scroll_sync_delay_ms);
+	connect(&scroll_sync_timer_, SIGNAL(timeout()), this, SLOT(syncScrollToContentOffset()));
+
+	message_flush_timer_.setSingleShot(true);
+	message_flush_timer_.setInterval(c_message_batch_interval_ms);
+	connect(&message_flush_timer_, SIGNAL(timeout()), this, SLOT(flushMessages()));
+	channel_clock_.start();
+
 	try
 	{
 		if (QJniObject & ov = offscreenView())
@@ -270,7 +415,23 @@ QAndroidOffscreenWebView::QAndroidOffscreenWebView(
 				{"onContentHeightReceived", "(JI)V", reinterpret_cast<void*>(Java_onContentHeightReceived)},
 				{"onCanGoBackReceived", "(JZ)V", reinterpret_cast<void*>(Java_onCanGoBackReceived)},
 				{"onCanGoForwardReceived", "(JZ)V", reinterpret_cast<void*>(Java_onCanGoForwardReceived)},
-				{"onCanGoBackOrForwardReceived", "(JZI)V", reinterpret_cast<void*>(Java_onCanGoBackOrForwardReceived)}
+				{"onCanGoBackOrForwardReceived", "(JZI)V", reinterpret_cast<void*>(Java_onCanGoBackOrForwardReceived)},
+
+				// Tiled rendering
+				{"onTileRendered", "(JIIIZ)V", reinterpret_cast<void*>(Java_onTileRendered)},
+				{"onTilesDamaged", "(JIIII)V", reinterpret_cast<void*>(Java_onTilesDamaged)},
+				{"onTiledScrollChanged", "(JII)V", reinterpret_cast<void*>(Java_onTiledScrollChanged)},
+				{"onTiledContentHeight", "(JI)V", reinterpret_cast<void*>(Java_onTiledContentHeight)},
+
+				// Resource interception
+				{"nativeReleaseResource", "(J)V", reinterpret_cast<void*>(Java_nativeReleaseResource)},
+				{"nativeAcquireResources", "(J)J", reinterpret_cast<void*>(Java_nativeAcquireResources)},
+				{"nativeServeResource", "(JLjava/lang/String;)Landroid/webkit/WebResourceResponse;", reinterpret_cast<void*>(Java_nativeServeResource)},
+				{"nativeReleaseResources", "(J)V", reinterpret_cast<void*>(Java_nativeReleaseResources)},
+
+				// JavaScript message channel
+				{"onChannelMessages", "(JLjava/lang/String;)V", reinterpret_cast<void*>(Java_onChannelMessages)},
+				{"onJavascriptResult", "(JILjava/lang/String;)V", reinterpret_cast<void*>(Java_onJavascriptResult)}
 			});
 			if (!ok)
 			{
@@ -294,6 +455,10 @@ QAndroidOffscreenWebView::QAndroidOffscreenWebView(
 
 QAndroidOffscreenWebView::~QAndroidOffscreenWebView()
 {
+	// WebView threads may still be serving requests from the tables; they must not
+	// emit signals of a destroyed object.
+	QMutexLocker locker(&resources_->owner_mutex);
+	resources_->owner = nullptr;
 }
 
 void QAndroidOffscreenWebView::preloadJavaClasses()
@@ -647,6 +812,54 @@ jobject QAndroidOffscreenWebView::shouldInterceptRequest(JNIEnv *, jobject, jobj
 	return 0;
 }
 
+jobject QAndroidOffscreenWebView::serveResource(JNIEnv * env, jobject java_view, ResourceTable & table, jobject url)
+{
+	try
+	{
+		QElapsedTimer timer;
+		timer.start();
+		const QString url_string = QJniEnvPtr(env).toQString(static_cast<jstring>(url));
+		Resource resource;
+		bool matched = false, from_memory = false;
+		const bool found = findResource(table, url_string, resource, &matched, &from_memory);
+		if (!matched)
+		{
+			return 0;
+		}
+		const jobject response = (found)? createResourceResponse(env, java_view, resource): 0;
+		const qint64 bytes = (response)? resource.data.size(): 0;
+		const qint64 us = timer.nsecsElapsed() / 1000;
+		{
+			QMutexLocker locker(&table.mutex);
+			++table.statistics.requests;
+			if (response)
+			{
+				++table.statistics.served;
+				if (from_memory)
+				{
+					++table.statistics.served_from_memory;
+				}
+				table.statistics.bytes += static_cast<quint64>(bytes);
+			}
+			table.statistics.total_us += us;
+			table.statistics.max_us = qMax(table.statistics.max_us, us);
+		}
+		{
+			QMutexLocker locker(&table.owner_mutex);
+			if (table.owner)
+			{
+				emit table.owner->resourceRequested(url_string, response != 0, bytes, us);
+			}
+		}
+		return response;
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+	return 0;
+}
+
 jboolean QAndroidOffscreenWebView::shouldOverrideKeyEvent(JNIEnv *, jobject, jobject event)
 {
 	Q_UNUSED(event);
@@ -706,3 +919,1052 @@ void QAndroidOffscreenWebView::onCanGoBackOrForwardReceived(bool can, int steps)
 {
 	emit canGoBackOrForwardReceived(can, steps);
 }
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Tiled rendering
+/////////////////////////////////////////////////////////////////////////////
+
+void QAndroidOffscreenWebView::deinitialize()
+{
+	scroll_sync_timer_.stop();
+	message_flush_timer_.stop();
+	QAndroidOffscreenView::deinitialize();
+	{
+		QMutexLocker locker(&tiles_mutex_);
+		dropTiles();
+		// The Java view is gone, so nobody is rendering into these anymore.
+		tiles_in_flight_.clear();
+	}
+	for (const ChannelMessage & message : channel_queue_)
+	{
+		if (!message.blob_url.isEmpty())
+		{
+			removeResourceData(message.blob_url);
+		}
+	}
+	channel_queue_.clear();
+	for (const QString & url : channel_blobs_)
+	{
+		removeResourceData(url);
+	}
+	channel_blobs_.clear();
+	// Destroying the promises cancels the futures which would never get their results.
+	QMutexLocker locker(&channel_mutex_);
+	javascript_results_.clear();
+}
+
+void QAndroidOffscreenWebView::setTiledRendering(bool enable)
+{
+	if (enable == tiled_rendering_)
+	{
+		return;
+	}
+	{
+		QMutexLocker locker(&tiles_mutex_);
+		tiled_rendering_ = enable;
+		if (!enable)
+		{
+			dropTiles();
+		}
+	}
+	try
+	{
+		if (QJniObject & view = offscreenView())
+		{
+			view.callVoid("setTiledMode", static_cast<jboolean>(enable));
+		}
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+	emit updated();
+}
+
+void QAndroidOffscreenWebView::setTileSize(int size)
+{
+	size = qBound(16, size, 2048);
+	QMutexLocker locker(&tiles_mutex_);
+	if (size != tile_size_)
+	{
+		dropTiles();
+		tile_size_ = size;
+	}
+}
+
+void QAndroidOffscreenWebView::setTileCacheBudget(qint64 bytes)
+{
+	QMutexLocker locker(&tiles_mutex_);
+	tile_cache_budget_ = qMax<qint64>(0, bytes);
+}
+
+QPointF QAndroidOffscreenWebView::contentOffset() const
+{
+	QMutexLocker locker(&tiles_mutex_);
+	return content_offset_;
+}
+
+void QAndroidOffscreenWebView::setContentOffset(const QPointF & offset)
+{
+	QPointF bounded(qMax(0.0, offset.x()), qMax(0.0, offset.y()));
+	{
+		QMutexLocker locker(&tiles_mutex_);
+		if (content_height_ >= 0)
+		{
+			// Don't scroll past the end of the document.
+			bounded.setY(qMin(bounded.y(), static_cast<qreal>(qMax(0, content_height_ - size().height()))));
+		}
+		if (bounded == content_offset_)
+		{
+			return;
+		}
+		content_offset_ = bounded;
+	}
+	scroll_sync_timer_.start();
+	emit contentOffsetChanged(bounded);
+	emit updated();
+}
+
+void QAndroidOffscreenWebView::syncScrollToContentOffset()
+{
+	QPoint scroll;
+	{
+		QMutexLocker locker(&tiles_mutex_);
+		scroll = content_offset_.toPoint();
+		if (scroll == java_scroll_)
+		{
+			return;
+		}
+		java_scroll_ = scroll;
+	}
+	try
+	{
+		if (QJniObject & view = offscreenView())
+		{
+			view.callVoid("setScrollPosition", static_cast<jint>(scroll.x()), static_cast<jint>(scroll.y()));
+		}
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+}
+
+QAndroidOffscreenWebView::TileStatistics QAndroidOffscreenWebView::tileStatistics() const
+{
+	QMutexLocker locker(&tiles_mutex_);
+	return tile_statistics_;
+}
+
+void QAndroidOffscreenWebView::resetTileStatistics()
+{
+	QMutexLocker locker(&tiles_mutex_);
+	tile_statistics_ = TileStatistics();
+}
+
+static const qint64 c_default_resource_cache_budget = 4 * 1024 * 1024;
+
+static QMutex s_resource_cache_mutex;
+
+//! Data read from files and assets or decompressed from Qt resources, by source path.
+//! The cost is the size in bytes.
+static QCache<QString, QByteArray> s_resource_cache(static_cast<int>(c_default_resource_cache_budget));
+
+static QString resourceMimeType(const QString & path)
+{
+	// QMimeDatabase is thread safe.
+	static const QMimeDatabase s_mime_database;
+	return s_mime_database.mimeTypeForFile(path, QMimeDatabase::MatchExtension).name();
+}
+
+//! Charset passed to WebView for text data; binary data gets none.
+static QString resourceEncoding(const QString & mime_type)
+{
+	if (mime_type.startsWith(QLatin1String("text/"))
+		|| mime_type.contains(QLatin1String("javascript"))
+		|| mime_type.contains(QLatin1String("json"))
+		|| mime_type.endsWith(QLatin1String("xml")))
+	{
+		return QStringLiteral("UTF-8");
+	}
+	return QString();
+}
+
+//! Path part of the URL: without query and fragment, and percent-decoded.
+static QString resourceUrlPath(const QString & url)
+{
+	int end = url.length();
+	for (int i = 0; i < url.length(); ++i)
+	{
+		if (url.at(i) == QLatin1Char('?') || url.at(i) == QLatin1Char('#'))
+		{
+			end = i;
+			break;
+		}
+	}
+	return QUrl::fromPercentEncoding(url.left(end).toUtf8());
+}
+
+//! Get data of a Qt resource, asset or file. Called in WebView threads.
+static bool readResourceSource(const QString & path, QByteArray & out, bool * out_from_memory)
+{
+	if (path.startsWith(QLatin1Char(':')))
+	{
+		QResource resource(path);
+		if (resource.isValid() && resource.data() && resource.compressionAlgorithm() == QResource::NoCompression)
+		{
+			// The data is a part of the binary, so it can be used in place.
+			out = QByteArray::fromRawData(reinterpret_cast<const char *>(resource.data()), static_cast<int>(resource.size()));
+			*out_from_memory = true;
+			return true;
+		}
+	}
+	{
+		QMutexLocker locker(&s_resource_cache_mutex);
+		if (const QByteArray * cached = s_resource_cache.object(path))
+		{
+			out = *cached;
+			*out_from_memory = true;
+			return true;
+		}
+	}
+	// QFile handles compressed Qt resources, "assets:/" and local files.
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+	out = file.readAll();
+	*out_from_memory = false;
+	QMutexLocker locker(&s_resource_cache_mutex);
+	s_resource_cache.insert(path, new QByteArray(out), qMax(1, static_cast<int>(out.size())));
+	return true;
+}
+
+qint64 QAndroidOffscreenWebView::resourceCacheBudget()
+{
+	QMutexLocker locker(&s_resource_cache_mutex);
+	return s_resource_cache.maxCost();
+}
+
+void QAndroidOffscreenWebView::setResourceCacheBudget(qint64 bytes)
+{
+	QMutexLocker locker(&s_resource_cache_mutex);
+	s_resource_cache.setMaxCost(static_cast<int>(qBound(qint64(0), bytes, qint64(std::numeric_limits<int>::max()))));
+}
+
+void QAndroidOffscreenWebView::addResourceMapping(const QString & url_prefix, const QString & source_prefix)
+{
+	ResourceMapping mapping;
+	mapping.url_prefix = url_prefix;
+	mapping.source_prefix = source_prefix;
+	if (mapping.source_prefix.startsWith(QLatin1String("qrc:")))
+	{
+		mapping.source_prefix.remove(0, 3);
+	}
+	QMutexLocker locker(&resources_->mutex);
+	QList<ResourceMapping> & mappings = resources_->mappings;
+	for (int i = 0; i < mappings.size(); ++i)
+	{
+		if (mappings.at(i).url_prefix == url_prefix)
+		{
+			mappings.removeAt(i);
+			break;
+		}
+	}
+	int pos = 0;
+	while (pos < mappings.size() && mappings.at(pos).url_prefix.length() >= url_prefix.length())
+	{
+		++pos;
+	}
+	mappings.insert(pos, mapping);
+}
+
+void QAndroidOffscreenWebView::removeResourceMapping(const QString & url_prefix)
+{
+	QMutexLocker locker(&resources_->mutex);
+	QList<ResourceMapping> & mappings = resources_->mappings;
+	for (int i = 0; i < mappings.size(); ++i)
+	{
+		if (mappings.at(i).url_prefix == url_prefix)
+		{
+			mappings.removeAt(i);
+			return;
+		}
+	}
+}
+
+void QAndroidOffscreenWebView::setResourceData(const QString & url, const QByteArray & data, const QString & mime_type)
+{
+	Resource resource;
+	resource.data = data;
+	resource.mime_type = (mime_type.isEmpty())? resourceMimeType(resourceUrlPath(url)): mime_type;
+	QMutexLocker locker(&resources_->mutex);
+	resources_->data.insert(url, resource);
+}
+
+void QAndroidOffscreenWebView::removeResourceData(const QString & url)
+{
+	QMutexLocker locker(&resources_->mutex);
+	resources_->data.remove(url);
+}
+
+QAndroidOffscreenWebView::ResourceStatistics QAndroidOffscreenWebView::resourceStatistics() const
+{
+	QMutexLocker locker(&resources_->mutex);
+	return resources_->statistics;
+}
+
+void QAndroidOffscreenWebView::resetResourceStatistics()
+{
+	QMutexLocker locker(&resources_->mutex);
+	resources_->statistics = ResourceStatistics();
+}
+
+void QAndroidOffscreenWebView::setMessageChannelEnabled(bool enable)
+{
+	if (enable == message_channel_enabled_)
+	{
+		return;
+	}
+	if (enable && message_channel_origin_.isEmpty())
+	{
+		qWarning("QAndroidOffscreenWebView: The message channel is enabled without an origin, no page will get it.");
+	}
+	try
+	{
+		QJniObject & view = offscreenView();
+		if (view)
+		{
+			view.callVoid("setMessageChannelEnabled", static_cast<jboolean>(enable));
+			message_channel_enabled_ = enable;
+		}
+		else
+		{
+			qWarning("QAndroidOffscreenWebView: Attempt to set up the message channel when View is null.");
+		}
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+	if (!message_channel_enabled_)
+	{
+		message_flush_timer_.stop();
+		for (const ChannelMessage & message : channel_queue_)
+		{
+			if (!message.blob_url.isEmpty())
+			{
+				removeResourceData(message.blob_url);
+			}
+		}
+		channel_queue_.clear();
+	}
+}
+
+void QAndroidOffscreenWebView::setMessageChannelOrigin(const QString & origin)
+{
+	if (origin == message_channel_origin_)
+	{
+		return;
+	}
+	try
+	{
+		if (QJniObject & view = offscreenView())
+		{
+			// Takes effect with the next page loaded.
+			view.callVoid("setMessageChannelOrigin", origin);
+			message_channel_origin_ = origin;
+		}
+		else
+		{
+			qWarning("QAndroidOffscreenWebView: Attempt to set the message channel origin when View is null.");
+		}
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+}
+
+void QAndroidOffscreenWebView::postMessage(const QString & message, const QString & coalesce_key)
+{
+	queueChannelMessage(coalesce_key, QJsonValue(message));
+}
+
+void QAndroidOffscreenWebView::postBinaryMessage(const QByteArray & data, const QString & coalesce_key)
+{
+	QRandomGenerator * random = QRandomGenerator::system();
+	const QString url = QLatin1String(c_channel_blob_prefix)
+		+ QString::number(random->generate64(), 16) + QString::number(random->generate64(), 16);
+	Resource resource;
+	resource.data = data;
+	resource.mime_type = QStringLiteral("application/octet-stream");
+	resource.channel_blob = true;
+	{
+		QMutexLocker locker(&resources_->mutex);
+		resources_->data.insert(url, resource);
+	}
+	{
+		QMutexLocker locker(&channel_mutex_);
+		++channel_statistics_.binary_messages;
+		channel_statistics_.bytes_sent += static_cast<quint64>(data.size());
+	}
+	QJsonObject blob;
+	blob.insert(QStringLiteral("blob"), url);
+	queueChannelMessage(coalesce_key, blob, url);
+}
+
+void QAndroidOffscreenWebView::queueChannelMessage(const QString & coalesce_key, const QJsonValue & value, const QString & blob_url)
+{
+	if (!message_channel_enabled_)
+	{
+		setMessageChannelEnabled(true);
+	}
+	bool coalesced = false;
+	if (!coalesce_key.isEmpty())
+	{
+		for (ChannelMessage & queued : channel_queue_)
+		{
+			if (queued.coalesce_key == coalesce_key)
+			{
+				// Keep the position in the queue, so the other messages stay in order.
+				if (!queued.blob_url.isEmpty())
+				{
+					removeResourceData(queued.blob_url);
+				}
+				queued.value = value;
+				queued.blob_url = blob_url;
+				coalesced = true;
+				break;
+			}
+		}
+	}
+	{
+		QMutexLocker locker(&channel_mutex_);
+		++channel_statistics_.messages_posted;
+		if (coalesced)
+		{
+			++channel_statistics_.messages_coalesced;
+			return;
+		}
+	}
+	ChannelMessage message;
+	message.coalesce_key = coalesce_key;
+	message.value = value;
+	message.blob_url = blob_url;
+	message.posted_ms = channel_clock_.elapsed();
+	channel_queue_.append(message);
+	if (!message_flush_timer_.isActive())
+	{
+		message_flush_timer_.start();
+	}
+}
+
+void QAndroidOffscreenWebView::flushMessages()
+{
+	message_flush_timer_.stop();
+	if (channel_queue_.isEmpty())
+	{
+		return;
+	}
+	QJsonArray batch;
+	const qint64 now = channel_clock_.elapsed();
+	qint64 total_queue_ms = 0, max_queue_ms = 0;
+	for (const ChannelMessage & message : channel_queue_)
+	{
+		batch.append(message.value);
+		const qint64 queue_ms = now - message.posted_ms;
+		total_queue_ms += queue_ms;
+		max_queue_ms = qMax(max_queue_ms, queue_ms);
+		if (!message.blob_url.isEmpty())
+		{
+			channel_blobs_.append(message.blob_url);
+		}
+	}
+	channel_queue_.clear();
+	while (channel_blobs_.size() > c_max_channel_blobs)
+	{
+		removeResourceData(channel_blobs_.takeFirst());
+	}
+	const QByteArray json = QJsonDocument(batch).toJson(QJsonDocument::Compact);
+	try
+	{
+		QJniObject & view = offscreenView();
+		if (!view)
+		{
+			qWarning("QAndroidOffscreenWebView: Attempt to post messages when View is null.");
+			return;
+		}
+		view.callVoid("postMessages", QString::fromUtf8(json));
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+		return;
+	}
+	QMutexLocker locker(&channel_mutex_);
+	++channel_statistics_.batches_sent;
+	channel_statistics_.bytes_sent += static_cast<quint64>(json.size());
+	channel_statistics_.total_queue_ms += total_queue_ms;
+	channel_statistics_.max_queue_ms = qMax(channel_statistics_.max_queue_ms, max_queue_ms);
+}
+
+QFuture<QString> QAndroidOffscreenWebView::evaluateJavascript(const QString & script)
+{
+	QSharedPointer<QPromise<QString> > promise(new QPromise<QString>());
+	promise->start();
+	QFuture<QString> future = promise->future();
+	int request = 0;
+	{
+		QMutexLocker locker(&channel_mutex_);
+		request = ++javascript_request_counter_;
+		javascript_results_.insert(request, promise);
+	}
+	try
+	{
+		QJniObject & view = offscreenView();
+		if (view)
+		{
+			view.callParamVoid("evaluateJavascript", "Ljava/lang/String;I", QJniLocalRef(script).jObject(), jint(request));
+			return future;
+		}
+		qWarning("QAndroidOffscreenWebView: Attempt to evaluate JavaScript when View is null.");
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+	// Cancels the future.
+	QMutexLocker locker(&channel_mutex_);
+	javascript_results_.remove(request);
+	return future;
+}
+
+QAndroidOffscreenWebView::ChannelStatistics QAndroidOffscreenWebView::channelStatistics() const
+{
+	QMutexLocker locker(&channel_mutex_);
+	return channel_statistics_;
+}
+
+void QAndroidOffscreenWebView::resetChannelStatistics()
+{
+	QMutexLocker locker(&channel_mutex_);
+	channel_statistics_ = ChannelStatistics();
+}
+
+void QAndroidOffscreenWebView::onChannelMessages(const QString & batch)
+{
+	QJsonParseError error;
+	const QJsonDocument document = QJsonDocument::fromJson(batch.toUtf8(), &error);
+	if (!document.isArray())
+	{
+		qWarning() << __FUNCTION__ << "Invalid message batch:" << error.errorString();
+		return;
+	}
+	const QJsonArray messages = document.array();
+	{
+		QMutexLocker locker(&channel_mutex_);
+		channel_statistics_.messages_received += static_cast<quint64>(messages.size());
+	}
+	for (const QJsonValue & message : messages)
+	{
+		emit messageReceived(message.toString());
+	}
+}
+
+void QAndroidOffscreenWebView::onJavascriptResult(int request, const QString & result)
+{
+	QSharedPointer<QPromise<QString> > promise;
+	{
+		QMutexLocker locker(&channel_mutex_);
+		promise = javascript_results_.take(request);
+	}
+	if (promise)
+	{
+		promise->addResult(result);
+		promise->finish();
+	}
+}
+
+bool QAndroidOffscreenWebView::findResource(ResourceTable & table, const QString & url, Resource & out, bool * out_matched, bool * out_from_memory)
+{
+	QString relative_path, source_prefix;
+	{
+		QMutexLocker locker(&table.mutex);
+		const auto data = table.data.find(url);
+		if (data != table.data.end())
+		{
+			out = data.value();
+			if (out.channel_blob)
+			{
+				table.data.erase(data);
+			}
+			*out_matched = true;
+			*out_from_memory = true;
+			return true;
+		}
+		for (const ResourceMapping & mapping : table.mappings)
+		{
+			if (url.startsWith(mapping.url_prefix))
+			{
+				*out_matched = true;
+				source_prefix = mapping.source_prefix;
+				relative_path = resourceUrlPath(url.mid(mapping.url_prefix.length()));
+				break;
+			}
+		}
+	}
+	if (!*out_matched)
+	{
+		return false;
+	}
+	if (relative_path.isEmpty() || relative_path.endsWith(QLatin1Char('/')))
+	{
+		relative_path += QLatin1String("index.html");
+	}
+	if (relative_path.split(QLatin1Char('/')).contains(QLatin1String("..")))
+	{
+		qWarning() << __FUNCTION__ << "Rejected path outside of the mapping:" << url;
+		return false;
+	}
+	const QString path = source_prefix + relative_path;
+	if (!readResourceSource(path, out.data, out_from_memory))
+	{
+		qWarning() << __FUNCTION__ << "Resource not found:" << url << "=>" << path;
+		return false;
+	}
+	out.mime_type = resourceMimeType(path);
+	return true;
+}
+
+jobject QAndroidOffscreenWebView::createResourceResponse(JNIEnv * env, jobject java_view, const Resource & resource)
+{
+	QJniEnvPtr jep(env);
+	// Java releases the holder via nativeReleaseResource() when the stream is closed.
+	QByteArray * holder = new QByteArray(resource.data);
+	QJniLocalRef buffer(jep, (holder->isEmpty())? jobject(0): env->NewDirectByteBuffer(
+		const_cast<char *>(holder->constData()),
+		static_cast<jlong>(holder->size())));
+	if (jep.clearException() || (!holder->isEmpty() && !buffer.jObject()))
+	{
+		qCritical() << "Failed to create a direct buffer for a resource of" << holder->size() << "bytes";
+		delete holder;
+		return 0;
+	}
+	const QString encoding = resourceEncoding(resource.mime_type);
+	try
+	{
+		QJniObject response(QJniObject(java_view, false).callParamObj(
+			"createNativeResponse"
+			, "android/webkit/WebResourceResponse"
+			, "Ljava/lang/String;Ljava/lang/String;Ljava/nio/ByteBuffer;JZ"
+			, QJniLocalRef(jep, resource.mime_type).jObject()
+			, (encoding.isEmpty())? jobject(0): QJniLocalRef(jep, encoding).jObject()
+			, buffer.jObject()
+			, static_cast<jlong>(reinterpret_cast<intptr_t>(holder))
+			, static_cast<jboolean>(resource.channel_blob)));
+		// On failure, Java has released the holder already.
+		return (response)? env->NewLocalRef(response.jObject()): 0;
+	}
+	catch (const std::exception & e)
+	{
+		// Java has not got the holder.
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+		delete holder;
+	}
+	return 0;
+}
+
+void QAndroidOffscreenWebView::onTileRendered(int x, int y, int request, bool ok)
+{
+	{
+		QMutexLocker locker(&tiles_mutex_);
+		QSharedPointer<QAndroidJniImagePair> image = tiles_in_flight_.take(request);
+		if (!image)
+		{
+			return;
+		}
+		auto it = tiles_.find(TileKey(x / tile_size_, y / tile_size_));
+		if (it == tiles_.end() || it->request != request)
+		{
+			// The tile has been dropped while rendering.
+			releaseTileImage(image);
+			return;
+		}
+		it->request = 0;
+		it->rendering.reset();
+		if (!ok)
+		{
+			if (image != it->image)
+			{
+				releaseTileImage(image);
+			}
+			return;
+		}
+		if (image != it->image)
+		{
+			// Replace the outdated bitmap which has been shown while rendering.
+			releaseTileImage(it->image);
+			it->image = image;
+		}
+		// The tile stays stale if the page has changed again while rendering.
+		it->valid = true;
+		it->texture_dirty = true;
+		++tile_statistics_.tiles_rendered;
+	}
+	emit updated();
+}
+
+void QAndroidOffscreenWebView::onTilesDamaged(const QRect & area)
+{
+	{
+		QMutexLocker locker(&tiles_mutex_);
+		for (auto it = tiles_.begin(); it != tiles_.end(); ++it)
+		{
+			const QRect tile_rect(it.key().first * tile_size_, it.key().second * tile_size_, tile_size_, tile_size_);
+			if (area.isEmpty() || area.intersects(tile_rect))
+			{
+				it->stale = true;
+			}
+		}
+	}
+	emit updated();
+}
+
+void QAndroidOffscreenWebView::onTiledScrollChanged(int x, int y)
+{
+	QPointF offset;
+	{
+		QMutexLocker locker(&tiles_mutex_);
+		if (QPoint(x, y) == java_scroll_)
+		{
+			// Our own setScrollPosition().
+			return;
+		}
+		java_scroll_ = QPoint(x, y);
+		content_offset_ = offset = QPointF(x, y);
+	}
+	emit contentOffsetChanged(offset);
+	emit updated();
+}
+
+void QAndroidOffscreenWebView::onTiledContentHeight(int height)
+{
+	{
+		QMutexLocker locker(&tiles_mutex_);
+		if (height == content_height_)
+		{
+			return;
+		}
+		content_height_ = height;
+	}
+	// Tiles past the end of the document are not requested any more, or may be needed now.
+	emit updated();
+}
+
+void QAndroidOffscreenWebView::releaseTileImage(const QSharedPointer<QAndroidJniImagePair> & image)
+{
+	if (image && image->isAllocated())
+	{
+		const QSize size = image->size();
+		const int bitness = image->bitness();
+		QAndroidJniBitmapPool::instance().put(image->releaseBitmap(), size, bitness);
+	}
+}
+
+void QAndroidOffscreenWebView::dropTiles()
+{
+	for (auto it = tiles_.begin(); it != tiles_.end(); ++it)
+	{
+		if (it->texture)
+		{
+			retired_textures_.append(it->texture);
+		}
+		// Images of tiles being rendered are released in onTileRendered().
+		if (!it->request || it->rendering != it->image)
+		{
+			releaseTileImage(it->image);
+		}
+	}
+	tiles_.clear();
+}
+
+void QAndroidOffscreenWebView::evictTiles(const QRect & keep_range)
+{
+	const qint64 tile_bytes = QAndroidJniBitmapPool::bitmapBytes(QSize(tile_size_, tile_size_), 32);
+	qint64 used_bytes = 0;
+	QList<QPair<quint64, TileKey> > candidates;
+	for (auto it = tiles_.begin(); it != tiles_.end(); )
+	{
+		const bool keep = keep_range.contains(it.key().first, it.key().second);
+		if (it->rendering && it->rendering != it->image)
+		{
+			used_bytes += tile_bytes;
+		}
+		if (it->image)
+		{
+			used_bytes += tile_bytes;
+			if (!keep && !it->request)
+			{
+				candidates.append(qMakePair(it->last_used, it.key()));
+			}
+			++it;
+		}
+		else if (!keep && !it->request)
+		{
+			it = tiles_.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	if (used_bytes <= tile_cache_budget_)
+	{
+		return;
+	}
+	std::sort(candidates.begin(), candidates.end());
+	for (const auto & candidate : candidates)
+	{
+		if (used_bytes <= tile_cache_budget_)
+		{
+			break;
+		}
+		Tile tile = tiles_.take(candidate.second);
+		if (tile.texture)
+		{
+			retired_textures_.append(tile.texture);
+		}
+		releaseTileImage(tile.image);
+		used_bytes -= tile_bytes;
+		++tile_statistics_.tiles_evicted;
+	}
+}
+
+QList<QAndroidOffscreenWebView::VisibleTile> QAndroidOffscreenWebView::prepareTiles(QList<TileRequest> & out_requests, int * out_missing)
+{
+	QList<VisibleTile> visible;
+	const QSize view_size = size();
+	if (view_size.isEmpty())
+	{
+		if (out_missing)
+		{
+			*out_missing = 0;
+		}
+		return visible;
+	}
+	const qreal ts = tile_size_;
+	const QPointF offset = content_offset_;
+	const QRect range(
+		QPoint(qFloor(offset.x() / ts), qFloor(offset.y() / ts))
+		, QPoint(qCeil((offset.x() + view_size.width()) / ts) - 1, qCeil((offset.y() + view_size.height()) / ts) - 1));
+	// Prefetch one more row in both directions of scrolling.
+	const QRect prefetch_range = range.adjusted(0, (range.top() > 0)? -1: 0, 0, 1);
+	// Rows past the end of the document would be rendered blank.
+	const int last_row = (content_height_ >= 0)? qCeil(content_height_ / ts) - 1: prefetch_range.bottom();
+
+	int in_flight = tiles_in_flight_.size();
+	int missing = 0;
+	// Visible tiles are requested first.
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		const QRect & pass_range = (pass == 0)? range: prefetch_range;
+		for (int row = pass_range.top(); row <= qMin(pass_range.bottom(), last_row); ++row)
+		{
+			for (int col = pass_range.left(); col <= pass_range.right(); ++col)
+			{
+				const bool is_visible = range.contains(col, row);
+				if (pass == 1 && is_visible)
+				{
+					continue;
+				}
+				Tile & tile = tiles_[TileKey(col, row)];
+				tile.last_used = ++tile_use_counter_;
+				if (is_visible)
+				{
+					if (tile.valid)
+					{
+						visible.append({&tile, QRectF(col * ts - offset.x(), row * ts - offset.y(), ts, ts)});
+						if (tile.stale)
+						{
+							++tile_statistics_.stale_tiles;
+						}
+					}
+					else
+					{
+						++missing;
+					}
+				}
+				if ((tile.valid && !tile.stale) || tile.request || in_flight >= c_max_tiles_in_flight)
+				{
+					continue;
+				}
+				// A tile which is shown keeps its bitmap until the new one is rendered
+				// (see onTileRendered()), so Java never draws into a bitmap being painted.
+				QSharedPointer<QAndroidJniImagePair> target = (tile.valid)? QSharedPointer<QAndroidJniImagePair>(): tile.image;
+				if (!target)
+				{
+					target.reset(new QAndroidJniImagePair(32));
+					target->setBitmapPool(&QAndroidJniBitmapPool::instance());
+				}
+				if (!target->resize(tile_size_, tile_size_))
+				{
+					qWarning() << __PRETTY_FUNCTION__ << "Failed to allocate tile bitmap.";
+					if (target == tile.image)
+					{
+						tile.image.reset();
+					}
+					continue;
+				}
+				tile.request = ++tile_request_counter_;
+				if (tile.request <= 0)
+				{
+					tile.request = tile_request_counter_ = 1;
+				}
+				tile.stale = false;
+				tile.rendering = target;
+				tiles_in_flight_.insert(tile.request, target);
+				out_requests.append({target, col * tile_size_, row * tile_size_, tile.request});
+				++in_flight;
+			}
+		}
+	}
+	evictTiles(prefetch_range);
+
+	++tile_statistics_.frames;
+	tile_statistics_.missing_tiles += static_cast<quint64>(missing);
+	if (!missing)
+	{
+		++tile_statistics_.complete_frames;
+	}
+	if (offset != last_composed_offset_)
+	{
+		++tile_statistics_.scroll_frames;
+		if (!missing)
+		{
+			++tile_statistics_.scroll_frames_complete;
+		}
+		last_composed_offset_ = offset;
+	}
+	if (out_missing)
+	{
+		*out_missing = missing;
+	}
+	return visible;
+}
+
+void QAndroidOffscreenWebView::sendTileRequests(const QList<TileRequest> & requests)
+{
+	if (requests.isEmpty())
+	{
+		return;
+	}
+	try
+	{
+		if (QJniObject & view = offscreenView())
+		{
+			for (const TileRequest & request : requests)
+			{
+				view.callParamVoid("renderTile", "Landroid/graphics/Bitmap;III"
+					, request.image->jbitmap()
+					, static_cast<jint>(request.x)
+					, static_cast<jint>(request.y)
+					, static_cast<jint>(request.request));
+			}
+		}
+	}
+	catch (const std::exception & e)
+	{
+		qCritical() << "JNI exception in" << __PRETTY_FUNCTION__ << ":" << e.what();
+	}
+}
+
+bool QAndroidOffscreenWebView::paintTiles(QPainter & painter, const QRectF & target)
+{
+	if (!tiled_rendering_ || size().isEmpty())
+	{
+		return false;
+	}
+	const qreal sx = target.width() / size().width();
+	const qreal sy = target.height() / size().height();
+	QList<TileRequest> requests;
+	int missing = 0;
+	{
+		QMutexLocker locker(&tiles_mutex_);
+		const QList<VisibleTile> visible = prepareTiles(requests, &missing);
+
+		painter.save();
+		painter.setClipRect(target, Qt::IntersectClip);
+		painter.fillRect(target, fillColor());
+		painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+		for (const VisibleTile & v : visible)
+		{
+			const QRectF rect(
+				target.left() + v.rect.left() * sx
+				, target.top() + v.rect.top() * sy
+				, v.rect.width() * sx
+				, v.rect.height() * sy);
+			painter.drawImage(rect, v.tile->image->rgbaQImage());
+		}
+		painter.restore();
+	}
+	sendTileRequests(requests);
+	return missing == 0;
+}
+
+void QAndroidOffscreenWebView::paintGL(int l, int b, int w, int h, bool reverse_y)
+{
+	if (!tiled_rendering_)
+	{
+		QAndroidOffscreenView::paintGL(l, b, w, h, reverse_y);
+		return;
+	}
+	if (w <= 0 || h <=0)
+	{
+		qWarning() << __PRETTY_FUNCTION__ << "Ignoring paint with size:" << w << "x" << h;
+		return;
+	}
+	glViewport(l, b, w, h);
+	const QColor fill = fillColor();
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(l, b, w, h);
+	glClearColor(fill.redF(), fill.greenF(), fill.blueF(), fill.alphaF());
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	QList<TileRequest> requests;
+	{
+		QMutexLocker locker(&tiles_mutex_);
+		retired_textures_.clear();
+		const QList<VisibleTile> visible = prepareTiles(requests);
+		tile_batch_.clear();
+		for (const VisibleTile & v : visible)
+		{
+			Tile & tile = *v.tile;
+			if (!tile.texture)
+			{
+				tile.texture.reset(new QOpenGLTextureHolder());
+			}
+			if (!tile.texture->isAllocated())
+			{
+				tile.texture->allocateTexture(tile.image->qImage(), true);
+				tile.texture_dirty = false;
+			}
+			else if (tile.texture_dirty)
+			{
+				// Tiles are all of the same size, so the texture is reloaded in place.
+				if (!tile.texture->updateTexture(tile.image->qImage(), tile.image->qImage().rect(), true))
+				{
+					tile.texture->allocateTexture(tile.image->qImage(), true);
+				}
+				tile.texture_dirty = false;
+			}
+			tile_batch_.add(*tile.texture, v.rect, QRect(), reverse_y);
+		}
+		tile_batch_.draw(QSize(w, h));
+		tile_batch_.clear();
+	}
+	glDisable(GL_SCISSOR_TEST);
+	sendTileRequests(requests);
+}
@@ -35,7 +35,19 @@
 */
 
 #pragma once
+#include <QtCore/QByteArray>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFuture>
+#include <QtCore/QHash>
+#include <QtCore/QJsonValue>
+#include <QtCore/QList>
 #include <QtCore/QMap>
+#include <QtCore/QPair>
+#include <QtCore/QPointF>
+#include <QtCore/QPromise>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QTimer>
+#include <QtGui/QPainter>
 #include "QAndroidOffscreenView.h"
 
 class QAndroidOffscreenWebView
@@ -43,6 +55,8 @@ class QAndroidOffscreenWebView
 {
 	Q_OBJECT
 	Q_PROPERTY(bool ignoreSslErrors READ getIgnoreSslErrors WRITE setIgnoreSslErrors)
+	Q_PROPERTY(bool tiledRendering READ tiledRendering WRITE setTiledRendering)
+	Q_PROPERTY(QPointF contentOffset READ contentOffset WRITE setContentOffset NOTIFY contentOffsetChanged)
 public:
 	QAndroidOffscreenWebView(const QString & object_name, const QSize & def_size, QObject * parent = 0);
 	virtual ~QAndroidOffscreenWebView();
@@ -93,6 +107,172 @@ public:
 	void setIgnoreSslErrors(bool ignore) { ignore_ssl_errors_ = ignore; }
 	void setWebContentsDebuggingEnabled(bool enabled);
 
+	/*!
+	 * Tiled rendering for scrolling long pages. Java renders tileSize() x tileSize() tiles
+	 * of the document on demand, and visible tiles are composed at contentOffset() (which may
+	 * be fractional) by paintGL() or paintTiles(). Scrolling within already rendered parts of
+	 * the page doesn't need any Java painting. Tiles of changed parts of the page are shown
+	 * until they are re-rendered. The tiles are kept within tileCacheBudget(), the least
+	 * recently shown ones are released first.
+	 * The mode should be enabled before the first WebView of the app is created: Android 5+
+	 * WebView renders only the visible part of the page otherwise.
+	 */
+	bool tiledRendering() const { return tiled_rendering_; }
+	void setTiledRendering(bool enable);
+
+	int tileSize() const { return tile_size_; }
+	//! Drops all tiles if changed.
+	void setTileSize(int size);
+
+	//! Memory limit for tile bitmaps, in bytes.
+	qint64 tileCacheBudget() const { return tile_cache_budget_; }
+	void setTileCacheBudget(qint64 bytes);
+
+	/*!
+	 * Document position shown in the top-left corner of the view in tiled mode. Follows
+	 * scrolling of the WebView (e.g. by touch) and can be set to scroll it from Qt side
+	 * (e.g. kinetic scrolling in QML); WebView scroll position is synchronized when the offset
+	 * stops changing.
+	 */
+	QPointF contentOffset() const;
+	void setContentOffset(const QPointF & offset);
+
+	/*!
+	 * Draw visible tiles into target using QPainter, for raster painting in tiled mode.
+	 * Tiles which are not rendered yet are filled with fillColor() and requested from Java.
+	 * \return true if all visible tiles have been rendered.
+	 */
+	bool paintTiles(QPainter & painter, const QRectF & target);
+
+	//! Statistics of tiled rendering, to evaluate scrolling smoothness.
+	struct TileStatistics
+	{
+		quint64 frames = 0;                //!< Frames composed from tiles.
+		quint64 complete_frames = 0;       //!< Frames without missing tiles.
+		quint64 missing_tiles = 0;         //!< Tiles filled with fillColor() as not rendered yet.
+		quint64 stale_tiles = 0;           //!< Tiles shown with outdated content.
+		quint64 tiles_rendered = 0;        //!< Tiles rendered by Java.
+		quint64 tiles_evicted = 0;         //!< Tiles released to stay within the budget.
+		quint64 scroll_frames = 0;         //!< Frames with contentOffset() changed since the previous one.
+		quint64 scroll_frames_complete = 0; //!< ...of them composed without missing tiles.
+	};
+	TileStatistics tileStatistics() const;
+	void resetTileStatistics();
+
+	//
+	// Serving resources from native memory. Requests are matched in shouldInterceptRequest()
+	// and answered with a stream over a direct buffer, so the data is not copied to Java heap.
+	//
+
+	/*!
+	 * Serve URLs starting with \a url_prefix from \a source_prefix: Qt resources (":/web/"
+	 * or "qrc:/web/"), Android assets ("assets:/web/") or a local directory. The rest of
+	 * the URL path is appended to \a source_prefix. The longest matching prefix wins.
+	 */
+	void addResourceMapping(const QString & url_prefix, const QString & source_prefix);
+	void removeResourceMapping(const QString & url_prefix);
+
+	/*!
+	 * Serve exactly \a url from \a data, which is shared rather than copied.
+	 * If \a mime_type is empty it is guessed from the URL. Takes priority over the mappings.
+	 */
+	void setResourceData(const QString & url, const QByteArray & data, const QString & mime_type = QString());
+	void removeResourceData(const QString & url);
+
+	/*!
+	 * Memory limit for data read from assets and files or decompressed from Qt resources,
+	 * shared by all WebViews; the least recently used data is dropped first. Data of
+	 * uncompressed Qt resources is used in place and is not cached. Default: 4 MB.
+	 */
+	static qint64 resourceCacheBudget();
+	static void setResourceCacheBudget(qint64 bytes);
+
+	struct ResourceStatistics
+	{
+		quint64 requests = 0;           //!< Requests which matched a mapping or resource data.
+		quint64 served = 0;             //!< ...of them answered; the rest were not found.
+		quint64 served_from_memory = 0; //!< Answered without reading a file or asset.
+		quint64 bytes = 0;              //!< Size of the served data.
+		qint64 total_us = 0;            //!< Time spent finding the data and creating the responses.
+		qint64 max_us = 0;
+	};
+	ResourceStatistics resourceStatistics() const;
+	void resetResourceStatistics();
+
+	//
+	// JavaScript message channel. When enabled, window.qtChannel is installed into each page
+	// after it has loaded (and "qtchannelready" event is dispatched on window):
+	//   qtChannel.onmessage = function(message) { ... }; // Receives strings and ArrayBuffers.
+	//   qtChannel.postMessage(string);                    // Emits messageReceived().
+	// Messages are sent in batches both ways: at most one per messageBatchInterval() to the page
+	// and one per JavaScript task from it. A WebMessagePort is used on Android 6+, and
+	// evaluateJavascript() and a JavaScript interface on older versions.
+	// The channel is installed only into pages of messageChannelOrigin().
+	//
+
+	/*!
+	 * Origin of the pages which get the channel, e.g. "https://example.com" (scheme, host
+	 * and non-default port). Pages of other origins don't get window.qtChannel, the message
+	 * port or access to binary messages, and messages from them are ignored. "*" allows any
+	 * page, including ones with opaque origins (e.g. data: URLs); use it only for trusted
+	 * content. Empty by default, so the channel must be given an origin to work.
+	 */
+	void setMessageChannelOrigin(const QString & origin);
+	QString messageChannelOrigin() const { return message_channel_origin_; }
+
+	/*!
+	 * Should be enabled before loading the page, as the JavaScript interface used on older
+	 * Android versions is visible only to pages loaded after that. Enabled by postMessage().
+	 */
+	void setMessageChannelEnabled(bool enable);
+	bool messageChannelEnabled() const { return message_channel_enabled_; }
+
+	/*!
+	 * Queue a message for the page. If \a coalesce_key is not empty, a queued message with
+	 * the same key is replaced, so a page which can't keep up receives only the latest state.
+	 * Messages posted before the page has loaded are delivered when it's ready.
+	 */
+	void postMessage(const QString & message, const QString & coalesce_key = QString());
+
+	/*!
+	 * Queue binary data, which the page receives as an ArrayBuffer. The data is not encoded
+	 * into text: the page loads it from shouldInterceptRequest(). Requires Android 5+.
+	 */
+	void postBinaryMessage(const QByteArray & data, const QString & coalesce_key = QString());
+
+	int messageBatchInterval() const { return message_flush_timer_.interval(); }
+	void setMessageBatchInterval(int ms) { message_flush_timer_.setInterval(ms); }
+
+	/*!
+	 * Evaluate \a script in the context of the current page. The result is JSON representation
+	 * of the value of the script ("null" on Android < 4.4). The future is canceled if the view
+	 * is deinitialized before that.
+	 */
+	QFuture<QString> evaluateJavascript(const QString & script);
+
+	struct ChannelStatistics
+	{
+		quint64 messages_posted = 0;    //!< Including binary ones.
+		quint64 messages_coalesced = 0; //!< Replaced by newer ones before sending.
+		quint64 binary_messages = 0;
+		quint64 batches_sent = 0;
+		quint64 bytes_sent = 0;         //!< Size of the batches in UTF-8 plus the posted binary data.
+		quint64 messages_received = 0;
+		qint64 total_queue_ms = 0;      //!< Time the sent messages have spent in the queue.
+		qint64 max_queue_ms = 0;
+	};
+	ChannelStatistics channelStatistics() const;
+	void resetChannelStatistics();
+
+	void paintGL(int l, int b, int w, int h, bool reverse_y) override;
+	bool requiresPaintGL() const override { return tiled_rendering_; }
+
+public slots:
+	void deinitialize() override;
+
+	//! Send the queued messages to the page now.
+	void flushMessages();
+
 	/*
 	Unimplemented WebView functions:
 
@@ -108,7 +288,6 @@ public:
 	boolean dispatchKeyEvent(KeyEvent event) // Dispatch a key event to the next view on the focus path.
 	void 	documentHasImages(Message response) // Queries the document to see if it contains any image references.
 	abstract void dumpViewHierarchyWithProperties(BufferedWriter out, int level) // Dumps custom children to hierarchy viewer.
-	void 	evaluateJavascript(String script, ValueCallback<String> resultCallback) // Asynchronously evaluates JavaScript in the context of the currently displayed page.
 	static String findAddress(String addr) // Gets the first substring consisting of the address of a physical location.
 	int 	findAll(String find) // This method was deprecated in API level 16. findAllAsync(String) is preferred.
 	void 	findAllAsync(String find) // Finds all instances of find on the page and highlights them, asynchronously.
@@ -225,6 +404,16 @@ signals:
 	void canGoBackOrForwardReceived(bool can, int steps);
 
 	void progressChanged(int percent);
+	void contentOffsetChanged(const QPointF & offset);
+
+	/*!
+	 * Emitted for each request which matched the resource tables, with the time spent
+	 * on finding the data and creating the response. Emitted in a WebView thread.
+	 */
+	void resourceRequested(const QString & url, bool served, qint64 bytes, qint64 microseconds);
+
+	//! Message posted by the page with qtChannel.postMessage(). Emitted in Android UI thread or a WebView thread.
+	void messageReceived(const QString & message);
 
 protected:
 	//
@@ -244,6 +433,7 @@ protected:
 	virtual void onScaleChanged(JNIEnv *, jobject, float oldScale, float newScale);
 	virtual void onTooManyRedirects(JNIEnv *, jobject, jobject cancelMsg, jobject continueMsg);
 	virtual void onUnhandledKeyEvent(JNIEnv *, jobject, jobject event);
+	//! Called in a WebView thread. Requests not intercepted here are served from the resource tables.
 	virtual jobject shouldInterceptRequest(JNIEnv *, jobject, jobject url);
 	virtual jboolean shouldOverrideKeyEvent(JNIEnv *, jobject, jobject event);
 	virtual jboolean shouldOverrideUrlLoading(JNIEnv *, jobject, jobject url);
@@ -292,7 +482,175 @@ protected:
 	friend Q_DECL_EXPORT void JNICALL Java_onCanGoForwardReceived(JNIEnv * env, jobject jo, jlong nativeptr, jboolean can);
 	friend Q_DECL_EXPORT void JNICALL Java_onCanGoBackOrForwardReceived(JNIEnv * env, jobject jo, jlong nativeptr, jboolean can, jint steps);
 
+	//
+	// Tiled rendering callbacks, called in Android UI thread.
+	//
+	void onTileRendered(int x, int y, int request, bool ok);
+	void onTilesDamaged(const QRect & area);
+	void onTiledScrollChanged(int x, int y);
+	//! \a height is the document height in view pixels.
+	void onTiledContentHeight(int height);
+
+	friend Q_DECL_EXPORT void JNICALL Java_onTileRendered(JNIEnv * env, jobject jo, jlong nativeptr, jint x, jint y, jint request, jboolean ok);
+	friend Q_DECL_EXPORT void JNICALL Java_onTilesDamaged(JNIEnv * env, jobject jo, jlong nativeptr, jint left, jint top, jint right, jint bottom);
+	friend Q_DECL_EXPORT void JNICALL Java_onTiledScrollChanged(JNIEnv * env, jobject jo, jlong nativeptr, jint x, jint y);
+	friend Q_DECL_EXPORT void JNICALL Java_onTiledContentHeight(JNIEnv * env, jobject jo, jlong nativeptr, jint height);
+
+	//
+	// Message channel callbacks, called in Android UI thread or a WebView thread.
+	//
+	//! \a batch is a JSON array of strings.
+	virtual void onChannelMessages(const QString & batch);
+	void onJavascriptResult(int request, const QString & result);
+
+	friend Q_DECL_EXPORT void JNICALL Java_onChannelMessages(JNIEnv * env, jobject jo, jlong nativeptr, jobject batch);
+	friend Q_DECL_EXPORT void JNICALL Java_onJavascriptResult(JNIEnv * env, jobject jo, jlong nativeptr, jint request, jobject result);
+
+	//
+	// Resource interception, called in a WebView thread.
+	//
+	friend Q_DECL_EXPORT jlong JNICALL Java_nativeAcquireResources(JNIEnv * env, jobject jo, jlong nativeptr);
+	friend Q_DECL_EXPORT jobject JNICALL Java_nativeServeResource(JNIEnv * env, jobject jo, jlong resources, jobject url);
+	friend Q_DECL_EXPORT void JNICALL Java_nativeReleaseResources(JNIEnv * env, jclass, jlong resources);
+
+private slots:
+	void syncScrollToContentOffset();
 
 private:
+	struct Tile
+	{
+		QSharedPointer<QAndroidJniImagePair> image;
+		//! Bitmap Java is rendering into: image itself if the tile is not valid yet,
+		//! otherwise a spare one which replaces image when rendered.
+		QSharedPointer<QAndroidJniImagePair> rendering;
+		//! Used by paintGL(), reloaded when texture_dirty.
+		QSharedPointer<QOpenGLTextureHolder> texture;
+		quint64 last_used = 0;
+		int request = 0;       //!< Id of the rendering being done by Java, 0 if none.
+		bool valid = false;    //!< Has been rendered.
+		bool stale = false;    //!< The page has changed since rendering.
+		bool texture_dirty = true;
+	};
+	typedef QPair<int, int> TileKey; //!< Column and row of the tile.
+
+	struct TileRequest
+	{
+		QSharedPointer<QAndroidJniImagePair> image;
+		int x, y, request;
+	};
+
+	struct VisibleTile
+	{
+		Tile * tile;
+		QRectF rect; //!< In view coordinates.
+	};
+
+	/*!
+	 * Collect tiles to draw for the current content offset, update statistics, allocate
+	 * missing and stale tiles around the visible area for rendering and evict extra tiles.
+	 * Should be called with tiles_mutex_ locked; the requests should be sent with
+	 * sendTileRequests() after unlocking it.
+	 * \param out_missing - number of visible tiles which are not rendered yet.
+	 */
+	QList<VisibleTile> prepareTiles(QList<TileRequest> & out_requests, int * out_missing = nullptr);
+	void sendTileRequests(const QList<TileRequest> & requests);
+	void evictTiles(const QRect & keep_range);
+	//! Release all tiles. Should be called with tiles_mutex_ locked.
+	void dropTiles();
+	void releaseTileImage(const QSharedPointer<QAndroidJniImagePair> & image);
+
+	struct ResourceMapping
+	{
+		QString url_prefix;
+		QString source_prefix;
+	};
+
+	struct Resource
+	{
+		QByteArray data;
+		QString mime_type;
+		//! Posted by postBinaryMessage(): served once, to pages of any origin.
+		bool channel_blob = false;
+	};
+
+	/*!
+	 * Resource tables of a view. WebView threads keep a reference to them while serving
+	 * a request, instead of holding nativePtrMutex() while reading files.
+	 */
+	struct ResourceTable
+	{
+		//! Guards the tables and the statistics.
+		QMutex mutex;
+		//! Longest prefix first.
+		QList<ResourceMapping> mappings;
+		QHash<QString, Resource> data;
+		ResourceStatistics statistics;
+		//! Guards owner, which is reset when the view is destroyed.
+		QMutex owner_mutex;
+		QAndroidOffscreenWebView * owner = nullptr;
+	};
+
+	/*!
+	 * Find data for the URL in the resource tables.
+	 * \param out_matched - set if the URL matched the tables, even if there is no data for it.
+	 * \param out_from_memory - set if the data has been found without reading a file.
+	 */
+	static bool findResource(ResourceTable & table, const QString & url, Resource & out, bool * out_matched, bool * out_from_memory);
+	/*!
+	 * Create WebResourceResponse over the data, which is kept until Java closes the stream.
+	 * \param java_view - the OffscreenWebView object.
+	 */
+	static jobject createResourceResponse(JNIEnv * env, jobject java_view, const Resource & resource);
+	//! Answer a request from the tables, if it matches them. Called without nativePtrMutex() locked.
+	static jobject serveResource(JNIEnv * env, jobject java_view, ResourceTable & table, jobject url);
+
+	struct ChannelMessage
+	{
+		QString coalesce_key;
+		QJsonValue value;
+		QString blob_url; //!< Resource data to release if the message is replaced.
+		qint64 posted_ms;
+	};
+
+	void queueChannelMessage(const QString & coalesce_key, const QJsonValue & value, const QString & blob_url = QString());
+
 	bool ignore_ssl_errors_;
+
+	bool tiled_rendering_;
+	int tile_size_;
+	qint64 tile_cache_budget_;
+	//! Guards tiles_, content_offset_, content_height_, statistics and retired_textures_.
+	mutable QMutex tiles_mutex_;
+	QMap<TileKey, Tile> tiles_;
+	//! Bitmaps Java is rendering into, by request id. Kept even if their tiles are dropped.
+	QMap<int, QSharedPointer<QAndroidJniImagePair> > tiles_in_flight_;
+	//! Textures of dropped tiles, deleted in paintGL() with the GL context current.
+	QList<QSharedPointer<QOpenGLTextureHolder> > retired_textures_;
+	quint64 tile_use_counter_;
+	int tile_request_counter_;
+	QPointF content_offset_;
+	//! Document height in view pixels reported by Java, -1 if unknown.
+	int content_height_;
+	QPointF last_composed_offset_;
+	//! Last scroll position requested from or reported by Java.
+	QPoint java_scroll_;
+	QTimer scroll_sync_timer_;
+	TileStatistics tile_statistics_;
+	QOpenGLTextureBatch tile_batch_;
+
+	QSharedPointer<ResourceTable> resources_;
+
+	bool message_channel_enabled_;
+	QString message_channel_origin_;
+	//! Used in Qt thread only, like the timer and blob data below.
+	QList<ChannelMessage> channel_queue_;
+	QTimer message_flush_timer_;
+	QElapsedTimer channel_clock_;
+	//! Sent blobs, oldest first, to release the ones the page has never loaded.
+	QList<QString> channel_blobs_;
+	//! Guards channel_statistics_ and javascript_results_.
+	mutable QMutex channel_mutex_;
+	ChannelStatistics channel_statistics_;
+	QMap<int, QSharedPointer<QPromise<QString> > > javascript_results_;
+	int javascript_request_counter_;
 };
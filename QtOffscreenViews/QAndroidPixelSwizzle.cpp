@@ -0,0 +1,258 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "QAndroidPixelSwizzle.h"
+
+#if defined(__aarch64__) || (defined(__arm__) && defined(__ARM_NEON))
+	#define QANDROIDPIXELSWIZZLE_NEON
+	#include <arm_neon.h>
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+	#define QANDROIDPIXELSWIZZLE_X86
+	#include <immintrin.h>
+#endif
+
+
+namespace QAndroidPixelSwizzle {
+
+namespace {
+
+inline uint32_t swapPixel(uint32_t c)
+{
+	// Source: ARGB; formula: R | B00 | A0G0 => ABGR
+	return ((c >> 16) & 0xFF) | ((c & 0xFF) << 16) | (c & 0xFF00FF00);
+}
+
+
+#if defined(QANDROIDPIXELSWIZZLE_NEON)
+
+void swapRedBlueNeon(const uint32_t * src, uint32_t * dest, size_t count)
+{
+	size_t i = 0;
+	// De-interleaving load splits 16 pixels into 4 planes, so the swap is just a register rename.
+	for (; i + 16 <= count; i += 16)
+	{
+		uint8x16x4_t px = vld4q_u8(reinterpret_cast<const uint8_t *>(src + i));
+		const uint8x16_t tmp = px.val[0];
+		px.val[0] = px.val[2];
+		px.val[2] = tmp;
+		vst4q_u8(reinterpret_cast<uint8_t *>(dest + i), px);
+	}
+	for (; i < count; ++i)
+	{
+		dest[i] = swapPixel(src[i]);
+	}
+}
+
+#endif // QANDROIDPIXELSWIZZLE_NEON
+
+
+#if defined(QANDROIDPIXELSWIZZLE_X86)
+
+__attribute__((target("sse2")))
+void swapRedBlueSse2(const uint32_t * src, uint32_t * dest, size_t count)
+{
+	size_t i = 0;
+	const __m128i ag_mask = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+	const __m128i low_mask = _mm_set1_epi32(0xFF);
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		const __m128i r = _mm_and_si128(_mm_srli_epi32(c, 16), low_mask);
+		const __m128i b = _mm_slli_epi32(_mm_and_si128(c, low_mask), 16);
+		const __m128i ag = _mm_and_si128(c, ag_mask);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_or_si128(_mm_or_si128(r, b), ag));
+	}
+	for (; i < count; ++i)
+	{
+		dest[i] = swapPixel(src[i]);
+	}
+}
+
+
+__attribute__((target("ssse3")))
+void swapRedBlueSsse3(const uint32_t * src, uint32_t * dest, size_t count)
+{
+	size_t i = 0;
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_shuffle_epi8(c, shuffle));
+	}
+	for (; i < count; ++i)
+	{
+		dest[i] = swapPixel(src[i]);
+	}
+}
+
+
+__attribute__((target("avx2")))
+void swapRedBlueAvx2(const uint32_t * src, uint32_t * dest, size_t count)
+{
+	size_t i = 0;
+	// _mm256_shuffle_epi8 works within 128-bit lanes, so the same pattern is repeated twice.
+	const __m256i shuffle = _mm256_setr_epi8(
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i), _mm256_shuffle_epi8(c, shuffle));
+	}
+	// Tail of up to 7 pixels
+	swapRedBlueSsse3(src + i, dest + i, count - i);
+}
+
+#endif // QANDROIDPIXELSWIZZLE_X86
+
+
+Implementation selectImplementation()
+{
+	Implementation best;
+	supportedImplementations(&best, 1);
+	return best;
+}
+
+
+const Implementation & implementation()
+{
+	static const Implementation s_implementation = selectImplementation();
+	return s_implementation;
+}
+
+} // anonymous namespace
+
+
+void swapRedBlueScalar(const uint32_t * src, uint32_t * dest, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		dest[i] = swapPixel(src[i]);
+	}
+}
+
+
+void swapRedBlue(const uint32_t * src, uint32_t * dest, size_t count)
+{
+	implementation().function(src, dest, count);
+}
+
+
+void swapRedBlue(
+	const uint8_t * src,
+	ptrdiff_t src_stride,
+	uint8_t * dest,
+	ptrdiff_t dest_stride,
+	int width,
+	int height)
+{
+	swapRedBlue(implementation().function, src, src_stride, dest, dest_stride, width, height);
+}
+
+
+void swapRedBlue(
+	SwapFunction function,
+	const uint8_t * src,
+	ptrdiff_t src_stride,
+	uint8_t * dest,
+	ptrdiff_t dest_stride,
+	int width,
+	int height)
+{
+	if (width <= 0 || height <= 0)
+	{
+		return;
+	}
+	const size_t row_bytes = static_cast<size_t>(width) * 4;
+	// Process contiguous images as a single run so there is only one tail.
+	if (src_stride == dest_stride && static_cast<size_t>(src_stride) == row_bytes)
+	{
+		function(
+			reinterpret_cast<const uint32_t *>(src),
+			reinterpret_cast<uint32_t *>(dest),
+			row_bytes / 4 * static_cast<size_t>(height));
+		return;
+	}
+	for (int y = 0; y < height; ++y, src += src_stride, dest += dest_stride)
+	{
+		function(
+			reinterpret_cast<const uint32_t *>(src),
+			reinterpret_cast<uint32_t *>(dest),
+			static_cast<size_t>(width));
+	}
+}
+
+
+const char * implementationName()
+{
+	return implementation().name;
+}
+
+
+int supportedImplementations(Implementation * out, int max_count)
+{
+	int count = 0;
+	auto add = [&](SwapFunction function, const char * name)
+	{
+		if (count < max_count)
+		{
+			out[count++] = { function, name };
+		}
+	};
+#if defined(QANDROIDPIXELSWIZZLE_NEON)
+	add(swapRedBlueNeon, "NEON");
+#elif defined(QANDROIDPIXELSWIZZLE_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		add(swapRedBlueAvx2, "AVX2");
+	}
+	if (__builtin_cpu_supports("ssse3"))
+	{
+		add(swapRedBlueSsse3, "SSSE3");
+	}
+	if (__builtin_cpu_supports("sse2"))
+	{
+		add(swapRedBlueSse2, "SSE2");
+	}
+#endif
+	add(swapRedBlueScalar, "scalar");
+	return count;
+}
+
+} // namespace QAndroidPixelSwizzle
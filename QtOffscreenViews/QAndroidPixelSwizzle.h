@@ -0,0 +1,93 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * Kernels swapping R and B channels of 32-bit pixels (ARGB <=> ABGR), used to convert
+ * images between Qt and Android color order. The best implementation for the CPU
+ * (NEON on ARM, SSE2 / SSSE3 / AVX2 on x86) is selected at runtime on the first call.
+ */
+namespace QAndroidPixelSwizzle {
+
+//! Swap R and B in 'count' pixels. src and dest may be the same buffer; other overlaps are not allowed.
+//! No alignment requirements beyond 4 bytes.
+void swapRedBlue(const uint32_t * src, uint32_t * dest, size_t count);
+
+//! Same for a rectangular area of 'width' x 'height' pixels with given strides in bytes.
+void swapRedBlue(
+	const uint8_t * src,
+	ptrdiff_t src_stride,
+	uint8_t * dest,
+	ptrdiff_t dest_stride,
+	int width,
+	int height);
+
+//! Name of the implementation selected for this CPU, for logging.
+const char * implementationName();
+
+//! Reference implementation.
+void swapRedBlueScalar(const uint32_t * src, uint32_t * dest, size_t count);
+
+//
+// Access to the individual kernels, for tests and benchmarks.
+//
+
+typedef void (*SwapFunction)(const uint32_t * src, uint32_t * dest, size_t count);
+
+struct Implementation
+{
+	SwapFunction function;
+	const char * name;
+};
+
+//! Fill 'out' with up to 'max_count' kernels supported by this CPU, best first; scalar is the last.
+//! Returns the number of kernels written.
+int supportedImplementations(Implementation * out, int max_count);
+
+//! Strided swap with the given kernel.
+void swapRedBlue(
+	SwapFunction function,
+	const uint8_t * src,
+	ptrdiff_t src_stride,
+	uint8_t * dest,
+	ptrdiff_t dest_stride,
+	int width,
+	int height);
+
+} // namespace QAndroidPixelSwizzle
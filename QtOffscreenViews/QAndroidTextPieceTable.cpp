@@ -0,0 +1,171 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "QAndroidTextPieceTable.h"
+#include <algorithm>
+
+
+namespace {
+
+// Edits are O(number of pieces), so merge them into one string when there are too many.
+const int c_MaxPieces = 512;
+
+} // anonymous namespace
+
+
+QAndroidTextPieceTable::QAndroidTextPieceTable()
+	: length_(0)
+	, text_cache_valid_(true)
+{
+}
+
+QAndroidTextPieceTable::QAndroidTextPieceTable(const QString & text)
+	: QAndroidTextPieceTable()
+{
+	setText(text);
+}
+
+void QAndroidTextPieceTable::setText(const QString & text)
+{
+	original_ = text;
+	added_.clear();
+	pieces_.clear();
+	length_ = text.length();
+	if (length_ > 0)
+	{
+		pieces_.append(Piece{false, 0, length_});
+	}
+	text_cache_ = text;
+	text_cache_valid_ = true;
+}
+
+void QAndroidTextPieceTable::appendPiece(QVector<Piece> & pieces, bool added, int start, int length) const
+{
+	if (length <= 0)
+	{
+		return;
+	}
+	// Characters typed one after another end up in a single piece.
+	if (!pieces.isEmpty())
+	{
+		Piece & last = pieces.last();
+		if (last.added == added && last.start + last.length == start)
+		{
+			last.length += length;
+			return;
+		}
+	}
+	pieces.append(Piece{added, start, length});
+}
+
+bool QAndroidTextPieceTable::replace(int position, int removed, const QString & inserted)
+{
+	if (position < 0 || removed < 0 || position > length_ || removed > length_ - position)
+	{
+		return false;
+	}
+	if (removed == 0 && inserted.isEmpty())
+	{
+		return true;
+	}
+
+	const int insert_start = added_.length();
+	added_.append(inserted);
+	const int end = position + removed;
+
+	QVector<Piece> pieces;
+	pieces.reserve(pieces_.size() + 2);
+	bool done_insert = false;
+	int offset = 0;
+	for (const Piece & piece : pieces_)
+	{
+		const int piece_end = offset + piece.length;
+		// Part of the piece before the edit.
+		if (offset < position)
+		{
+			appendPiece(pieces, piece.added, piece.start, std::min(piece_end, position) - offset);
+		}
+		if (!done_insert && position <= piece_end)
+		{
+			appendPiece(pieces, true, insert_start, inserted.length());
+			done_insert = true;
+		}
+		// Part of the piece after the removed range.
+		if (piece_end > end)
+		{
+			const int from = std::max(offset, end);
+			appendPiece(pieces, piece.added, piece.start + (from - offset), piece_end - from);
+		}
+		offset = piece_end;
+	}
+	if (!done_insert)
+	{
+		appendPiece(pieces, true, insert_start, inserted.length());
+	}
+
+	pieces_.swap(pieces);
+	length_ += inserted.length() - removed;
+	text_cache_valid_ = false;
+	text_cache_.clear();
+
+	if (pieces_.size() > c_MaxPieces)
+	{
+		compact();
+	}
+	return true;
+}
+
+QString QAndroidTextPieceTable::text() const
+{
+	if (!text_cache_valid_)
+	{
+		QString result;
+		result.reserve(length_);
+		for (const Piece & piece : pieces_)
+		{
+			const QString & source = (piece.added)? added_: original_;
+			result.append(source.constData() + piece.start, piece.length);
+		}
+		text_cache_ = result;
+		text_cache_valid_ = true;
+	}
+	return text_cache_;
+}
+
+void QAndroidTextPieceTable::compact()
+{
+	setText(text());
+}
@@ -0,0 +1,92 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+/*!
+ * Piece table text buffer for applying small edits to long texts. An edit adds
+ * the inserted characters to an append-only buffer and splits the list of pieces,
+ * so its cost does not depend on the text length. The pieces are merged back into
+ * a single string when there are too many of them.
+ *
+ * The class is not thread safe.
+ */
+class QAndroidTextPieceTable
+{
+public:
+	QAndroidTextPieceTable();
+	explicit QAndroidTextPieceTable(const QString & text);
+
+	void setText(const QString & text);
+	void clear() { setText(QString()); }
+
+	/*!
+	 * Replace \a removed characters at \a position with \a inserted.
+	 * \return false, and leave the text unchanged, if the range is out of the text.
+	 */
+	bool replace(int position, int removed, const QString & inserted);
+
+	int length() const { return length_; }
+	bool isEmpty() const { return length_ == 0; }
+
+	//! Assembles the whole text. The result is cached until the next change.
+	QString text() const;
+
+	//! Number of pieces the text currently consists of.
+	int pieceCount() const { return pieces_.size(); }
+
+private:
+	struct Piece
+	{
+		bool added;
+		int start;
+		int length;
+	};
+
+	void appendPiece(QVector<Piece> & pieces, bool added, int start, int length) const;
+	void compact();
+
+	//! The text at the time of setText() or of the last compaction.
+	QString original_;
+	//! Append-only storage of inserted characters.
+	QString added_;
+	QVector<Piece> pieces_;
+	int length_;
+	mutable QString text_cache_;
+	mutable bool text_cache_valid_;
+};
@@ -0,0 +1,287 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "QAndroidTiledPixelConverter.h"
+#include "QAndroidPixelSwizzle.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+
+namespace {
+
+// Below this size a conversion is faster than handing it to the pool. A parallel conversion
+// on N threads takes about dispatch + T / N, so it pays off for T > dispatch * N / (N - 1),
+// i.e. at least twice the pool round trip. tests/TiledPixelConverterBenchmark measures both
+// (and prints the break-even size) and sweeps sizes and thread counts.
+std::atomic<int> g_ParallelThreshold(512 * 512);
+
+// The conversion becomes memory bound at a few threads, and more threads mostly compete
+// with the render thread for the big cores; the benchmark sweep shows where it saturates.
+std::atomic<int> g_MaxThreads(4);
+std::atomic<bool> g_Oversubscribe(false);
+
+// Upper limit of setMaxThreadCount().
+const int c_MaxPoolThreads = 16;
+
+// Bands per thread, so threads finishing early can pick up the work of slower ones.
+const int c_BandsPerThread = 4;
+
+// Do not make bands smaller than this many bytes.
+const int c_MinBandBytes = 64 * 1024;
+
+
+struct BandJob
+{
+	const uint8_t * src;
+	ptrdiff_t src_stride;
+	uint8_t * dest;
+	ptrdiff_t dest_stride;
+	int width;
+	int height;
+	int band_rows;
+	int band_count;
+	std::atomic<int> next_band;
+	//! Number of helpers which may still join the conversion.
+	std::atomic<int> helper_slots;
+};
+
+
+void processBands(BandJob & job)
+{
+	for (;;)
+	{
+		const int band = job.next_band.fetch_add(1, std::memory_order_relaxed);
+		if (band >= job.band_count)
+		{
+			return;
+		}
+		const int first_row = band * job.band_rows;
+		QAndroidPixelSwizzle::swapRedBlue(
+			job.src + first_row * job.src_stride,
+			job.src_stride,
+			job.dest + first_row * job.dest_stride,
+			job.dest_stride,
+			job.width,
+			std::min(job.band_rows, job.height - first_row));
+	}
+}
+
+
+class BandWorkerPool
+{
+public:
+	~BandWorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (std::thread & thread: threads_)
+		{
+			thread.join();
+		}
+	}
+
+	//! Returns false if another conversion is running on the pool right now.
+	//! Starts more helpers if the job allows more than there are.
+	bool run(BandJob & job)
+	{
+		std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+		if (!run_lock.owns_lock())
+		{
+			return false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			while (static_cast<int>(threads_.size()) < job.helper_slots.load(std::memory_order_relaxed))
+			{
+				threads_.emplace_back(&BandWorkerPool::workerMain, this, generation_);
+			}
+			job_ = &job;
+			++generation_;
+		}
+		wake_.notify_all();
+
+		processBands(job);
+
+		// All bands have been taken; wait for the helpers still converting theirs.
+		// Helpers which have not woken up yet will find no job and go back to sleep.
+		std::unique_lock<std::mutex> lock(mutex_);
+		finished_.wait(lock, [this]{ return active_ == 0; });
+		job_ = nullptr;
+		return true;
+	}
+
+private:
+	void workerMain(unsigned long long seen_generation)
+	{
+		pthread_setname_np(pthread_self(), "QAndroidPixels");
+		std::unique_lock<std::mutex> lock(mutex_);
+		for (;;)
+		{
+			wake_.wait(lock, [&]{ return stop_ || generation_ != seen_generation; });
+			if (stop_)
+			{
+				return;
+			}
+			seen_generation = generation_;
+			BandJob * job = job_;
+			if (!job || job->helper_slots.fetch_sub(1, std::memory_order_relaxed) <= 0)
+			{
+				continue;
+			}
+			++active_;
+			lock.unlock();
+			processBands(*job);
+			lock.lock();
+			if (--active_ == 0)
+			{
+				finished_.notify_all();
+			}
+		}
+	}
+
+private:
+	std::vector<std::thread> threads_;
+	std::mutex run_mutex_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable finished_;
+	BandJob * job_ = nullptr;
+	unsigned long long generation_ = 0;
+	int active_ = 0;
+	bool stop_ = false;
+};
+
+
+BandWorkerPool & pool()
+{
+	// Intentionally leaked: the workers are blocked in wait() and may outlive
+	// static destruction order on process exit.
+	static BandWorkerPool * const instance = new BandWorkerPool();
+	return *instance;
+}
+
+} // anonymous namespace
+
+
+namespace QAndroidTiledPixelConverter {
+
+void swapRedBlue(
+	const uint8_t * src,
+	ptrdiff_t src_stride,
+	uint8_t * dest,
+	ptrdiff_t dest_stride,
+	int width,
+	int height)
+{
+	if (width <= 0 || height <= 0)
+	{
+		return;
+	}
+
+	if (static_cast<long long>(width) * height >= g_ParallelThreshold.load(std::memory_order_relaxed))
+	{
+		const int threads = threadCount();
+		if (threads > 1)
+		{
+			const int min_band_rows = std::max(1, c_MinBandBytes / (width * 4));
+			const int wanted_bands = threads * c_BandsPerThread;
+			const int band_rows = std::max(min_band_rows, (height + wanted_bands - 1) / wanted_bands);
+
+			BandJob job;
+			job.src = src;
+			job.src_stride = src_stride;
+			job.dest = dest;
+			job.dest_stride = dest_stride;
+			job.width = width;
+			job.height = height;
+			job.band_rows = band_rows;
+			job.band_count = (height + band_rows - 1) / band_rows;
+			job.next_band.store(0, std::memory_order_relaxed);
+			job.helper_slots.store(std::min(threads, job.band_count) - 1, std::memory_order_relaxed);
+
+			if (job.band_count > 1 && pool().run(job))
+			{
+				return;
+			}
+		}
+	}
+
+	QAndroidPixelSwizzle::swapRedBlue(src, src_stride, dest, dest_stride, width, height);
+}
+
+
+int parallelThreshold()
+{
+	return g_ParallelThreshold.load(std::memory_order_relaxed);
+}
+
+
+void setParallelThreshold(int pixels)
+{
+	g_ParallelThreshold.store(std::max(0, pixels), std::memory_order_relaxed);
+}
+
+
+int threadCount()
+{
+	static const int s_hardware_threads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+	const int threads = g_MaxThreads.load(std::memory_order_relaxed);
+	return (g_Oversubscribe.load(std::memory_order_relaxed))? threads: std::min(s_hardware_threads, threads);
+}
+
+
+int maxThreadCount()
+{
+	return g_MaxThreads.load(std::memory_order_relaxed);
+}
+
+
+void setMaxThreadCount(int threads, bool oversubscribe)
+{
+	g_MaxThreads.store(std::max(1, std::min(threads, c_MaxPoolThreads)), std::memory_order_relaxed);
+	g_Oversubscribe.store(oversubscribe, std::memory_order_relaxed);
+}
+
+} // namespace QAndroidTiledPixelConverter
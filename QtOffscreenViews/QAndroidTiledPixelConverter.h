@@ -0,0 +1,73 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * Multi-threaded R/B swap for large images. The image is split into bands of rows
+ * which are converted by a small persistent worker pool together with the calling
+ * thread. Images below parallelThreshold() pixels are converted on the calling thread.
+ * Only one parallel conversion runs at a time; concurrent callers fall back to
+ * converting on their own thread instead of queueing.
+ */
+namespace QAndroidTiledPixelConverter {
+
+//! Same contract as QAndroidPixelSwizzle::swapRedBlue() for rectangular areas.
+void swapRedBlue(
+	const uint8_t * src,
+	ptrdiff_t src_stride,
+	uint8_t * dest,
+	ptrdiff_t dest_stride,
+	int width,
+	int height);
+
+//! Minimum image size in pixels for the conversion to be split between threads.
+int parallelThreshold();
+void setParallelThreshold(int pixels);
+
+//! Number of threads participating in a parallel conversion, including the caller:
+//! maxThreadCount() limited by the number of CPU cores (unless oversubscribed).
+int threadCount();
+
+//! Default: 4. Helper threads are started when first needed.
+int maxThreadCount();
+//! \a oversubscribe: don't limit the threads by the number of CPU cores, which lets
+//! tests run the parallel path on any machine.
+void setMaxThreadCount(int threads, bool oversubscribe = false);
+
+} // namespace QAndroidTiledPixelConverter
@@ -45,10 +45,13 @@ QAndroidOffscreenViewGraphicsWidget::QAndroidOffscreenViewGraphicsWidget(QAndroi
 	, is_interactive_(interactive)
 {
 	aview_->setAttachingMode(interactive);
+	// QPainter draws the Android RGBA bitmap directly, no need to convert it.
+	aview_->setBitmapBufferZeroCopy(true);
     aview_->setFocused(false);
     setAcceptedMouseButtons(Qt::LeftButton);
 	setFocusPolicy(Qt::StrongFocus);
 	setFlag(QGraphicsItem::ItemSendsScenePositionChanges);
+	connect(aview_.data(), SIGNAL(damaged(QRect)), this, SLOT(onOffscreenDamaged(QRect)));
 	connect(aview_.data(), SIGNAL(updated()), this, SLOT(onOffscreenUpdated()));
 }
 
@@ -69,10 +72,28 @@ void QAndroidOffscreenViewGraphicsWidget::setEnabled(bool enabled)
 	QGraphicsWidget::setEnabled(enabled);
 }
 
+void QAndroidOffscreenViewGraphicsWidget::onOffscreenDamaged(const QRect & area)
+{
+	// qDebug()<<__PRETTY_FUNCTION__<<<<aview_->viewObjectName()<<area;
+	// damaged() comes right before updated(), which does the repaint.
+	pending_damage_ |= area;
+}
+
 void QAndroidOffscreenViewGraphicsWidget::onOffscreenUpdated()
 {
 	// qDebug()<<__PRETTY_FUNCTION__<<<<aview_->viewObjectName();
-	update();
+	// Not every update reports its area (e.g. fill colour or tiled scrolling changes),
+	// so repaint everything unless damaged() has narrowed it down. The view is painted
+	// at (0, 0) without scaling, so the area maps to the widget as is.
+	if (pending_damage_.isEmpty())
+	{
+		update();
+	}
+	else
+	{
+		update(QRectF(pending_damage_));
+		pending_damage_ = QRect();
+	}
 }
 
 void QAndroidOffscreenViewGraphicsWidget::paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget)
@@ -157,7 +178,17 @@ void QAndroidOffscreenViewGraphicsWidget::paint(QPainter * painter, const QStyle
 		const QImage * buffer = aview_->getBitmapBuffer();
 		if (buffer)
 		{
-			painter->drawImage(0, 0, *buffer);
+			// The bitmap may be larger than the view which is painted into its top-left part.
+			const QRect source = QRect(QPoint(0, 0), aview_->renderSize()) & buffer->rect();
+			if (aview_->renderScale() == 1.0f)
+			{
+				painter->drawImage(QPoint(0, 0), *buffer, source);
+			}
+			else
+			{
+				painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+				painter->drawImage(QRect(QPoint(0, 0), aview_->size()), *buffer, source);
+			}
 		}
 		else
 		{
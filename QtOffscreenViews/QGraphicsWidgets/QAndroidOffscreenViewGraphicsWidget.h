@@ -74,12 +74,14 @@ protected:
 	void updateViewPosition();
 
 private slots:
+	void onOffscreenDamaged(const QRect & area);
 	void onOffscreenUpdated();
 
 private:
 	QScopedPointer<QAndroidOffscreenView> aview_;
 	bool mouse_tracking_;
 	QPoint last_updated_position_;
+	QRect pending_damage_;
 	bool initial_visibilty_set_;
 private:
 	bool is_interactive_;
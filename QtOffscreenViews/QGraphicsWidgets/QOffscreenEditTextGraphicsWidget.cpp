@@ -35,9 +35,10 @@
 */
 
 #include "QOffscreenEditTextGraphicsWidget.h"
+#include "QAndroidOffscreenViewPool.h"
 
 
 QOffscreenEditTextGraphicsWidget::QOffscreenEditTextGraphicsWidget(const QString objectname, const QSize & def_size, QGraphicsItem *parent, Qt::WindowFlags wFlags)
-	: QAndroidOffscreenViewGraphicsWidget(new QAndroidOffscreenEditText(objectname, def_size), true, parent, wFlags)
+	: QAndroidOffscreenViewGraphicsWidget(QAndroidOffscreenViewPool::instance().take<QAndroidOffscreenEditText>(objectname, def_size), true, parent, wFlags)
 {
 }
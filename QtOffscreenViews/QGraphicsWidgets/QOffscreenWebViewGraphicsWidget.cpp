@@ -35,15 +35,28 @@
 */
 
 #include "QOffscreenWebViewGraphicsWidget.h"
+#include "QAndroidOffscreenViewPool.h"
 
 QOffscreenWebViewGraphicsWidget::QOffscreenWebViewGraphicsWidget(const QString & objectname, bool interactive, const QSize & def_size, QGraphicsItem *parent, Qt::WindowFlags wFlags)
-	: QAndroidOffscreenViewGraphicsWidget(new QAndroidOffscreenWebView(objectname, def_size), interactive, parent, wFlags)
+	: QAndroidOffscreenViewGraphicsWidget(QAndroidOffscreenViewPool::instance().take<QAndroidOffscreenWebView>(objectname, def_size), interactive, parent, wFlags)
 
 {
 	connect(androidOffscreenView(), SIGNAL(pageFinished()), this, SLOT(onPageFinished()));
 	connect(androidOffscreenView(), SIGNAL(contentHeightReceived(int)), this, SLOT(onContentHeightReceived(int)));
 }
 
+void QOffscreenWebViewGraphicsWidget::paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget)
+{
+	QAndroidOffscreenWebView * webview = androidOffscreenWebView();
+	if (webview->tiledRendering() && webview->isIntialized()
+		&& painter->paintEngine()->type() != QPaintEngine::OpenGL2)
+	{
+		webview->paintTiles(*painter, QRectF(QPointF(0, 0), size()));
+		return;
+	}
+	QAndroidOffscreenViewGraphicsWidget::paint(painter, option, widget);
+}
+
 void QOffscreenWebViewGraphicsWidget::onPageFinished()
 {
 	qDebug()<<__PRETTY_FUNCTION__;
@@ -53,6 +53,9 @@ public:
 	QAndroidOffscreenWebView * androidOffscreenWebView() { return static_cast<QAndroidOffscreenWebView*>(androidOffscreenView()); }
 	const QAndroidOffscreenWebView * androidOffscreenWebView() const { return static_cast<const QAndroidOffscreenWebView*>(androidOffscreenView()); }
 
+	//! Draws tiles directly with QPainter when the view is in tiled mode and GL is not used.
+	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+
 private slots:
 	void onPageFinished();
 	void onContentHeightReceived(int height);
@@ -40,13 +40,44 @@
 #include <QtOpenGL/QOpenGLFunctions_ES2>
 #include <QtOpenGL/QOpenGLTexture>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
 #include <QtGui/QImage>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLExtraFunctions>
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+#include <vector>
 
 #include "QOpenGLTextureHolder.h"
 
 
 #define QT_OPENGL_ES_2
 
+// GL ES 3 / GL_EXT_unpack_subimage
+#ifndef GL_UNPACK_ROW_LENGTH
+	#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+
+// GL ES 3 / GL 2.1 pixel buffer objects
+#ifndef GL_PIXEL_UNPACK_BUFFER
+	#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+	#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_MAP_WRITE_BIT
+	#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+	#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+
 
 namespace
 {
@@ -92,18 +123,310 @@ QImage convertToGLFormat(const QImage & image)
 	return result;
 }
 
+bool unpackRowLengthSupported()
+{
+	const QOpenGLContext * context = QOpenGLContext::currentContext();
+	return context && (
+		context->format().majorVersion() >= 3 ||
+		context->hasExtension(QByteArrayLiteral("GL_EXT_unpack_subimage")));
+}
+
+
+/*!
+ * Recently released GL_TEXTURE_2D textures with their storage, so a view which is
+ * re-created or resized back and forth doesn't make the driver reallocate memory.
+ * Textures are shared between contexts of a share group, so the pool is per group;
+ * when the group is destroyed its textures are gone with it.
+ * The pool is limited by the number of textures and by bytes per group, and textures
+ * not reused within c_max_age_ms are deleted. Textures can be deleted only with a context
+ * of their group current, so expiry and trim requests are carried out the next time
+ * the pool is used in that group. The pool can be disabled, e.g. while the app is in
+ * background, so released textures are deleted right away.
+ */
+class TexturePool
+{
+public:
+	TexturePool()
+	{
+		clock_.start();
+	}
+
+	//! Takes ownership of the texture. Should be called with a current GL context.
+	void put(GLuint texture, const QSize & size, GLenum format, GLenum pixel_type)
+	{
+		QOpenGLContextGroup * group = QOpenGLContextGroup::currentContextGroup();
+		const qint64 bytes = textureBytes(size, format, pixel_type);
+		if (!group || bytes > c_max_bytes_per_group)
+		{
+			glDeleteTextures(1, &texture);
+			return;
+		}
+
+		QMutexLocker locker(&mutex_);
+		collectLocked(group);
+		if (!enabled_)
+		{
+			glDeleteTextures(1, &texture);
+			return;
+		}
+		watchGroup(group);
+
+		// Make room, deleting the oldest textures first.
+		size_t group_count = 0;
+		qint64 group_bytes = bytes;
+		for (const Entry & entry: entries_)
+		{
+			if (entry.group == group)
+			{
+				++group_count;
+				group_bytes += entry.bytes;
+			}
+		}
+		for (auto it = entries_.begin(); it != entries_.end()
+			&& (group_count >= c_max_textures_per_group || group_bytes > c_max_bytes_per_group);)
+		{
+			if (it->group == group)
+			{
+				--group_count;
+				group_bytes -= it->bytes;
+				glDeleteTextures(1, &it->texture);
+				it = entries_.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		entries_.push_back({ group, texture, size, format, pixel_type, bytes, clock_.elapsed() });
+	}
+
+	//! Returns 0 if there is no suitable texture.
+	GLuint take(const QSize & size, GLenum format, GLenum pixel_type)
+	{
+		QOpenGLContextGroup * group = QOpenGLContextGroup::currentContextGroup();
+		if (!group)
+		{
+			return 0;
+		}
+
+		QMutexLocker locker(&mutex_);
+		collectLocked(group);
+		// Prefer most recently released textures.
+		for (auto it = entries_.rbegin(); it != entries_.rend(); ++it)
+		{
+			if (it->group == group && it->size == size && it->format == format && it->pixel_type == pixel_type)
+			{
+				const GLuint texture = it->texture;
+				entries_.erase(std::next(it).base());
+				return texture;
+			}
+		}
+		return 0;
+	}
+
+	//! Deletes expired textures of the current context group, or all of them if trim()
+	//! has been requested. Cheap when there is nothing to do.
+	void collect()
+	{
+		QOpenGLContextGroup * group = QOpenGLContextGroup::currentContextGroup();
+		if (!group)
+		{
+			return;
+		}
+		QMutexLocker locker(&mutex_);
+		collectLocked(group);
+	}
+
+	//! Deletes all textures of the current context group.
+	void trim()
+	{
+		QOpenGLContextGroup * group = QOpenGLContextGroup::currentContextGroup();
+		QMutexLocker locker(&mutex_);
+		deleteLocked(group, [](const Entry &) { return true; });
+	}
+
+	//! Can be called from any thread. Textures of all groups are deleted the next time
+	//! the pool is used in each group.
+	void requestTrim()
+	{
+		QMutexLocker locker(&mutex_);
+		for (const Entry & entry: entries_)
+		{
+			if (!trim_groups_.contains(entry.group))
+			{
+				trim_groups_.append(entry.group);
+			}
+		}
+	}
+
+	//! Can be called from any thread. While disabled, released textures are deleted.
+	void setEnabled(bool enabled)
+	{
+		QMutexLocker locker(&mutex_);
+		enabled_ = enabled;
+	}
+
+private:
+	struct Entry
+	{
+		QOpenGLContextGroup * group;
+		GLuint texture;
+		QSize size;
+		GLenum format;
+		GLenum pixel_type;
+		qint64 bytes;
+		qint64 released_ms;
+	};
+
+	static qint64 textureBytes(const QSize & size, GLenum format, GLenum pixel_type)
+	{
+		int bytes_per_pixel = 4;
+		if (pixel_type == GL_UNSIGNED_SHORT_5_6_5 || pixel_type == GL_UNSIGNED_SHORT_4_4_4_4 || pixel_type == GL_UNSIGNED_SHORT_5_5_5_1)
+		{
+			bytes_per_pixel = 2;
+		}
+		else if (format == GL_RGB)
+		{
+			bytes_per_pixel = 3;
+		}
+		else if (format == GL_LUMINANCE || format == GL_ALPHA)
+		{
+			bytes_per_pixel = 1;
+		}
+		else if (format == GL_LUMINANCE_ALPHA)
+		{
+			bytes_per_pixel = 2;
+		}
+		return static_cast<qint64>(size.width()) * size.height() * bytes_per_pixel;
+	}
+
+	template<class Predicate> void deleteLocked(QOpenGLContextGroup * group, Predicate predicate)
+	{
+		for (auto it = entries_.begin(); it != entries_.end();)
+		{
+			if (it->group == group && predicate(*it))
+			{
+				glDeleteTextures(1, &it->texture);
+				it = entries_.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	void collectLocked(QOpenGLContextGroup * group)
+	{
+		if (trim_groups_.removeAll(group) > 0)
+		{
+			deleteLocked(group, [](const Entry &) { return true; });
+			return;
+		}
+		const qint64 expired_ms = clock_.elapsed() - c_max_age_ms;
+		deleteLocked(group, [expired_ms](const Entry & entry) { return entry.released_ms < expired_ms; });
+	}
+
+	//! Should be called with mutex_ locked. Connects to the group's destruction only once.
+	void watchGroup(QOpenGLContextGroup * group)
+	{
+		if (watched_groups_.contains(group))
+		{
+			return;
+		}
+		watched_groups_.append(group);
+		QObject::connect(group, &QObject::destroyed, [this, group]() {
+			QMutexLocker locker(&mutex_);
+			entries_.erase(
+				std::remove_if(entries_.begin(), entries_.end(), [group](const Entry & entry) { return entry.group == group; }),
+				entries_.end());
+			trim_groups_.removeAll(group);
+			watched_groups_.removeAll(group);
+		});
+	}
+
+	static const size_t c_max_textures_per_group = 4;
+	//! Two full screen RGBA textures on a 1440x3000 display.
+	static const qint64 c_max_bytes_per_group = 2 * 1440 * 3000 * 4;
+	static const qint64 c_max_age_ms = 10000;
+	QMutex mutex_;
+	QElapsedTimer clock_;
+	std::vector<Entry> entries_;
+	QVector<QOpenGLContextGroup *> trim_groups_;
+	QVector<QOpenGLContextGroup *> watched_groups_;
+	bool enabled_ = true;
+};
+
+TexturePool & texturePool()
+{
+	// Intentionally leaked: contexts may be destroyed after static destructors.
+	static TexturePool * const pool = new TexturePool();
+	return *pool;
+}
+
+
+/*!
+ * Blit shader programs of each GL share group. Programs can't be used in contexts
+ * of other groups, and should be gone together with their group.
+ */
+class BlitProgramCache
+{
+public:
+	typedef QPair<GLenum, bool> Key;
+
+	QSharedPointer<QOpenGLShaderProgram> find(QOpenGLContextGroup * group, const Key & key)
+	{
+		QMutexLocker locker(&mutex_);
+		return programs_.value(group).value(key);
+	}
+
+	void put(QOpenGLContextGroup * group, const Key & key, const QSharedPointer<QOpenGLShaderProgram> & program)
+	{
+		QMutexLocker locker(&mutex_);
+		if (!programs_.contains(group))
+		{
+			QObject::connect(group, &QObject::destroyed, [this, group]() {
+				QMutexLocker locker(&mutex_);
+				programs_.remove(group);
+			});
+		}
+		programs_[group][key] = program;
+	}
+
+	void clear()
+	{
+		QMutexLocker locker(&mutex_);
+		programs_.clear();
+	}
+
+private:
+	QMutex mutex_;
+	QMap<QOpenGLContextGroup *, QMap<Key, QSharedPointer<QOpenGLShaderProgram> > > programs_;
+};
+
+BlitProgramCache & blitProgramCache()
+{
+	// Intentionally leaked, see texturePool().
+	static BlitProgramCache * const cache = new BlitProgramCache();
+	return *cache;
+}
+
 } // anonymous namespace
 
 
 static const GLuint c_vertex_coordinates_attr  = 0;
 static const GLuint c_texture_coordinates_attr = 1;
 
-QMap<GLenum, QSharedPointer<QOpenGLShaderProgram> > QOpenGLTextureHolder::blit_programs_;
-
 QOpenGLTextureHolder::QOpenGLTextureHolder(GLenum type, const QSize & size)
 	: texture_id_(0)
 	, texture_type_(type)
 	, texture_size_(size)
+	, storage_format_(0)
+	, storage_pixel_type_(0)
+	, pixel_buffers_{0, 0, 0}
+	, next_pixel_buffer_(0)
+	, swizzle_red_blue_(false)
+	, swizzled_uploads_(false)
 	, a11_(1.0f), a12_(0)
 	, a21_(0), a22_(1.0f)
 	, b1_(0), b2_(0)
@@ -116,6 +439,12 @@ QOpenGLTextureHolder::QOpenGLTextureHolder()
 	: texture_id_(0)
 	, texture_type_(GL_TEXTURE_2D)
 	, texture_size_(64, 64)
+	, storage_format_(0)
+	, storage_pixel_type_(0)
+	, pixel_buffers_{0, 0, 0}
+	, next_pixel_buffer_(0)
+	, swizzle_red_blue_(false)
+	, swizzled_uploads_(false)
 	, a11_(1.0f), a12_(0), a21_(0), a22_(1.0f), b1_(0), b2_(0)
 {
 }
@@ -123,15 +452,27 @@ QOpenGLTextureHolder::QOpenGLTextureHolder()
 QOpenGLTextureHolder::~QOpenGLTextureHolder()
 {
 	deallocateTexture();
+	releasePixelBuffers();
 }
 
 void QOpenGLTextureHolder::deallocateTexture()
 {
 	if (texture_id_ != 0)
 	{
-		glDeleteTextures(1, &texture_id_);
+		if (texture_type_ == GL_TEXTURE_2D && !storage_size_.isEmpty())
+		{
+			texturePool().put(texture_id_, storage_size_, storage_format_, storage_pixel_type_);
+		}
+		else
+		{
+			glDeleteTextures(1, &texture_id_);
+		}
 		texture_id_ = 0;
 	}
+	storage_size_ = QSize();
+	storage_format_ = 0;
+	storage_pixel_type_ = 0;
+	swizzle_red_blue_ = false;
 	setTransformation(
 		1.0f, 0.0f,
 		0.0f, 1.0f,
@@ -154,27 +495,39 @@ static inline void QRectFToVertexArray(const QRectF & r, GLfloat * array)
 	array[7] = bottom;
 }
 
-QOpenGLShaderProgram * QOpenGLTextureHolder::GetBlitProgram(GLenum target)
+QOpenGLShaderProgram * QOpenGLTextureHolder::GetBlitProgram(GLenum target, bool swizzle_red_blue)
 {
 	#if !defined(QT_OPENGL_ES_2)
 		qFatal("GetBlitProgram should not be called if not using OpenGL ES 2.");
 		Q_UNUSED(target);
+		Q_UNUSED(swizzle_red_blue);
 		return 0; // Not supported by current GL version!
 	#else
-		if (blit_programs_.isEmpty())
+		QOpenGLContextGroup * group = QOpenGLContextGroup::currentContextGroup();
+		if (!group)
 		{
-			qAddPostRoutine([]() {
-				blit_programs_.clear();
-			});
+			qWarning()<<"Can't get blit shader program without current GL context.";
+			return nullptr;
 		}
 
-		QSharedPointer<QOpenGLShaderProgram> & blit_program_ptr = blit_programs_[target];
+		const BlitProgramCache::Key key = qMakePair(target, swizzle_red_blue);
+		QSharedPointer<QOpenGLShaderProgram> blit_program_ptr = blitProgramCache().find(group, key);
 		if (!blit_program_ptr.isNull())
 		{
 			return blit_program_ptr.data();
 		}
 
-		qDebug()<<"Creating blit shaders for tetxure type"<<target;
+		static const bool post_routine_added = []() {
+			qAddPostRoutine([]() {
+				blitProgramCache().clear();
+			});
+			return true;
+		}();
+		Q_UNUSED(post_routine_added);
+
+		qDebug()<<"Creating blit shaders for tetxure type"<<target<<"swizzle:"<<swizzle_red_blue;
+		QElapsedTimer timer;
+		timer.start();
 
 		static const QLatin1String qglslMainWithTexCoordsVertexShader(
 			"attribute highp vec2 textureCoordArray; \n"
@@ -200,6 +553,14 @@ QOpenGLShaderProgram * QOpenGLTextureHolder::GetBlitProgram(GLenum target)
 			"  gl_FragColor = srcPixel(); \n"
 			"}\n");
 
+		// Swaps R and B at sampling time, for textures loaded from Qt's BGRA memory order.
+		static const QLatin1String qglslSwizzledMainFragmentShader(
+			"lowp vec4 srcPixel(); \n"
+			"void main() \n"
+			"{ \n"
+			"  gl_FragColor = srcPixel().bgra; \n"
+			"}\n");
+
 		QString qglslImageSrcFragmentShader;
 		if (target == GL_TEXTURE_EXTERNAL_OES)
 		{
@@ -224,16 +585,16 @@ QOpenGLShaderProgram * QOpenGLTextureHolder::GetBlitProgram(GLenum target)
 				"}\n");
 		}
 
+		// Cacheable shaders are not compiled here: on link(), QOpenGLShaderProgram loads the program
+		// binary from its disk cache in the app cache directory if the sources and the GL driver
+		// (vendor, renderer and version) are the same, and stores the binary there otherwise.
+		// Qt::AA_DisableShaderDiskCache turns that off.
 		blit_program_ptr = QSharedPointer<QOpenGLShaderProgram>(new QOpenGLShaderProgram());
 		{
 			QString source;
 			source.append(qglslMainWithTexCoordsVertexShader);
 			source.append(qglslUntransformedPositionVertexShader);
-
-			QOpenGLShader * vertexShader = new QOpenGLShader(QOpenGLShader::Vertex, blit_program_ptr.data());
-			vertexShader->compileSourceCode(source);
-
-			blit_program_ptr->addShader(vertexShader);
+			blit_program_ptr->addCacheableShaderFromSourceCode(QOpenGLShader::Vertex, source);
 		}
 
 		{
@@ -241,19 +602,21 @@ QOpenGLShaderProgram * QOpenGLTextureHolder::GetBlitProgram(GLenum target)
 			// Fragment shader may contain #extension directive, and it should be before any other code,
 			// as some drivers won't compile a shader with #extension in a middle.
 			source.append(qglslImageSrcFragmentShader);
-			source.append(qglslMainFragmentShader);
-
-			QOpenGLShader * fragmentShader = new QOpenGLShader(QOpenGLShader::Fragment, blit_program_ptr.data());
-			fragmentShader->compileSourceCode(source);
-
-			blit_program_ptr->addShader(fragmentShader);
+			source.append((swizzle_red_blue)? qglslSwizzledMainFragmentShader: qglslMainFragmentShader);
+			blit_program_ptr->addCacheableShaderFromSourceCode(QOpenGLShader::Fragment, source);
 		}
 
 		blit_program_ptr->bindAttributeLocation("vertexCoordsArray", c_vertex_coordinates_attr);
 		blit_program_ptr->bindAttributeLocation("textureCoordArray", c_texture_coordinates_attr);
 
-		blit_program_ptr->link();
+		if (!blit_program_ptr->link())
+		{
+			qWarning()<<"Failed to link blit shaders:"<<blit_program_ptr->log();
+		}
+		qDebug()<<"Blit shaders for texture type"<<target<<"swizzle:"<<swizzle_red_blue
+			<<"are ready in"<<timer.nsecsElapsed() / 1000<<"us";
 
+		blitProgramCache().put(group, key, blit_program_ptr);
 		return blit_program_ptr.data();
 	#endif // ES 2.0
 }
@@ -277,7 +640,7 @@ void QOpenGLTextureHolder::blitTexture(const QRect & targetRect, const QRect & s
 		// glDisable(GL_SCISSOR_TEST);
 		glDisable(GL_BLEND);
 
-		QOpenGLShaderProgram * blitProgram = GetBlitProgram(texture_type_);
+		QOpenGLShaderProgram * blitProgram = GetBlitProgram(texture_type_, swizzle_red_blue_);
 		if (!blitProgram || !blitProgram->isLinked())
 		{
 			qWarning()<<"Shader program is not linked, can't blit the texture.";
@@ -447,16 +810,11 @@ void QOpenGLTextureHolder::allocateTexture(GLenum type)
 void QOpenGLTextureHolder::allocateTexture(const QImage & qimage, GLenum texture_type, bool gl_prepared,
 	GLenum prepared_image_type, GLenum prepared_pixel_type)
 {
-	deallocateTexture();
 	if (qimage.isNull() || qimage.width() < 1 || qimage.height() < 1)
 	{
+		deallocateTexture();
 		return;
 	}
-	texture_type_ = texture_type;
-	texture_size_ = qimage.size();
-	a11_ = 1.0f; a12_ = 0.0f;
-	a21_ = 0.0f; a22_ = 1.0f;
-	b1_ = 0; b2_ = 0;
 
 	// Prepare image data in bits
 	const uchar * bits = 0;
@@ -478,6 +836,7 @@ void QOpenGLTextureHolder::allocateTexture(const QImage & qimage, GLenum texture
 		if (gl_image.isNull())
 		{
 			qCritical()<<"Failed to convert QImage to GL format!";
+			deallocateTexture();
 			return;
 		}
 		bits = gl_image.bits();
@@ -485,18 +844,55 @@ void QOpenGLTextureHolder::allocateTexture(const QImage & qimage, GLenum texture
 		height = gl_image.height();
 	}
 
-	// Create texture and load bits into its memory
-	glGenTextures(1, &texture_id_);
-	glBindTexture(texture_type, texture_id_);
-	glTexImage2D(texture_type, 0, static_cast<GLint>(type), width, height, 0, type, pixel_type, bits);
-	glTexParameteri(texture_type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(texture_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glBindTexture(texture_type, 0);
+	// Keep the texture and its storage if they match the image, otherwise try to reuse a pooled one.
+	const QSize size(width, height);
+	if (!(texture_id_ != 0 && texture_type_ == texture_type && texture_type == GL_TEXTURE_2D
+		&& storage_size_ == size && storage_format_ == type && storage_pixel_type_ == pixel_type))
+	{
+		deallocateTexture();
+		if (texture_type == GL_TEXTURE_2D)
+		{
+			texture_id_ = texturePool().take(size, type, pixel_type);
+		}
+	}
+	texture_type_ = texture_type;
+	texture_size_ = qimage.size();
+	a11_ = 1.0f; a12_ = 0.0f;
+	a21_ = 0.0f; a22_ = 1.0f;
+	b1_ = 0; b2_ = 0;
+
+	if (texture_id_ != 0)
+	{
+		glBindTexture(texture_type, texture_id_);
+		glTexSubImage2D(texture_type, 0, 0, 0, width, height, type, pixel_type, bits);
+		glBindTexture(texture_type, 0);
+	}
+	else
+	{
+		// Create texture and load bits into its memory
+		glGenTextures(1, &texture_id_);
+		glBindTexture(texture_type, texture_id_);
+		glTexImage2D(texture_type, 0, static_cast<GLint>(type), width, height, 0, type, pixel_type, bits);
+		glTexParameteri(texture_type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(texture_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(texture_type, 0);
+	}
+	storage_size_ = size;
+	storage_format_ = type;
+	storage_pixel_type_ = pixel_type;
 }
 
 void QOpenGLTextureHolder::allocateTexture(const QImage & qimage, bool real_32bit_format_is_qt_abgr, GLenum texture_type)
 {
+	const bool is_32bit =
+		qimage.format() == QImage::Format_ARGB32_Premultiplied ||
+		qimage.format() == QImage::Format_ARGB32 ||
+		qimage.format() == QImage::Format_RGB32;
+	// With swizzled uploads, Qt's own 32-bit formats (BGRA in memory) are loaded as is too
+	// and R and B are swapped by the blit shader, so no CPU conversion is necessary for them.
+	const bool swizzle = swizzled_uploads_ && is_32bit && !real_32bit_format_is_qt_abgr;
 	bool avoid_gl_conversion =
+		swizzle ||
 		(real_32bit_format_is_qt_abgr && (
 			qimage.format() == QImage::Format_ARGB32_Premultiplied ||
 			qimage.format() == QImage::Format_ARGB32)) ||
@@ -504,14 +900,210 @@ void QOpenGLTextureHolder::allocateTexture(const QImage & qimage, bool real_32bi
 	GLenum pixel_type = (qimage.format() == QImage::Format_RGB16)? GL_UNSIGNED_SHORT_5_6_5: GL_UNSIGNED_BYTE;
 	GLenum type = (qimage.format() == QImage::Format_RGB16)? GL_RGB: GL_RGBA;
 	allocateTexture(qimage, texture_type, avoid_gl_conversion, type, pixel_type);
-	if (avoid_gl_conversion)
+	if (avoid_gl_conversion && isAllocated())
 	{
 		// Fixing Y axis by setting this texture transformation.
 		setTransformation(
 			1.0f,  0.0f,
 			0.0f, -1.0f,
 			0, 0);
+		swizzle_red_blue_ = swizzle;
+	}
+}
+
+bool QOpenGLTextureHolder::canUpdateInPlace(const QImage & qimage, bool real_32bit_format_is_qt_abgr,
+	GLenum * out_type, GLenum * out_pixel_type, int * out_bytes_per_pixel) const
+{
+	if (texture_id_ == 0 || texture_type_ != GL_TEXTURE_2D || qimage.size() != storage_size_)
+	{
+		return false;
+	}
+
+	GLenum type = GL_RGBA;
+	GLenum pixel_type = GL_UNSIGNED_BYTE;
+	int bytes_per_pixel = 4;
+	if (qimage.format() == QImage::Format_RGB16)
+	{
+		type = GL_RGB;
+		pixel_type = GL_UNSIGNED_SHORT_5_6_5;
+		bytes_per_pixel = 2;
+	}
+	else if (qimage.format() != QImage::Format_ARGB32_Premultiplied &&
+		qimage.format() != QImage::Format_ARGB32 &&
+		qimage.format() != QImage::Format_RGB32)
+	{
+		return false;
+	}
+	else if (real_32bit_format_is_qt_abgr == swizzle_red_blue_)
+	{
+		// The texture has been loaded with the other color order.
+		return false;
+	}
+	if (type != storage_format_ || pixel_type != storage_pixel_type_)
+	{
+		return false;
+	}
+
+	*out_type = type;
+	*out_pixel_type = pixel_type;
+	*out_bytes_per_pixel = bytes_per_pixel;
+	return true;
+}
+
+bool QOpenGLTextureHolder::updateTexture(const QImage & qimage, const QRect & area, bool real_32bit_format_is_qt_abgr)
+{
+	GLenum type = 0, pixel_type = 0;
+	int bytes_per_pixel = 0;
+	if (!canUpdateInPlace(qimage, real_32bit_format_is_qt_abgr, &type, &pixel_type, &bytes_per_pixel))
+	{
+		return false;
+	}
+
+	const QRect rect = area & qimage.rect();
+	if (rect.isEmpty())
+	{
+		return true;
+	}
+
+	const bool packed = qimage.bytesPerLine() == qimage.width() * bytes_per_pixel;
+	if (rect.width() != qimage.width() || !packed)
+	{
+		if (unpackRowLengthSupported())
+		{
+			// Upload exactly the rectangle, reading rows with the image stride.
+			glBindTexture(texture_type_, texture_id_);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, qimage.bytesPerLine() / bytes_per_pixel);
+			glTexSubImage2D(texture_type_, 0, rect.left(), rect.top(), rect.width(), rect.height(),
+				type, pixel_type, qimage.constScanLine(rect.top()) + rect.left() * bytes_per_pixel);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+			glBindTexture(texture_type_, 0);
+			return true;
+		}
+		// Plain GL ES 2 can upload only whole rows of tightly packed images.
+		if (!packed)
+		{
+			return false;
+		}
+	}
+
+	glBindTexture(texture_type_, texture_id_);
+	glTexSubImage2D(texture_type_, 0, 0, rect.top(), qimage.width(), rect.height(),
+		type, pixel_type, qimage.constScanLine(rect.top()));
+	glBindTexture(texture_type_, 0);
+	return true;
+}
+
+bool QOpenGLTextureHolder::pixelBuffersSupported()
+{
+	const QOpenGLContext * context = QOpenGLContext::currentContext();
+	if (!context)
+	{
+		return false;
+	}
+	const QSurfaceFormat format = context->format();
+	if (context->isOpenGLES())
+	{
+		return format.majorVersion() >= 3;
 	}
+	// Pixel buffer objects are core since 2.1, but glMapBufferRange() needs 3.0 or the
+	// extension (which exports it under the same name, so QOpenGLExtraFunctions resolves it).
+	return format.majorVersion() >= 3
+		|| (format.version() >= qMakePair(2, 1) && context->hasExtension(QByteArrayLiteral("GL_ARB_map_buffer_range")));
+}
+
+bool QOpenGLTextureHolder::streamTexture(const QImage & qimage, const QRect & area, bool real_32bit_format_is_qt_abgr)
+{
+	GLenum type = 0, pixel_type = 0;
+	int bytes_per_pixel = 0;
+	if (!canUpdateInPlace(qimage, real_32bit_format_is_qt_abgr, &type, &pixel_type, &bytes_per_pixel)
+		|| !pixelBuffersSupported())
+	{
+		return false;
+	}
+
+	const QRect rect = area & qimage.rect();
+	if (rect.isEmpty())
+	{
+		return true;
+	}
+
+	QOpenGLExtraFunctions * gl = QOpenGLContext::currentContext()->extraFunctions();
+
+	// Rows in the buffer are padded to the default GL_UNPACK_ALIGNMENT of 4.
+	const int src_row_bytes = rect.width() * bytes_per_pixel;
+	const int row_bytes = (src_row_bytes + 3) & ~3;
+	const GLsizeiptr buffer_size = static_cast<GLsizeiptr>(row_bytes) * rect.height();
+
+	if (pixel_buffers_[0] == 0)
+	{
+		gl->glGenBuffers(c_pixel_buffer_count, pixel_buffers_);
+	}
+	const GLuint buffer = pixel_buffers_[next_pixel_buffer_];
+	next_pixel_buffer_ = (next_pixel_buffer_ + 1) % c_pixel_buffer_count;
+
+	// While the GPU may still be reading the buffers used for previous frames, we fill the next one.
+	// Re-specifying the storage orphans the old one, so mapping never waits for the GPU.
+	gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	gl->glBufferData(GL_PIXEL_UNPACK_BUFFER, buffer_size, nullptr, GL_STREAM_DRAW);
+	uchar * dest = static_cast<uchar *>(gl->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, buffer_size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	if (!dest)
+	{
+		gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return false;
+	}
+	const uchar * src = qimage.constScanLine(rect.top()) + rect.left() * bytes_per_pixel;
+	for (int y = 0; y < rect.height(); ++y, src += qimage.bytesPerLine(), dest += row_bytes)
+	{
+		memcpy(dest, src, static_cast<size_t>(src_row_bytes));
+	}
+	if (!gl->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
+	{
+		// The buffer contents have been lost (e.g. screen mode change).
+		gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return false;
+	}
+
+	// The upload from the buffer is asynchronous.
+	glBindTexture(texture_type_, texture_id_);
+	glTexSubImage2D(texture_type_, 0, rect.left(), rect.top(), rect.width(), rect.height(),
+		type, pixel_type, nullptr);
+	glBindTexture(texture_type_, 0);
+	gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return true;
+}
+
+void QOpenGLTextureHolder::releasePixelBuffers()
+{
+	if (pixel_buffers_[0] != 0)
+	{
+		glDeleteBuffers(c_pixel_buffer_count, pixel_buffers_);
+		for (GLuint & buffer: pixel_buffers_)
+		{
+			buffer = 0;
+		}
+	}
+	next_pixel_buffer_ = 0;
+}
+
+void QOpenGLTextureHolder::trimTexturePool()
+{
+	texturePool().trim();
+}
+
+void QOpenGLTextureHolder::collectTexturePool()
+{
+	texturePool().collect();
+}
+
+void QOpenGLTextureHolder::requestTexturePoolTrim()
+{
+	texturePool().requestTrim();
+}
+
+void QOpenGLTextureHolder::setTexturePoolEnabled(bool enabled)
+{
+	texturePool().setEnabled(enabled);
 }
 
 void QOpenGLTextureHolder::allocateTexture(const QString & filename)
@@ -523,9 +1115,210 @@ void QOpenGLTextureHolder::initializeGL(bool init_extension)
 {
 	qDebug()<<"QOpenGLTextureHolder::initializeGL() Checking shader programs...";
 	GetBlitProgram(GL_TEXTURE_2D);
+	GetBlitProgram(GL_TEXTURE_2D, true);
 	if (init_extension)
 	{
 		GetBlitProgram(GL_TEXTURE_EXTERNAL_OES);
 	}
 }
 
+
+QOpenGLTextureBatch::QOpenGLTextureBatch()
+	: vertex_buffer_(0)
+	, vertex_buffer_size_(0)
+{
+}
+
+QOpenGLTextureBatch::~QOpenGLTextureBatch()
+{
+	releaseGL();
+}
+
+void QOpenGLTextureBatch::releaseGL()
+{
+	if (vertex_buffer_ != 0)
+	{
+		glDeleteBuffers(1, &vertex_buffer_);
+		vertex_buffer_ = 0;
+	}
+	vertex_buffer_size_ = 0;
+}
+
+void QOpenGLTextureBatch::add(const QOpenGLTextureHolder & texture, const QRectF & targetRect,
+	const QRect & sourceRect, bool reverse_y)
+{
+	if (!texture.isAllocated() || targetRect.isEmpty())
+	{
+		return;
+	}
+
+	// Convert in-texture coords to [0..1]
+	const QSize size = texture.getTextureSize().isEmpty()? QSize(1, 1): texture.getTextureSize();
+	const QRectF src = sourceRect.isEmpty()? QRectF(QPointF(), QSizeF(size)): QRectF(sourceRect);
+	const GLfloat tx1 = src.left() / size.width();
+	const GLfloat tx2 = src.right() / size.width();
+	GLfloat ty1 = src.top() / size.height();
+	GLfloat ty2 = src.bottom() / size.height();
+	if (reverse_y)
+	{
+		qSwap(ty1, ty2);
+	}
+
+	Entry entry;
+	entry.texture = texture.texture_id_;
+	entry.type = texture.texture_type_;
+	entry.swizzle_red_blue = texture.swizzle_red_blue_;
+	entry.target = targetRect;
+
+	// Same corners as in QOpenGLTextureHolder::drawTexture(), with the texture transformation
+	// applied to each of them.
+	const GLfloat corners[4][2] = { { tx1, ty2 }, { tx2, ty2 }, { tx2, ty1 }, { tx1, ty1 } };
+	for (int i = 0; i < 4; ++i)
+	{
+		entry.tex_coords[i * 2] = texture.a11_ * corners[i][0] + texture.a12_ * corners[i][1] + texture.b1_;
+		entry.tex_coords[i * 2 + 1] = texture.a21_ * corners[i][0] + texture.a22_ * corners[i][1] + texture.b2_;
+	}
+	entries_.push_back(entry);
+}
+
+int QOpenGLTextureBatch::draw(const QSize & viewportSize)
+{
+	if (entries_.empty() || viewportSize.isEmpty())
+	{
+		entries_.clear();
+		return 0;
+	}
+
+	// Group quads by shader program and texture. Changing the drawing order is only
+	// safe if they don't overlap.
+	bool overlapping = false;
+	for (size_t i = 0; i < entries_.size() && !overlapping; ++i)
+	{
+		for (size_t j = i + 1; j < entries_.size(); ++j)
+		{
+			if (entries_[i].target.intersects(entries_[j].target))
+			{
+				overlapping = true;
+				break;
+			}
+		}
+	}
+	if (!overlapping)
+	{
+		std::stable_sort(entries_.begin(), entries_.end(), [](const Entry & a, const Entry & b) {
+			if (a.type != b.type)
+			{
+				return a.type < b.type;
+			}
+			if (a.swizzle_red_blue != b.swizzle_red_blue)
+			{
+				return b.swizzle_red_blue;
+			}
+			return a.texture < b.texture;
+		});
+	}
+
+	// Two triangles per quad so quads with the same texture can go in one draw call.
+	static const int c_quad_corners[6] = { 0, 1, 2, 0, 2, 3 };
+	const GLfloat sx = 2.0f / static_cast<GLfloat>(viewportSize.width());
+	const GLfloat sy = 2.0f / static_cast<GLfloat>(viewportSize.height());
+	vertices_.clear();
+	vertices_.reserve(entries_.size() * 6 * 4);
+	for (const Entry & entry: entries_)
+	{
+		const GLfloat left = entry.target.left() * sx - 1.0f;
+		const GLfloat right = entry.target.right() * sx - 1.0f;
+		const GLfloat top = 1.0f - entry.target.top() * sy;
+		const GLfloat bottom = 1.0f - entry.target.bottom() * sy;
+		const GLfloat positions[4][2] = { { left, top }, { right, top }, { right, bottom }, { left, bottom } };
+		for (int corner: c_quad_corners)
+		{
+			vertices_.push_back(positions[corner][0]);
+			vertices_.push_back(positions[corner][1]);
+			vertices_.push_back(entry.tex_coords[corner * 2]);
+			vertices_.push_back(entry.tex_coords[corner * 2 + 1]);
+		}
+	}
+
+	const GLsizeiptr bytes = static_cast<GLsizeiptr>(vertices_.size() * sizeof(GLfloat));
+	if (vertex_buffer_ == 0)
+	{
+		glGenBuffers(1, &vertex_buffer_);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+	if (bytes > vertex_buffer_size_)
+	{
+		glBufferData(GL_ARRAY_BUFFER, bytes, vertices_.data(), GL_STREAM_DRAW);
+		vertex_buffer_size_ = bytes;
+	}
+	else
+	{
+		// Orphan the previous storage, so we don't wait for the GPU to finish reading it.
+		glBufferData(GL_ARRAY_BUFFER, vertex_buffer_size_, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, vertices_.data());
+	}
+
+	glDisable(GL_STENCIL_TEST);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glActiveTexture(GL_TEXTURE0);
+
+	const GLsizei stride = 4 * sizeof(GLfloat);
+	glVertexAttribPointer(c_vertex_coordinates_attr, 2, GL_FLOAT, GL_FALSE, stride,
+		reinterpret_cast<const void *>(0));
+	glVertexAttribPointer(c_texture_coordinates_attr, 2, GL_FLOAT, GL_FALSE, stride,
+		reinterpret_cast<const void *>(2 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(c_vertex_coordinates_attr);
+	glEnableVertexAttribArray(c_texture_coordinates_attr);
+
+	int draw_calls = 0;
+	bool external_texture_bound = false;
+	QOpenGLShaderProgram * bound_program = nullptr;
+	for (size_t first = 0; first < entries_.size();)
+	{
+		const Entry & entry = entries_[first];
+		size_t last = first + 1;
+		while (last < entries_.size()
+			&& entries_[last].texture == entry.texture
+			&& entries_[last].type == entry.type
+			&& entries_[last].swizzle_red_blue == entry.swizzle_red_blue)
+		{
+			++last;
+		}
+
+		QOpenGLShaderProgram * program = QOpenGLTextureHolder::GetBlitProgram(entry.type, entry.swizzle_red_blue);
+		if (program != bound_program)
+		{
+			if (!program || !program->isLinked() || !program->bind())
+			{
+				qWarning()<<"Failed to bind shader program, can't blit texture type"<<entry.type;
+				first = last;
+				continue;
+			}
+			program->setUniformValue("imageTexture", 0 /*QT_IMAGE_TEXTURE_UNIT*/);
+			bound_program = program;
+		}
+
+		glBindTexture(entry.type, entry.texture);
+		external_texture_bound = external_texture_bound || entry.type == GL_TEXTURE_EXTERNAL_OES;
+		glDrawArrays(GL_TRIANGLES, static_cast<GLint>(first * 6), static_cast<GLsizei>((last - first) * 6));
+		++draw_calls;
+		first = last;
+	}
+
+	glDisableVertexAttribArray(c_vertex_coordinates_attr);
+	glDisableVertexAttribArray(c_texture_coordinates_attr);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	if (external_texture_bound)
+	{
+		glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+	}
+	if (bound_program)
+	{
+		bound_program->release();
+	}
+
+	entries_.clear();
+	return draw_calls;
+}
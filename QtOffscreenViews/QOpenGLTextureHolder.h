@@ -38,7 +38,7 @@
 #include <EGL/egl.h>
 #include <QtCore/QRect>
 #include <QtCore/QRectF>
-#include <QtCore/QSharedPointer>
+#include <vector>
 
 #include <QtOpenGL/QOpenGLShaderProgram>
 /*!
@@ -84,6 +84,23 @@ public:
 	 */
 	inline void setTransformation(GLfloat a11, GLfloat a12, GLfloat a21, GLfloat a22, GLfloat b1, GLfloat b2);
 
+	/*!
+	 * Set to true if the texture data has R and B swapped, so blitTexture() swaps them back
+	 * in the shader. Set automatically by allocateTexture(const QImage &, bool, GLenum).
+	 * Cleared by deallocateTexture().
+	 */
+	void setSwizzleRedBlue(bool swizzle) { swizzle_red_blue_ = swizzle; }
+	bool swizzleRedBlue() const { return swizzle_red_blue_; }
+
+	/*!
+	 * If true, allocateTexture(const QImage &, bool, GLenum) loads Qt's 32-bit images as is
+	 * and leaves swapping R and B to blitTexture() instead of converting them on the CPU.
+	 * The texture then holds BGRA data, so only enable it if the texture is not used
+	 * outside of this class. Default: false.
+	 */
+	void setSwizzledUploads(bool swizzled) { swizzled_uploads_ = swizzled; }
+	bool swizzledUploads() const { return swizzled_uploads_; }
+
 	/*!
 	 * Draw the texture in current GL context.
 	 * This function is intended to draw the texture on screen without resampling.
@@ -101,6 +118,10 @@ public:
 
 	/*!
 	 * Allocate texture and load data from QImage using custom parameters.
+	 * If a GL_TEXTURE_2D texture with the same size and format is already allocated,
+	 * it is reused and only reloaded with glTexSubImage2D(). Released textures are kept
+	 * in a small pool per GL share group (limited by count, bytes and age) and are reused
+	 * for images of the same size and format.
 	 * \param gl_prepared - set to false to convert data from any QImage format to one supported
 	 *  by GL, or set to true to load data directly from qimage as described by prepared_image_type
 	 *  and prepared_pixel_type.
@@ -111,8 +132,10 @@ public:
 	/*!
 	 * Allocate texture and load data from QImage. If QImage has Format_ARGB32,
 	 * Format_ARGB32_Premultiplied and real_32bit_format_is_qt_abgr is true, or it has Format_RGB16,
-	 * it is loaded into GL directly; for other cases, it is automatically converted to
-	 * format useable by GL (which is a quite slow operation).
+	 * it is loaded into GL directly. With setSwizzledUploads(true), Format_ARGB32,
+	 * Format_ARGB32_Premultiplied and Format_RGB32 are loaded directly in Qt's memory order and
+	 * R and B are swapped by the blit shader (see setSwizzleRedBlue()). For other cases, the image
+	 * is converted to format useable by GL (which is a quite slow operation).
 	 * \note Note: Android and GL's RGBA would be ABGR32 in Qt's notation. Qt doesn't support
 	 *  such format directly. That's why we need the real_32bit_format_is_qt_abgr flag.
 	 * \note We don't expect anything useful in the alpha channel here, so premultiplied
@@ -122,6 +145,14 @@ public:
 	 */
 	void allocateTexture(const QImage & qimage, bool real_32bit_format_is_qt_abgr = false, GLenum texture_type = GL_TEXTURE_2D);
 
+	/*!
+	 * Reload 'area' of the texture from qimage, which should have the same size and format
+	 * as the image the texture has been allocated from, and a format which allocateTexture()
+	 * would load directly. On GL ES 2 without GL_EXT_unpack_subimage whole rows are reloaded.
+	 * \return false if the texture can't be updated in place; allocateTexture() should be used then.
+	 */
+	bool updateTexture(const QImage & qimage, const QRect & area, bool real_32bit_format_is_qt_abgr = false);
+
 	/*!
 	 * Allocate texture and load data from a file.
 	 */
@@ -132,26 +163,141 @@ public:
 
 	/*!
 	 * This function may be called during initialization of GL to prevent shader compilation
-	 * during first blitTexture() call.
+	 * (or loading from the shader disk cache) during first blitTexture() call.
+	 * Should be called with a current GL context.
 	 */
 	static void initializeGL(bool init_extension);
 
+	/*!
+	 * Same as updateTexture(), but the pixels are copied into one of a ring of pixel buffer
+	 * objects and the texture is loaded from it asynchronously, so copying the next frame
+	 * overlaps with the GPU reading the previous one.
+	 * \return false if pixel buffer objects are not supported (GL ES 2) or the texture
+	 *  can't be updated in place; updateTexture() or allocateTexture() should be used then.
+	 */
+	bool streamTexture(const QImage & qimage, const QRect & area, bool real_32bit_format_is_qt_abgr = false);
+
+	//! Check if streamTexture() can be used with the current GL context.
+	static bool pixelBuffersSupported();
+
+	//! Delete pixel buffer objects used by streamTexture(). Called from destructor.
+	void releasePixelBuffers();
+
+	//! Delete textures pooled for the current GL context group (e.g. on low memory).
+	static void trimTexturePool();
+
+	//! Delete pooled textures of the current GL context group which have not been reused
+	//! for a while, or all of them if a trim has been requested. Cheap; call once per frame.
+	static void collectTexturePool();
+
+	/*!
+	 * Thread-safe request to delete pooled textures of all GL context groups (e.g. when
+	 * going to background or on low memory). As textures can be deleted only with their
+	 * context current, this happens in the next pool operation or collectTexturePool()
+	 * in each group.
+	 */
+	static void requestTexturePoolTrim();
+
+	//! Thread-safe. While disabled (e.g. in background), released textures are deleted
+	//! instead of being pooled. Default: enabled.
+	static void setTexturePoolEnabled(bool enabled);
+
 private:
 	//! Helper for blitTexture().
 	void drawTexture(const QRectF & rect, const QRectF & bitmap_rect, bool reverse_y);
 
-	//! Shader programs for drawTexture().
-	static QOpenGLShaderProgram * GetBlitProgram(GLenum target);
+	//! Check if the texture storage matches qimage and get GL format to load it directly.
+	bool canUpdateInPlace(const QImage & qimage, bool real_32bit_format_is_qt_abgr,
+		GLenum * out_type, GLenum * out_pixel_type, int * out_bytes_per_pixel) const;
+
+	/*!
+	 * Shader programs for drawTexture(). They are cached per GL share group of the current
+	 * context until the group is destroyed, and compiled binaries are kept in Qt's shader
+	 * disk cache, so normally the shaders are compiled only on the first start of the app.
+	 * \return nullptr if there is no current GL context.
+	 */
+	static QOpenGLShaderProgram * GetBlitProgram(GLenum target, bool swizzle_red_blue = false);
 
 protected:
 	GLuint texture_id_;
 	GLenum texture_type_;
 	QSize texture_size_;
+	// Size and format of the storage loaded by allocateTexture(const QImage &...), if any.
+	QSize storage_size_;
+	GLenum storage_format_;
+	GLenum storage_pixel_type_;
+	// Ring of pixel buffer objects for streamTexture().
+	static const int c_pixel_buffer_count = 3;
+	GLuint pixel_buffers_[c_pixel_buffer_count];
+	int next_pixel_buffer_;
+	// The texture holds BGRA data and R and B are swapped when it is drawn.
+	bool swizzle_red_blue_;
+	// Load Qt's 32-bit images without conversion, see setSwizzledUploads().
+	bool swizzled_uploads_;
 	// Texture transformation: (v) = (A)*(b).
 	GLfloat a11_, a12_, a21_, a22_, b1_, b2_;
-	static QMap<GLenum, QSharedPointer<QOpenGLShaderProgram> > blit_programs_;
 private:
 	Q_DISABLE_COPY(QOpenGLTextureHolder)
+	friend class QOpenGLTextureBatch;
+};
+
+/*!
+ * Draws many textures (e.g. of a dozen offscreen views on a form) in one go instead of
+ * calling QOpenGLTextureHolder::blitTexture() for each of them. All quads are uploaded
+ * into one vertex buffer object which is kept between frames; quads are grouped by shader
+ * program (texture type and R/B swizzling) unless their target rectangles overlap, and
+ * consecutive quads with the same texture are drawn by a single glDrawArrays().
+ * Should be used with the same GL context all the time; call releaseGL() in that context
+ * before the object is destroyed.
+ */
+class QOpenGLTextureBatch
+{
+public:
+	QOpenGLTextureBatch();
+	~QOpenGLTextureBatch();
+
+	/*!
+	 * Add a texture to draw, with its current transformation and R/B swizzling.
+	 * The texture must stay allocated until draw().
+	 * \param targetRect - output rectangle in viewport pixels, Y axis going down;
+	 *  may be positioned at fractional coordinates.
+	 * \param sourceRect - rectangle in the texture, in pixels of getTextureSize().
+	 *  Whole texture is drawn if it is empty.
+	 */
+	void add(const QOpenGLTextureHolder & texture, const QRectF & targetRect,
+		const QRect & sourceRect = QRect(), bool reverse_y = false);
+
+	int count() const { return static_cast<int>(entries_.size()); }
+	bool isEmpty() const { return entries_.empty(); }
+	void clear() { entries_.clear(); }
+
+	/*!
+	 * Draw all added textures into the current viewport of the given size and clear the batch.
+	 * \return number of draw calls issued.
+	 */
+	int draw(const QSize & viewportSize);
+
+	//! Delete the vertex buffer. Called from destructor.
+	void releaseGL();
+
+private:
+	struct Entry
+	{
+		GLuint texture;
+		GLenum type;
+		bool swizzle_red_blue;
+		QRectF target;
+		//! Texture coordinates for top-left, top-right, bottom-right, bottom-left corners.
+		GLfloat tex_coords[4 * 2];
+	};
+
+	std::vector<Entry> entries_;
+	//! Interleaved x, y, s, t for every vertex.
+	std::vector<GLfloat> vertices_;
+	GLuint vertex_buffer_;
+	GLsizeiptr vertex_buffer_size_;
+private:
+	Q_DISABLE_COPY(QOpenGLTextureBatch)
 };
 
 void QOpenGLTextureHolder::setTransformation(GLfloat a11, GLfloat a12, GLfloat a21, GLfloat a22, GLfloat b1, GLfloat b2)
@@ -34,11 +34,17 @@
   THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
 #include <QtCore/QTimer>
+#include <QtCore/QMutexLocker>
+#include <QtGui/QMatrix4x4>
 #include <QtOpenGL/QOpenGLFramebufferObject>
 #include <QtQuick/QSGTexture>
 #include <QtQuick/QSGTransformNode>
 #include <QtQuick/QSGSimpleTextureNode>
+#include <QtQuick/QSGSimpleRectNode>
+#include <QtQuick/QSGRenderNode>
 #include <QtQuick/QQuickWindow>
 #include "QQuickAndroidOffscreenView.h"
 
@@ -52,6 +58,97 @@ public:
 	QScopedPointer<QOpenGLFramebufferObject> fbo_;
 };
 
+//! Shows the view's GL_TEXTURE_2D texture (Bitmap mode) as is.
+class WrappedTextureNode
+	: public QSGSimpleTextureNode
+{
+public:
+	WrappedTextureNode() {}
+	GLuint texture_id_ = 0;
+	QSize texture_size_;
+};
+
+/*!
+ * Draws the view's GL_TEXTURE_EXTERNAL_OES texture right into the scene graph's render target.
+ * Samplers of external textures can't be used in Qt Quick materials, so the node draws it with
+ * the blit program of QOpenGLTextureHolder, which also applies SurfaceTexture's transformation.
+ */
+class ExternalTextureNode
+	: public QSGRenderNode
+{
+public:
+	explicit ExternalTextureNode(const QSharedPointer<QQuickAndroidOffscreenView::RenderLink> & link)
+		: link_(link)
+	{
+	}
+
+	void setSize(const QSizeF & size) { size_ = size; }
+
+	StateFlags changedStates() const override
+	{
+		return ViewportState | ScissorState | StencilState | DepthState | BlendState | ColorState;
+	}
+
+	RenderingFlags flags() const override
+	{
+		return BoundedRectRendering;
+	}
+
+	QRectF rect() const override
+	{
+		return QRectF(QPointF(0, 0), size_);
+	}
+
+	void render(const RenderState * state) override
+	{
+		QMutexLocker locker(&link_->mutex);
+		if (!link_->view || size_.isEmpty())
+		{
+			return;
+		}
+
+		// Find the item's rectangle in the render target. The item is known to be axis-aligned.
+		const QMatrix4x4 m = *state->projectionMatrix() * *matrix();
+		const QPointF top_left = m.map(QPointF(0, 0));
+		const QPointF bottom_right = m.map(QPointF(size_.width(), size_.height()));
+		GLint viewport[4] = { 0, 0, 0, 0 };
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		const auto to_x = [&](qreal x) { return qRound(viewport[0] + (x + 1.0) * 0.5 * viewport[2]); };
+		const auto to_y = [&](qreal y) { return qRound(viewport[1] + (y + 1.0) * 0.5 * viewport[3]); };
+		const int l = qMin(to_x(top_left.x()), to_x(bottom_right.x()));
+		const int r = qMax(to_x(top_left.x()), to_x(bottom_right.x()));
+		const int b = qMin(to_y(top_left.y()), to_y(bottom_right.y()));
+		const int t = qMax(to_y(top_left.y()), to_y(bottom_right.y()));
+		if (r <= l || t <= b)
+		{
+			return;
+		}
+		// If the item's top is lower than its bottom in GL coordinates, the target is Y-flipped.
+		const bool reverse_y = top_left.y() < bottom_right.y();
+
+		if (state->scissorEnabled())
+		{
+			const QRect & clip = state->scissorRect();
+			glEnable(GL_SCISSOR_TEST);
+			glScissor(clip.x(), clip.y(), clip.width(), clip.height());
+		}
+		else
+		{
+			glDisable(GL_SCISSOR_TEST);
+		}
+		// The blit uses client-side vertex arrays.
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		glActiveTexture(GL_TEXTURE0);
+		link_->view->paintGL(l, b, r - l, t - b, reverse_y);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	}
+
+private:
+	QSharedPointer<QQuickAndroidOffscreenView::RenderLink> link_;
+	QSizeF size_;
+};
+
 static void ClearOpenGLState()
 {
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -93,23 +190,54 @@ static void ClearOpenGLState()
 
 QQuickAndroidOffscreenView::QQuickAndroidOffscreenView(QAndroidOffscreenView * aview)
 	: aview_(aview)
+	, render_link_(new RenderLink())
+	, direct_rendering_(true)
 	, is_interactive_(true) // TODO
 	, mouse_tracking_(false)
 	, redraw_texture_needed_(true)
+	, full_redraw_needed_(true)
 	, initialized_(false)
+	, view_created_handled_(false)
 	, last_set_position_(0, 0) // View always at (0, 0) by default.
 	, auto_position_tracking_(false)
 {
 	setFlag(QQuickItem::ItemHasContents, true);
 	setAcceptedMouseButtons(Qt::LeftButton);
+	connect(aview_.data(), SIGNAL(damaged(QRect)), this, SLOT(onTextureDamaged(QRect)));
 	connect(aview_.data(), SIGNAL(updated()), this, SLOT(onTextureUpdated()));
 	connect(this, SIGNAL(xChanged()), this, SLOT(updateAndroidViewPosition()));
 	connect(this, SIGNAL(yChanged()), this, SLOT(updateAndroidViewPosition()));
 	connect(this, SIGNAL(enabledChanged()), this, SLOT(updateAndroidEnabled()));
 	connect(this, SIGNAL(visibleChanged()), this, SLOT(updateAndroidViewVisibility()));
 	connect(aview_.data(), SIGNAL(visibleRectReceived(int,int)), this, SLOT(onVisibleRectReceived(int,int)));
-	connect(aview_.data(), SIGNAL(viewCreated()), this, SLOT(onViewCreated()));
+	connect(aview_.data(), SIGNAL(viewCreated()), this, SLOT(handleViewCreated()));
+	if (aview_->isCreated())
+	{
+		// A view from QAndroidOffscreenViewPool has emitted viewCreated() before we have connected.
+		// It may also be created right between connect() and the check, hence the guard.
+		QMetaObject::invokeMethod(this, "handleViewCreated", Qt::QueuedConnection);
+	}
 	aview_->setAttachingMode(is_interactive_);
+	render_link_->view = aview_.data();
+}
+
+QQuickAndroidOffscreenView::~QQuickAndroidOffscreenView()
+{
+	// Render thread may be drawing with the view right now.
+	QMutexLocker locker(&render_link_->mutex);
+	render_link_->view = nullptr;
+}
+
+void QQuickAndroidOffscreenView::setDirectRendering(bool direct)
+{
+	if (direct != direct_rendering_)
+	{
+		direct_rendering_ = direct;
+		emit directRenderingChanged(direct);
+		redraw_texture_needed_ = true;
+		full_redraw_needed_ = true;
+		update();
+	}
 }
 
 void QQuickAndroidOffscreenView::setBackgroundColor(const QColor & color)
@@ -119,6 +247,7 @@ void QQuickAndroidOffscreenView::setBackgroundColor(const QColor & color)
 		androidView()->setFillColor(color);
 		emit backgroundColorChanged(color);
 		redraw_texture_needed_ = true;
+		full_redraw_needed_ = true;
 		update();
 	}
 }
@@ -129,6 +258,11 @@ void QQuickAndroidOffscreenView::onTextureUpdated()
 	QMetaObject::invokeMethod(this, "update", Qt::AutoConnection);
 }
 
+void QQuickAndroidOffscreenView::onTextureDamaged(const QRect & area)
+{
+	pending_damage_ |= area;
+}
+
 void QQuickAndroidOffscreenView::onVisibleRectReceived(int width, int height)
 {
 	emit visibleRectReceived(width, height);
@@ -249,23 +383,139 @@ QSGNode * QQuickAndroidOffscreenView::updatePaintNode(QSGNode * node, UpdatePain
 		}
 	}
 
-	// ********************************************************************************************
-	// Note: in theory, we could feed our texture right into the node, but unfortunately the Qt
-	// classes don't have the functionality to use a read-only texture id.
-	// So this would require writing our own implementation of textured SG node with black jack
-	// and kittens from scratch.
-	// As I don't have time for that right now, let's just live with drawing our texture over Qt
-	// texture. It doesn't cost that much performance.
-	// ********************************************************************************************
+	enum class NodeKind { Fbo, Texture, ExternalTexture, Fill };
+	NodeKind kind = NodeKind::Fbo;
+	if (direct_rendering_ && aview_)
+	{
+		const QOpenGLTextureHolder & tex = aview_->getGLTextureHolder();
+		if (aview_->requiresPaintGL()
+			|| (tex.isAllocated() && tex.getTextureType() == GL_TEXTURE_EXTERNAL_OES))
+		{
+			// Drawn with paintGL() by the render node, which can't blend or rotate the image.
+			kind = (isAxisAligned() && qFuzzyCompare(opacity(), 1.0))? NodeKind::ExternalTexture: NodeKind::Fbo;
+		}
+		else if (aview_->updateGLTextureInHolder() && tex.getTextureType() == GL_TEXTURE_2D)
+		{
+			kind = NodeKind::Texture;
+		}
+		else
+		{
+			kind = NodeKind::Fill;
+		}
+	}
 
+	// Replace the node if it is of a wrong kind.
+	if (node)
+	{
+		const bool node_matches =
+			(kind == NodeKind::Fbo && dynamic_cast<TexureHolderNode *>(node)) ||
+			(kind == NodeKind::Texture && dynamic_cast<WrappedTextureNode *>(node)) ||
+			(kind == NodeKind::ExternalTexture && dynamic_cast<ExternalTextureNode *>(node)) ||
+			(kind == NodeKind::Fill && dynamic_cast<QSGSimpleRectNode *>(node));
+		if (!node_matches)
+		{
+			delete node;
+			node = nullptr;
+		}
+	}
+	if (!node && (width() <= 0 || height() <= 0))
+	{
+		return nullptr;
+	}
+
+	switch (kind)
+	{
+	case NodeKind::Texture:
+		return updateTextureNode(node);
+	case NodeKind::ExternalTexture:
+		return updateExternalTextureNode(node);
+	case NodeKind::Fill:
+		return updateFillNode(node);
+	case NodeKind::Fbo:
+	default:
+		return updateFboNode(node);
+	}
+}
+
+QSGNode * QQuickAndroidOffscreenView::updateTextureNode(QSGNode * node)
+{
+	WrappedTextureNode * n = static_cast<WrappedTextureNode *>(node);
+	if (!n)
+	{
+		n = new WrappedTextureNode();
+		n->setOwnsTexture(true); // The QSGTexture wrapper, not the GL texture
+		n->setFiltering(QSGTexture::Nearest);
+	}
+
+	// The view may reallocate its texture, e.g. on resize.
+	const QOpenGLTextureHolder & tex = aview_->getGLTextureHolder();
+	if (n->texture_id_ != tex.getTexture() || n->texture_size_ != tex.getTextureSize() || !n->texture())
+	{
+		n->texture_id_ = tex.getTexture();
+		n->texture_size_ = tex.getTextureSize();
+		n->setTexture(
+			QNativeInterface::QSGOpenGLTexture::fromNative(
+				n->texture_id_,
+				window(),
+				n->texture_size_,
+				QQuickWindow::TextureHasAlphaChannel));
+	}
+	// Bitmaps may be larger than the view which is painted into their top-left part
+	// (at renderSize(), which is smaller than the item with a render scale).
+	n->setSourceRect(QRectF(QPointF(0, 0), aview_->renderSize().boundedTo(n->texture_size_)));
+	n->setRect(0, 0, width(), height());
+	if (redraw_texture_needed_)
+	{
+		redraw_texture_needed_ = false;
+		full_redraw_needed_ = true;
+		pending_damage_ = QRect();
+		n->markDirty(QSGNode::DirtyMaterial);
+	}
+	return n;
+}
+
+QSGNode * QQuickAndroidOffscreenView::updateExternalTextureNode(QSGNode * node)
+{
+	ExternalTextureNode * n = static_cast<ExternalTextureNode *>(node);
+	if (!n)
+	{
+		n = new ExternalTextureNode(render_link_);
+	}
+	n->setSize(QSizeF(width(), height()));
+	// The texture is updated and drawn in the render node itself.
+	redraw_texture_needed_ = false;
+	full_redraw_needed_ = true;
+	pending_damage_ = QRect();
+	n->markDirty(QSGNode::DirtyMaterial);
+	return n;
+}
+
+QSGNode * QQuickAndroidOffscreenView::updateFillNode(QSGNode * node)
+{
+	QSGSimpleRectNode * n = static_cast<QSGSimpleRectNode *>(node);
+	if (!n)
+	{
+		n = new QSGSimpleRectNode();
+	}
+	n->setRect(0, 0, width(), height());
+	n->setColor(getBackgroundColor());
+	return n;
+}
+
+bool QQuickAndroidOffscreenView::isAxisAligned() const
+{
+	const QPointF origin = mapToScene(QPointF(0, 0));
+	const QPointF right = mapToScene(QPointF(width(), 0));
+	const QPointF bottom = mapToScene(QPointF(0, height()));
+	return qFuzzyCompare(origin.y() + 1.0, right.y() + 1.0) && qFuzzyCompare(origin.x() + 1.0, bottom.x() + 1.0);
+}
+
+QSGNode * QQuickAndroidOffscreenView::updateFboNode(QSGNode * node)
+{
 	// Create our painting node
 	TexureHolderNode * n = static_cast<TexureHolderNode *>(node);
 	if (!n) // Мы ещё не создавали узел
 	{
-		if (width() <= 0 || height() <= 0)
-		{
-			return nullptr;
-		}
 		n = new TexureHolderNode();
 	}
 
@@ -293,17 +543,36 @@ QSGNode * QQuickAndroidOffscreenView::updatePaintNode(QSGNode * node, UpdatePain
 		n->setFiltering(QSGTexture::Nearest);
 		n->setRect(0, 0, width(), height());
 		redraw_texture_needed_ = true;
+		full_redraw_needed_ = true;
 	}
 
 	if (redraw_texture_needed_)
 	{
+		// The FBO keeps the previous image, so only the changed area of the view is repainted
+		// when the view maps to the FBO 1:1. One pixel margin is added for texture filtering.
+		const QRect fbo_rect(QPoint(0, 0), n->fbo_->size());
+		const QRect area = (full_redraw_needed_ || !aview_ || aview_->size() != n->fbo_->size())
+			? fbo_rect
+			: pending_damage_.adjusted(-1, -1, 1, 1) & fbo_rect;
 		redraw_texture_needed_ = false;
+		full_redraw_needed_ = false;
+		pending_damage_ = QRect();
+		if (area.isEmpty())
+		{
+			return n;
+		}
 
 		window()->beginExternalCommands();
 		n->fbo_->bind();
 		{
 			glViewport(0, 0, n->fbo_->width(), n->fbo_->height());
 			ClearOpenGLState();
+			if (area != fbo_rect)
+			{
+				// The view is painted with reversed Y, so its rows match FBO rows.
+				glEnable(GL_SCISSOR_TEST);
+				glScissor(area.x(), area.y(), area.width(), area.height());
+			}
 
 			QColor c = getBackgroundColor();
 			glClearColor(c.redF(), c.greenF(), c.blueF(), c.alphaF());
@@ -313,6 +582,7 @@ QSGNode * QQuickAndroidOffscreenView::updatePaintNode(QSGNode * node, UpdatePain
 			{
 				aview_->paintGL(0, 0, static_cast<int>(width()), static_cast<int>(height()), true);
 			}
+			glDisable(GL_SCISSOR_TEST);
 		}
 		n->fbo_->bindDefault();
 		window()->endExternalCommands();
@@ -379,6 +649,15 @@ void QQuickAndroidOffscreenView::updateAndroidEnabled()
 	aview_->setEnabled(isEnabled());
 }
 
+void QQuickAndroidOffscreenView::handleViewCreated()
+{
+	if (!view_created_handled_)
+	{
+		view_created_handled_ = true;
+		onViewCreated();
+	}
+}
+
 void QQuickAndroidOffscreenView::onViewCreated()
 {
 	qDebug() << __PRETTY_FUNCTION__;
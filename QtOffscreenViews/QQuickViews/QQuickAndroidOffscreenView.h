@@ -37,6 +37,7 @@
 #pragma once
 #include <QtCore/QSharedPointer>
 #include <QtCore/QMetaObject>
+#include <QtCore/QMutex>
 #include <QtGui/QFocusEvent>
 #include <QtQuick/QQuickItem>
 #include <QtOffscreenViews/QAndroidOffscreenView.h>
@@ -48,13 +49,32 @@ class QQuickAndroidOffscreenView : public QQuickItem
 {
 	Q_OBJECT
 	Q_PROPERTY(QColor backgroundColor READ getBackgroundColor WRITE setBackgroundColor NOTIFY backgroundColorChanged)
+	Q_PROPERTY(bool directRendering READ directRendering WRITE setDirectRendering NOTIFY directRenderingChanged)
 
 public:
 	QQuickAndroidOffscreenView(QAndroidOffscreenView * aview);
+	~QQuickAndroidOffscreenView() override;
 
 	QColor getBackgroundColor() const { return androidView()->fillColor(); }
 	void setBackgroundColor(const QColor & color);
 
+	/*!
+	 * When enabled (default), the scene graph draws the view's texture directly: a bitmap
+	 * mode texture is wrapped into QSGTexture and a SurfaceTexture (external OES) is drawn by
+	 * a render node, without copying the view into an intermediate FBO each frame.
+	 * The FBO is still used for external textures of rotated or semi-transparent items,
+	 * or when the mode is disabled.
+	 */
+	bool directRendering() const { return direct_rendering_; }
+	void setDirectRendering(bool direct);
+
+	//! Connects the item with scene graph nodes which use the view in the render thread.
+	struct RenderLink
+	{
+		QMutex mutex;
+		QAndroidOffscreenView * view = nullptr;
+	};
+
 public slots:
 	/*!
 	 * This function must be called from QML after screen position has been changed
@@ -100,6 +120,7 @@ public slots:
 signals:
 	void viewCreated();
 	void backgroundColorChanged(QColor color);
+	void directRenderingChanged(bool direct);
 	void visibleRectReceived(int visible_width, int visible_height);
 
 protected:
@@ -120,17 +141,33 @@ protected slots:
 	virtual void updateAndroidViewVisibility();
 	virtual void updateAndroidEnabled();
 	virtual void onTextureUpdated();
+	virtual void onTextureDamaged(const QRect & area);
 	virtual void onVisibleRectReceived(int width, int height);
 	virtual void onViewCreated();
 
+private slots:
+	//! Calls onViewCreated() once, however many times the notification arrives.
+	void handleViewCreated();
+
 private:
 	void beginAutoPositionTracking();
 	void endAutoPositionTracking();
+	QSGNode * updateFboNode(QSGNode * node);
+	QSGNode * updateTextureNode(QSGNode * node);
+	QSGNode * updateExternalTextureNode(QSGNode * node);
+	QSGNode * updateFillNode(QSGNode * node);
+	bool isAxisAligned() const;
 	QSharedPointer<QAndroidOffscreenView> aview_;
+	QSharedPointer<RenderLink> render_link_;
+	bool direct_rendering_;
 	bool is_interactive_;
 	bool mouse_tracking_;
 	bool redraw_texture_needed_;
+	bool full_redraw_needed_;
+	//! Area of the view changed since the last redraw of the FBO.
+	QRect pending_damage_;
 	bool initialized_;
+	bool view_created_handled_;
 
 	QPoint last_set_position_;
 	bool auto_position_tracking_;
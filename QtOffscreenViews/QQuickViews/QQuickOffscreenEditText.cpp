@@ -35,9 +35,10 @@
 */
 
 #include "QQuickOffscreenEditText.h"
+#include <QtOffscreenViews/QAndroidOffscreenViewPool.h>
 
 QQuickAndroidOffscreenEditText::QQuickAndroidOffscreenEditText()
-	: QQuickAndroidOffscreenView(new QAndroidOffscreenEditText("EditTextInQuick", QSize(512, 64)))
+	: QQuickAndroidOffscreenView(QAndroidOffscreenViewPool::instance().take<QAndroidOffscreenEditText>("EditTextInQuick", QSize(512, 64)))
 {
 	connect(androidEditText(), SIGNAL(onTextChanged(QString,int,int,int)), this, SLOT(etTextChanged(QString,int,int,int)));
 	connect(androidEditText(), SIGNAL(selectionChanged()), this, SIGNAL(selectionChanged()));
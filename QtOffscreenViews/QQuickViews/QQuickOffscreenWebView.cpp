@@ -35,9 +35,10 @@
 */
 
 #include "QQuickOffscreenWebView.h"
+#include <QtOffscreenViews/QAndroidOffscreenViewPool.h>
 
 QQuickAndroidOffscreenWebView::QQuickAndroidOffscreenWebView()
-	: QQuickAndroidOffscreenView(new QAndroidOffscreenWebView("WebViewInQuick", QSize(512, 512)))
+	: QQuickAndroidOffscreenView(QAndroidOffscreenViewPool::instance().take<QAndroidOffscreenWebView>("WebViewInQuick", QSize(512, 512)))
 {
 	connect(androidWebView(), SIGNAL(pageStarted(const QString &)), this, SLOT(wwPageStarted(const QString &)));
 	connect(androidWebView(), SIGNAL(pageFinished(const QString &)), this, SLOT(wwPageFinished(const QString &)));
@@ -1,9 +1,15 @@
 HEADERS += \
     QOpenGLTextureHolder.h \
     QAndroidOffscreenView.h \
+    QAndroidOffscreenViewBatch.h \
+    QAndroidOffscreenViewPool.h \
     QAndroidOffscreenWebView.h \
     QAndroidOffscreenEditText.h \
     QAndroidJniImagePair.h \
+    QAndroidJniBitmapPool.h \
+    QAndroidPixelSwizzle.h \
+    QAndroidTextPieceTable.h \
+    QAndroidTiledPixelConverter.h \
     QApplicationActivityObserver.h \
     QGraphicsWidgets/QAndroidOffscreenViewGraphicsWidget.h \
     QGraphicsWidgets/QOffscreenEditTextGraphicsWidget.h \
@@ -12,9 +18,15 @@ HEADERS += \
 SOURCES += \
     QOpenGLTextureHolder.cpp \
     QAndroidOffscreenView.cpp \
+    QAndroidOffscreenViewBatch.cpp \
+    QAndroidOffscreenViewPool.cpp \
     QAndroidOffscreenWebView.cpp \
     QAndroidOffscreenEditText.cpp \
     QAndroidJniImagePair.cpp \
+    QAndroidJniBitmapPool.cpp \
+    QAndroidPixelSwizzle.cpp \
+    QAndroidTextPieceTable.cpp \
+    QAndroidTiledPixelConverter.cpp \
     QApplicationActivityObserver.cpp \
     QGraphicsWidgets/QAndroidOffscreenViewGraphicsWidget.cpp \
     QGraphicsWidgets/QOffscreenEditTextGraphicsWidget.cpp \
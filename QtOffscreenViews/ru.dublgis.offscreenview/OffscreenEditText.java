@@ -37,6 +37,7 @@
 package ru.dublgis.offscreenview;
 
 import java.lang.reflect.Field;
+import java.nio.ByteBuffer;
 import android.app.Activity;
 import android.content.Context;
 import android.graphics.Rect;
@@ -72,7 +73,8 @@ import ru.dublgis.offscreenview.inputmask.InputMaskFormatter;
 
 class OffscreenEditText extends OffscreenView
 {
-    protected String text_ = "";
+    // Send only the changed part of the text to C++, see setDeltaTextChanges().
+    private volatile boolean delta_text_changes_ = false;
     boolean single_line_ = false;
     boolean need_to_reflow_text_ = false, need_to_reflow_hint_ = false;
     int selection_top_ = 0, selection_bottom_ = 0;
@@ -156,25 +158,32 @@ class OffscreenEditText extends OffscreenView
             public void onTextChanged(CharSequence s, int start, int before, int count)
             {
                 try {
-                    final String text = s.toString();
-
-                    if (formatter_ != null && !text.equals(formattedText_)) {
-                        formattedText_ = formatter_.format(text);
-
-                        setText(formattedText_);
-                        setSelection(formattedText_.length());
-                        setHasAcceptableInput(formatter_.hasAcceptableInput());
-                        return;
+                    if (formatter_ != null) {
+                        final String text = s.toString();
+                        if (!text.equals(formattedText_)) {
+                            formattedText_ = formatter_.format(text);
+
+                            setText(formattedText_);
+                            setSelection(formattedText_.length());
+                            setHasAcceptableInput(formatter_.hasAcceptableInput());
+                            return;
+                        }
                     }
 
                     need_to_reflow_text_ = false;
                     need_to_reflow_hint_ = false;
 
-                    synchronized(text_) {
-                        text_ = text;
-                    }
                     synchronized(nativePtrMutex()) {
-                        nativeOnTextChanged(getNativePtr(), text, start, before, count);
+                        final long ptr = getNativePtr();
+                        // The formatter replaces the text from inside of this callback, so it always
+                        // sends the whole text. C++ also asks for it when the delta does not apply.
+                        if (!delta_text_changes_
+                            || formatter_ != null
+                            || ptr == 0
+                            || !nativeOnTextDelta(ptr, s.subSequence(start, start + count).toString(), start, before, count, s.length()))
+                        {
+                            nativeOnTextChanged(ptr, s.toString(), start, before, count);
+                        }
                     }
 
                     updateContentHeight();
@@ -393,7 +402,7 @@ class OffscreenEditText extends OffscreenView
         {
             try {
                 super.invalidate(dirty);
-                invalidateOffscreenView();
+                invalidateOffscreenView(dirty);
             } catch (final Throwable e) {
                 Log.e(TAG, "Exception in invalidate:", e);
             }
@@ -411,7 +420,7 @@ class OffscreenEditText extends OffscreenView
                 {
                     return;
                 }
-                invalidateOffscreenView();
+                invalidateOffscreenView(new Rect(l, t, r, b));
             } catch (final Throwable e) {
                 Log.e(TAG, "Exception in invalidate:", e);
             }
@@ -729,6 +738,7 @@ class OffscreenEditText extends OffscreenView
 
 
     public native void nativeOnTextChanged(long nativePtr, String s, int start, int before, int count);
+    public native boolean nativeOnTextDelta(long nativePtr, String inserted, int start, int before, int count, int length);
     public native boolean nativeOnKey(long nativePtr, boolean down, int keyCode);
     public native void nativeOnEditorAction(long nativePtr, int action);
     public native void nativeSetSelectionInfo(long nativePtr, int top, int bottom);
@@ -742,10 +752,6 @@ class OffscreenEditText extends OffscreenView
 
     public void setText(final String text)
     {
-        synchronized(text_)
-        {
-            text_ = text;
-        }
         runViewAction(new Runnable(){
             @Override
             public void run(){
@@ -767,12 +773,132 @@ class OffscreenEditText extends OffscreenView
         });
     }
 
-    String getText()
+    public void setDeltaTextChanges(final boolean enable)
+    {
+        delta_text_changes_ = enable;
+    }
+
+    // Opcodes of batched commands, must match QAndroidOffscreenEditTextBatch::EditTextOpcode.
+    protected static final int BATCH_OP_SET_TEXT = BATCH_OP_USER + 0;
+    protected static final int BATCH_OP_SET_TEXT_SIZE = BATCH_OP_USER + 1;
+    protected static final int BATCH_OP_SET_TEXT_COLOR = BATCH_OP_USER + 2;
+    protected static final int BATCH_OP_SET_TEXT_SCALE_X = BATCH_OP_USER + 3;
+    protected static final int BATCH_OP_SET_HINT = BATCH_OP_USER + 4;
+    protected static final int BATCH_OP_SET_HINT_TEXT_COLOR = BATCH_OP_USER + 5;
+    protected static final int BATCH_OP_SET_HIGHLIGHT_COLOR = BATCH_OP_USER + 6;
+    protected static final int BATCH_OP_SET_GRAVITY = BATCH_OP_USER + 7;
+    protected static final int BATCH_OP_SET_PADDING = BATCH_OP_USER + 8;
+
+    @Override
+    protected Runnable decodeBatchCommand(final int opcode, final ByteBuffer buffer)
     {
-        synchronized(text_)
+        switch (opcode)
         {
-            return text_;
+            case BATCH_OP_SET_TEXT:
+            {
+                final String text = readBatchString(buffer);
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setText(text);
+                    }
+                };
+            }
+            case BATCH_OP_SET_TEXT_SIZE:
+            {
+                final float size = buffer.getFloat();
+                final int unit = buffer.getInt();
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setTextSize(size, unit);
+                    }
+                };
+            }
+            case BATCH_OP_SET_TEXT_COLOR:
+            {
+                final int color = buffer.getInt();
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setTextColor(color);
+                    }
+                };
+            }
+            case BATCH_OP_SET_TEXT_SCALE_X:
+            {
+                final float size = buffer.getFloat();
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setTextScaleX(size);
+                    }
+                };
+            }
+            case BATCH_OP_SET_HINT:
+            {
+                final String hint = readBatchString(buffer);
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setHint(hint);
+                    }
+                };
+            }
+            case BATCH_OP_SET_HINT_TEXT_COLOR:
+            {
+                final int color = buffer.getInt();
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setHintTextColor(color);
+                    }
+                };
+            }
+            case BATCH_OP_SET_HIGHLIGHT_COLOR:
+            {
+                final int color = buffer.getInt();
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setHighlightColor(color);
+                    }
+                };
+            }
+            case BATCH_OP_SET_GRAVITY:
+            {
+                final int gravity = buffer.getInt();
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setGravity(gravity);
+                    }
+                };
+            }
+            case BATCH_OP_SET_PADDING:
+            {
+                final int left = buffer.getInt();
+                final int top = buffer.getInt();
+                final int right = buffer.getInt();
+                final int bottom = buffer.getInt();
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setPadding(left, top, right, bottom);
+                    }
+                };
+            }
         }
+        return super.decodeBatchCommand(opcode, buffer);
     }
 
     void setTextSize(final float size, final int unit)
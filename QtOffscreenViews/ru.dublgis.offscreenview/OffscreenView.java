@@ -37,17 +37,23 @@
 package ru.dublgis.offscreenview;
 
 import java.lang.Thread;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.ArrayList;
 import java.util.Iterator;
 import android.app.Activity;
+import android.content.ComponentCallbacks2;
 import android.content.Context;
+import android.content.res.Configuration;
 import android.graphics.Bitmap;
 import android.graphics.Rect;
 import android.graphics.SurfaceTexture;
 import android.os.Build;
 import android.os.Handler;
 import android.os.IBinder;
+import android.os.Looper;
 import android.os.SystemClock;
+import android.view.Choreographer;
 import android.view.InputDevice;
 import android.view.View;
 import android.view.ViewGroup;
@@ -85,8 +91,15 @@ public abstract class OffscreenView
     private int measured_height_ = -1;
     private int scroll_x_ = 0;
     private int scroll_y_ = 0;
+    // Values last sent to C++ by publishViewState(), initially the same as on C++ side.
+    private int published_scroll_x_ = 0;
+    private int published_scroll_y_ = 0;
+    private int published_measured_width_ = -1;
+    private int published_measured_height_ = -1;
     private int view_width_ = 512;
     private int view_height_ = 512;
+    // The view is drawn into a surface of its size multiplied by this.
+    private float render_scale_ = 1.0f;
 
     final private Object view_existence_mutex_ = new Object();
     private View view_ = null;
@@ -99,6 +112,21 @@ public abstract class OffscreenView
     private int last_texture_width_ = 0;
     private int last_texture_height_ = 0;
 
+    // Area of the view which has to be repainted, in view content coordinates (scroll included).
+    // An empty rectangle or pending_damage_full_ means that the whole view has to be repainted.
+    final private Rect pending_damage_ = new Rect();             // sync: itself
+    private boolean pending_damage_full_ = true;                 // sync: pending_damage_
+    private int damage_scroll_x_ = 0;                            // sync: texture_mutex_
+    private int damage_scroll_y_ = 0;                            // sync: texture_mutex_
+
+    // Update notifications for C++ collected until the next display frame.
+    volatile private boolean coalesce_updates_ = true;           // threads: c++ & ui
+    final private Rect pending_update_ = new Rect();             // sync: itself
+    private int pending_update_frames_ = 0;                      // sync: pending_update_
+    private float pending_update_scale_ = 1.0f;                  // sync: pending_update_
+    private boolean update_frame_posted_ = false;                // sync: pending_update_
+    private Choreographer.FrameCallback update_frame_callback_ = null; // threads: ui
+
     private MyLayout layout_ = null;                             // threads: ui
     volatile private String object_name_ = "UnnamedView";
     volatile private boolean last_visibility_ = false;           // threads: c++ & ui
@@ -142,6 +170,7 @@ public abstract class OffscreenView
                 measured_width_ = child.getMeasuredWidth();
                 measured_height_ = child.getMeasuredHeight();
             }
+            publishViewState();
         }
 
         @Override
@@ -174,6 +203,40 @@ public abstract class OffscreenView
         Log.i(TAG, "OffscreenView constructor");
     }
 
+    private static boolean memory_callbacks_registered_ = false;
+
+    // Lets native code free its caches (pooled textures) when the system is low on memory.
+    // Called on UI thread.
+    private static void registerMemoryCallbacks(final Activity activity)
+    {
+        if (memory_callbacks_registered_ || activity == null)
+        {
+            return;
+        }
+        memory_callbacks_registered_ = true;
+        activity.getApplicationContext().registerComponentCallbacks(new ComponentCallbacks2() {
+            @Override
+            public void onTrimMemory(final int level)
+            {
+                if (level >= ComponentCallbacks2.TRIM_MEMORY_RUNNING_LOW)
+                {
+                    nativeTrimMemory(level);
+                }
+            }
+
+            @Override
+            public void onLowMemory()
+            {
+                nativeTrimMemory(ComponentCallbacks2.TRIM_MEMORY_COMPLETE);
+            }
+
+            @Override
+            public void onConfigurationChanged(final Configuration config)
+            {
+            }
+        });
+    }
+
     public void SetObjectName(String name)
     {
         object_name_ = name;
@@ -302,6 +365,7 @@ public abstract class OffscreenView
                 {
                     final Activity activity = getActivity();
                     final View view = getView();
+                    registerMemoryCallbacks(activity);
 
                     // Set initial view properties
                     view.setVisibility((last_visibility_)? View.VISIBLE: View.INVISIBLE);
@@ -531,8 +595,8 @@ public abstract class OffscreenView
                 {
                     synchronized (view_variables_mutex_) {
                         rendering_surface_ = new OffscreenGLTextureRenderingSurface(
-                            view_width_
-                            , view_height_
+                            scaledSize(view_width_)
+                            , scaledSize(view_height_)
                             , gl_texture_id_);
                     }
                 }
@@ -548,14 +612,15 @@ public abstract class OffscreenView
         });
     }
 
-    void initializeBitmap(final Bitmap bitmap_a, final Bitmap bitmap_b)
+    void initializeBitmap(
+        final Bitmap bitmap_a, final Bitmap bitmap_b, final Bitmap bitmap_c, final ByteBuffer exchange)
     {
         Log.i(TAG, "OffscreenView.intializeBitmap(name=\""+object_name_+"\"");
 
         synchronized (texture_mutex_)
         {
             rendering_surface_ = new OffscreenBitmapRenderingSurface();
-            rendering_surface_.setBitmaps(bitmap_a, bitmap_b);
+            rendering_surface_.setBitmaps(bitmap_a, bitmap_b, bitmap_c, exchange);
         }
 
         runViewAction(new Runnable() {
@@ -654,9 +719,51 @@ public abstract class OffscreenView
     private int last_texture_invalidation_ = 0;
     private boolean invalidated_ = true;
 
-    //! Schedules doDrawViewOnTexture() with filtering out extra calls.
+    // Set in UI thread while commands of a batch are executed, see applyBatch().
+    private boolean applying_batch_ = false;
+    private boolean batch_invalidated_ = false;
+    private boolean batch_force_invalidation_ = false;
+
+    //! Adds dirty area (in view content coordinates) to be repainted; null means the whole view.
+    private void addDamage(final Rect dirty)
+    {
+        synchronized (pending_damage_)
+        {
+            if (dirty == null)
+            {
+                pending_damage_full_ = true;
+            }
+            else
+            {
+                pending_damage_.union(dirty);
+            }
+        }
+    }
+
+    //! Schedules repainting of the whole view.
     protected void invalidateOffscreenView(final boolean force)
     {
+        addDamage(null);
+        scheduleDrawViewOnTexture(force);
+    }
+
+    //! Schedules repainting of the dirty area (in view content coordinates, like in View.invalidate()).
+    protected void invalidateOffscreenView(final Rect dirty)
+    {
+        addDamage(dirty);
+        scheduleDrawViewOnTexture(false);
+    }
+
+    //! Schedules doDrawViewOnTexture() with filtering out extra calls.
+    private void scheduleDrawViewOnTexture(final boolean force)
+    {
+        // Commands of a batch don't invalidate the view one by one, it is done once after the batch.
+        if (applying_batch_ && Looper.myLooper() == Looper.getMainLooper())
+        {
+            batch_invalidated_ = true;
+            batch_force_invalidation_ = batch_force_invalidation_ || force;
+            return;
+        }
         // Log.i(TAG, "invalidateOffscreenView "+object_name_+", last := "+last_texture_invalidation_);
         runOnUiThread(new Runnable(){
             @Override
@@ -755,10 +862,53 @@ public abstract class OffscreenView
             try
             {
                 // long t = System.nanoTime();
-                Canvas canvas = rendering_surface_.lockCanvas();
+
+                // Calculate the part of the surface changed since the previous paint.
+                final Rect damage = new Rect();
+                boolean full_damage = (v == null);
+                synchronized (pending_damage_)
+                {
+                    full_damage = full_damage || pending_damage_full_ || pending_damage_.isEmpty();
+                    damage.set(pending_damage_);
+                    pending_damage_.setEmpty();
+                    pending_damage_full_ = false;
+                }
+                final float scale;
+                synchronized (view_variables_mutex_)
+                {
+                    scale = render_scale_;
+                }
+                if (v != null)
+                {
+                    final int sx = v.getScrollX(), sy = v.getScrollY();
+                    full_damage = full_damage || sx != damage_scroll_x_ || sy != damage_scroll_y_;
+                    damage_scroll_x_ = sx;
+                    damage_scroll_y_ = sy;
+                    damage.offset(-sx, -sy);
+                }
+                if (scale != 1.0f && !full_damage)
+                {
+                    // The damage is in view coordinates and the surface is scaled.
+                    damage.set(
+                        (int)Math.floor(damage.left * scale)
+                        , (int)Math.floor(damage.top * scale)
+                        , (int)Math.ceil(damage.right * scale)
+                        , (int)Math.ceil(damage.bottom * scale));
+                }
+                final Rect bounds = new Rect();
+                rendering_surface_.getBounds(bounds);
+                if (full_damage || !damage.intersect(bounds))
+                {
+                    damage.set(bounds);
+                }
+                // Note: the surface may extend the damage to the area which it has to repaint.
+                final Rect repaint_area = new Rect(damage);
+
+                Canvas canvas = rendering_surface_.lockCanvas(repaint_area);
                 if (canvas == null)
                 {
                     Log.e(TAG, "doDrawViewOnTexture: failed to lock canvas for: "+object_name_);
+                    addDamage(null);
                 }
                 else
                 {
@@ -775,14 +925,20 @@ public abstract class OffscreenView
                                 scroll_x_ = v.getScrollX();
                                 scroll_y_ = v.getScrollY();
                             }
+                            if (scale != 1.0f)
+                            {
+                                canvas.scale(scale, scale);
+                            }
                             canvas.translate(-scroll_x_, -scroll_y_);
+                            publishViewState();
 
                             callViewPaintMethod(canvas);
 
                             synchronized (texture_transform_mutex_)
                             {
-                                last_painted_width_ = v.getWidth();
-                                last_painted_height_ = v.getHeight();
+                                // Size of the image in the surface.
+                                last_painted_width_ = (scale == 1.0f)? v.getWidth(): Math.max(1, (int)Math.ceil(v.getWidth() * scale));
+                                last_painted_height_ = (scale == 1.0f)? v.getHeight(): Math.max(1, (int)Math.ceil(v.getHeight() * scale));
                             }
 
                             result = true;
@@ -802,12 +958,10 @@ public abstract class OffscreenView
                         Log.e(TAG, "doDrawViewOnTexture painting failed!", e);
                     }
 
-                    rendering_surface_.unlockCanvas(canvas);
+                    rendering_surface_.unlockCanvas(canvas, damage);
                     // t = System.nanoTime() - t;
                     // Tell C++ part that we have a new image
-                    synchronized(nativePtrMutex()) {
-                        nativeUpdate(getNativePtr());
-                    }
+                    notifyUpdate(damage, scale);
 
                     // Log.i(TAG, "doDrawViewOnTexture: success, t="+t/1000000.0+"ms");
                 }
@@ -820,6 +974,80 @@ public abstract class OffscreenView
         return result;
     }
 
+    /*!
+     * Informs C++ about a painted frame. In coalescing mode, notifications are collected
+     * until the next display frame (vsync), so C++ gets at most one per frame no matter
+     * how often the view repaints.
+     */
+    private void notifyUpdate(final Rect damage, final float scale)
+    {
+        synchronized (pending_update_)
+        {
+            if (pending_update_frames_ > 0 && scale != pending_update_scale_ && !pending_update_.isEmpty())
+            {
+                // The render scale has changed since the collected frames were painted.
+                final float k = scale / pending_update_scale_;
+                pending_update_.set(
+                    (int)Math.floor(pending_update_.left * k)
+                    , (int)Math.floor(pending_update_.top * k)
+                    , (int)Math.ceil(pending_update_.right * k)
+                    , (int)Math.ceil(pending_update_.bottom * k));
+            }
+            pending_update_scale_ = scale;
+            pending_update_.union(damage);
+            ++pending_update_frames_;
+            // Choreographer is available since API 16 and only on threads with a looper
+            // (Android UI thread normally).
+            if (coalesce_updates_ && Build.VERSION.SDK_INT >= 16 && Looper.myLooper() != null)
+            {
+                if (!update_frame_posted_)
+                {
+                    if (update_frame_callback_ == null)
+                    {
+                        update_frame_callback_ = new Choreographer.FrameCallback() {
+                            @Override
+                            public void doFrame(long frame_time_nanos)
+                            {
+                                deliverUpdate();
+                            }
+                        };
+                    }
+                    Choreographer.getInstance().postFrameCallback(update_frame_callback_);
+                    update_frame_posted_ = true;
+                }
+                return;
+            }
+        }
+        deliverUpdate();
+    }
+
+    private void deliverUpdate()
+    {
+        final Rect area;
+        final int frames;
+        final float scale;
+        synchronized (pending_update_)
+        {
+            update_frame_posted_ = false;
+            if (pending_update_frames_ == 0)
+            {
+                return;
+            }
+            area = new Rect(pending_update_);
+            frames = pending_update_frames_;
+            scale = pending_update_scale_;
+            pending_update_.setEmpty();
+            pending_update_frames_ = 0;
+        }
+        synchronized(nativePtrMutex()) {
+            final long ptr = getNativePtr();
+            if (ptr != 0)
+            {
+                nativeUpdate(ptr, area.left, area.top, area.right, area.bottom, frames, scale);
+            }
+        }
+    }
+
     //! Called from C++ to get current texture.
     public boolean updateTexture()
     {
@@ -866,27 +1094,15 @@ public abstract class OffscreenView
         }
     }
 
-    //! Called from C++
-    public void setBitmaps(final Bitmap bitmap_a, final Bitmap bitmap_b)
-    {
-        synchronized (texture_mutex_) {
-            if (rendering_surface_ != null) {
-                rendering_surface_.setBitmaps(bitmap_a, bitmap_b);
-            }
-        }
-    }
-
-    //! Called from C++
-    public int getQtPaintingTexture()
+    //! Called from C++. Null bitmaps detach the surface from C++ memory (exchange buffer).
+    public void setBitmaps(
+        final Bitmap bitmap_a, final Bitmap bitmap_b, final Bitmap bitmap_c, final ByteBuffer exchange)
     {
         synchronized (texture_mutex_) {
             if (rendering_surface_ != null) {
-                // Log.i(TAG, "getQtPaintingTexture "+object_name_+" getting texture...");
-                return rendering_surface_.getQtPaintingTexture();
+                rendering_surface_.setBitmaps(bitmap_a, bitmap_b, bitmap_c, exchange);
             }
         }
-        // Log.i(TAG, "getQtPaintingTexture "+object_name_+" no rendering surface, returning -1");
-        return -1;
     }
 
     /*!
@@ -899,40 +1115,158 @@ public abstract class OffscreenView
 
     private long mouse_time_of_press_ = 0;
 
-    public void ProcessMouseEvent(final int action, final int x, final int y, final long timestamp)
+    // Touch event record layout, must match QAndroidOffscreenView::queueTouchEvent():
+    // action, action pointer id, timestamp (long), pointer count, then id, x, y per pointer.
+    private static final int TOUCH_RECORD_HEADER_SIZE = 20;
+    private static final int TOUCH_POINTER_SIZE = 12;
+    private static final int MAX_TOUCH_POINTERS = 32;
+
+    /*!
+     * Called from C++ with a batch of touch events queued since the previous call.
+     * Consecutive moves of the same pointers are merged into one MotionEvent with
+     * historical samples. All events are dispatched in one UI thread action in their
+     * original order.
+     */
+    public void ProcessTouchEvents(final ByteBuffer buffer, final int size)
     {
         if (getNativePtr() == 0)
         {
-            Log.i(TAG, "ProcessMouseEvent: zero native ptr, ignoring.");
+            Log.i(TAG, "ProcessTouchEvents: zero native ptr, ignoring.");
             return;
         }
         final View view = getView();
-        if (view != null)
+        if (view == null)
         {
-            final long t = (timestamp == 0)? SystemClock.uptimeMillis(): timestamp;
-            // Log.i(TAG, "MILLIS="+SystemClock.uptimeMillis()+" TS="+timestamp);
-            if (action == MotionEvent.ACTION_DOWN || mouse_time_of_press_ == 0)
+            return;
+        }
+        // The buffer is C++ memory valid only during this call, so decode it now.
+        final ArrayList<MotionEvent> events = new ArrayList<MotionEvent>();
+        try
+        {
+            buffer.order(ByteOrder.nativeOrder());
+            buffer.position(0);
+            buffer.limit(size);
+            MotionEvent last_move = null;
+            while (buffer.remaining() >= TOUCH_RECORD_HEADER_SIZE)
             {
-                mouse_time_of_press_ = t;
-            }
-            // Log.i(TAG, "ProcessMouseEvent("+action+", "+x+", "+y+") time of press = "+mouse_time_of_press_+", t="+t);
-            final MotionEvent event = MotionEvent.obtain(mouse_time_of_press_ /* downTime*/, t /* eventTime */, action, x, y, 0 /*metaState*/);
-            event.setSource(InputDevice.SOURCE_TOUCHSCREEN);
-            runOnUiThread(new Runnable() {
-                @Override
-                public void run()
+                final int action = buffer.getInt();
+                final int action_pointer_id = buffer.getInt();
+                final long timestamp = buffer.getLong();
+                final int count = buffer.getInt();
+                if (count < 1 || count > MAX_TOUCH_POINTERS || buffer.remaining() < count * TOUCH_POINTER_SIZE)
                 {
-                    offscreen_touch_ = true;
-                    view.onTouchEvent(event);
-                    offscreen_touch_ = false;
-                    if (!attaching_mode_)
+                    Log.e(TAG, "ProcessTouchEvents: invalid pointer count " + count + ", ignoring the rest of the events.");
+                    break;
+                }
+                final int [] ids = new int[count];
+                final MotionEvent.PointerCoords [] coords = new MotionEvent.PointerCoords[count];
+                int action_index = 0;
+                for (int i = 0; i < count; ++i)
+                {
+                    ids[i] = buffer.getInt();
+                    coords[i] = new MotionEvent.PointerCoords();
+                    coords[i].x = buffer.getInt();
+                    coords[i].y = buffer.getInt();
+                    coords[i].pressure = 1.0f;
+                    coords[i].size = 1.0f;
+                    if (ids[i] == action_pointer_id)
                     {
-                        // If the view has only been scrolled, it won't call invalidate(). So we just force it to repaint for now.
-                        doDrawViewOnTexture();
+                        action_index = i;
                     }
                 }
-            });
+                final long t = (timestamp == 0)? SystemClock.uptimeMillis(): timestamp;
+                if (action == MotionEvent.ACTION_DOWN || mouse_time_of_press_ == 0)
+                {
+                    mouse_time_of_press_ = t;
+                }
+                if (action == MotionEvent.ACTION_MOVE && last_move != null && samePointers(last_move, ids))
+                {
+                    if (getApiLevel() >= 14)
+                    {
+                        last_move.addBatch(t, coords, 0);
+                    }
+                    else
+                    {
+                        last_move.addBatch(t, coords[0].x, coords[0].y, 1.0f, 1.0f, 0);
+                    }
+                    continue;
+                }
+                final MotionEvent event = obtainTouchEvent(t, action, action_index, ids, coords);
+                events.add(event);
+                last_move = (action == MotionEvent.ACTION_MOVE)? event: null;
+            }
+        }
+        catch (final Throwable e)
+        {
+            Log.e(TAG, "ProcessTouchEvents: failed to decode the events:", e);
         }
+        if (events.isEmpty())
+        {
+            return;
+        }
+        runOnUiThread(new Runnable() {
+            @Override
+            public void run()
+            {
+                offscreen_touch_ = true;
+                for (final MotionEvent event: events)
+                {
+                    view.onTouchEvent(event);
+                }
+                offscreen_touch_ = false;
+                if (!attaching_mode_)
+                {
+                    // If the view has only been scrolled, it won't call invalidate(). So we just force it to repaint for now.
+                    doDrawViewOnTexture();
+                }
+            }
+        });
+    }
+
+    private static boolean samePointers(final MotionEvent event, final int [] ids)
+    {
+        if (event.getPointerCount() != ids.length)
+        {
+            return false;
+        }
+        for (int i = 0; i < ids.length; ++i)
+        {
+            if (event.getPointerId(i) != ids[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    private MotionEvent obtainTouchEvent(
+        final long t, final int action, final int action_index, final int [] ids, final MotionEvent.PointerCoords [] coords)
+    {
+        MotionEvent event;
+        if (getApiLevel() >= 14)
+        {
+            final MotionEvent.PointerProperties [] properties = new MotionEvent.PointerProperties[ids.length];
+            for (int i = 0; i < ids.length; ++i)
+            {
+                properties[i] = new MotionEvent.PointerProperties();
+                properties[i].id = ids[i];
+                properties[i].toolType = MotionEvent.TOOL_TYPE_FINGER;
+            }
+            final int full_action = (action == MotionEvent.ACTION_POINTER_DOWN || action == MotionEvent.ACTION_POINTER_UP)
+                ? action | (action_index << MotionEvent.ACTION_POINTER_INDEX_SHIFT)
+                : action;
+            event = MotionEvent.obtain(
+                mouse_time_of_press_ /* downTime */, t /* eventTime */, full_action
+                , ids.length, properties, coords
+                , 0 /* metaState */, 0 /* buttonState */, 1.0f, 1.0f /* precision */
+                , 0 /* deviceId */, 0 /* edgeFlags */, InputDevice.SOURCE_TOUCHSCREEN, 0 /* flags */);
+        }
+        else
+        {
+            event = MotionEvent.obtain(mouse_time_of_press_ /* downTime*/, t /* eventTime */, action, coords[0].x, coords[0].y, 0 /*metaState*/);
+            event.setSource(InputDevice.SOURCE_TOUCHSCREEN);
+        }
+        return event;
     }
 
     /*//! Called from C++
@@ -1095,6 +1429,23 @@ public abstract class OffscreenView
         show_keyboard_on_focus_in_ = show;
     }
 
+    // Called from C++ to set coalesce_updates_ flag
+    public void setCoalesceUpdates(boolean coalesce)
+    {
+        coalesce_updates_ = coalesce;
+        if (!coalesce)
+        {
+            // Don't keep anything waiting for a frame callback.
+            runOnUiThread(new Runnable() {
+                @Override
+                public void run()
+                {
+                    deliverUpdate();
+                }
+            });
+        }
+    }
+
     //! Called from C++ to change size of the view.
     public void resizeOffscreenView(final int w, final int h)
     {
@@ -1108,7 +1459,7 @@ public abstract class OffscreenView
                 view_width_ = w;
                 view_height_ = h;
                 if (rendering_surface_ != null) {
-                    rendering_surface_.setNewSize(w, h);
+                    rendering_surface_.setNewSize(scaledSize(w), scaledSize(h));
                 }
             }
         }
@@ -1135,6 +1486,31 @@ public abstract class OffscreenView
         });
     }
 
+    //! Size of the surface for a view size x. Should be called with view_variables_mutex_ locked.
+    private int scaledSize(final int x)
+    {
+        // Must give the same result as QAndroidOffscreenView::renderSize().
+        return (render_scale_ == 1.0f)? x: Math.max(1, (int)Math.ceil(x * render_scale_));
+    }
+
+    /*!
+     * Called from C++ to draw the view into a smaller surface (e.g. for previews). The view
+     * keeps its layout size, so its contents and touch coordinates don't change.
+     */
+    public void setRenderScale(final float scale)
+    {
+        Log.i(TAG, "setRenderScale " + scale);
+        synchronized (texture_mutex_) {
+            synchronized (view_variables_mutex_) {
+                render_scale_ = scale;
+                if (rendering_surface_ != null) {
+                    rendering_surface_.setNewSize(scaledSize(view_width_), scaledSize(view_height_));
+                }
+            }
+        }
+        invalidateOffscreenView();
+    }
+
     /*!
      * Called from C++ to inform Android about real position of the view.
      * This is necessary for text editors as it affects position of text selection markers.
@@ -1166,11 +1542,6 @@ public abstract class OffscreenView
         });
     }
 
-    public boolean isViewCreated()
-    {
-        return getView() != null;
-    }
-    
 
     public final long getNativePtr()
     {
@@ -1229,44 +1600,43 @@ public abstract class OffscreenView
         invalidateOffscreenView();
     }
 
-    public int getScrollX()
-    {
-        synchronized (view_variables_mutex_)
-        {
-            return scroll_x_;
-        }
-    }
-
-    public int getScrollY()
-    {
-        synchronized (view_variables_mutex_)
-        {
-            return scroll_y_;
-        }
-    }
-
-    public int getMeasuredWidth()
+    /*!
+     * Sends scroll position and measured size of the view to C++ if they have changed
+     * since the last call, so C++ reads them without calling Java.
+     */
+    private void publishViewState()
     {
+        final int sx, sy, mw, mh;
         synchronized (view_variables_mutex_)
         {
-            return measured_width_;
+            if (scroll_x_ == published_scroll_x_ && scroll_y_ == published_scroll_y_
+                && measured_width_ == published_measured_width_ && measured_height_ == published_measured_height_)
+            {
+                return;
+            }
+            sx = published_scroll_x_ = scroll_x_;
+            sy = published_scroll_y_ = scroll_y_;
+            mw = published_measured_width_ = measured_width_;
+            mh = published_measured_height_ = measured_height_;
         }
-    }
-
-    public int getMeasuredHeight()
-    {
-        synchronized (view_variables_mutex_)
-        {
-            return measured_height_;
+        synchronized(nativePtrMutex()) {
+            final long ptr = getNativePtr();
+            if (ptr != 0)
+            {
+                nativeViewStateChanged(ptr, sx, sy, mw, mh);
+            }
         }
     }
     // C++ function called from Java to tell that the texture has new contents.
-    // abstract public native void nativeUpdate(long nativeptr);
+    // abstract public native void nativeUpdate(long nativeptr, int left, int top, int right, int bottom, int frames, float scale);
 
     protected interface OffscreenRenderingSurface
     {
-        abstract Canvas lockCanvas();
-        abstract void unlockCanvas(Canvas canvas);
+        //! Locks canvas to repaint 'dirty' area. The area can be extended by the surface.
+        abstract Canvas lockCanvas(Rect dirty);
+        //! 'damage' is the area changed since the previous frame.
+        abstract void unlockCanvas(Canvas canvas, final Rect damage);
+        abstract void getBounds(Rect out_bounds);
 
         //
         // OpenGL texture mode
@@ -1279,76 +1649,125 @@ public abstract class OffscreenView
         //
         // Bitmap mode
         //
-        abstract public void setBitmaps(final Bitmap bitmap_a, final Bitmap bitmap_b);
-        abstract public int getQtPaintingTexture();
+        abstract public void setBitmaps(
+            final Bitmap bitmap_a, final Bitmap bitmap_b, final Bitmap bitmap_c, final ByteBuffer exchange);
 
         abstract public void release();
     }
 
+    /*!
+     * Triple-buffered Bitmap mode. Java paints into its back bitmap, then publishes it by
+     * exchanging its index with the "latest" slot of the exchange buffer; Qt takes the latest
+     * frame the same way. Neither side waits for the other. The exchange buffer is C++
+     * memory, its layout must match QAndroidOffscreenView::BitmapExchange:
+     *  0: state (index of the latest bitmap | BITMAP_FRESH until Qt takes it),
+     *  4 + index * 24: damage left, top, right, bottom and painted width, height of the bitmap.
+     */
     protected class OffscreenBitmapRenderingSurface implements OffscreenRenderingSurface
     {
-        Bitmap bitmap_a_ = null;
-        Bitmap bitmap_b_ = null;
+        private static final int BITMAP_INDEX_MASK = 3;
+        private static final int BITMAP_FRESH = 4;
+        private static final int OFFSET_STATE = 0;
+        private static final int OFFSET_FRAMES = 4;
+        private static final int FRAME_SIZE = 24;
+
+        final Bitmap [] bitmaps_ = { null, null, null };
+        ByteBuffer exchange_ = null;
+        // Bitmap owned by the painter. Initially, bitmap 1 is the latest one and Qt owns bitmap 2.
         int draw_bitmap_ = 0;
         boolean has_texture_ = false;
-        int last_drawn_bitmap_ = -1;
+        // Areas which have been changed since the bitmap has been painted last time.
+        final Rect [] damage_ = { new Rect(), new Rect(), new Rect() };
+        // Damage stored with the latest published bitmap, relatively to the bitmap Qt has taken.
+        final Rect published_damage_ = new Rect();
 
         public OffscreenBitmapRenderingSurface()
         {
         }
 
+        private boolean isValid()
+        {
+            return exchange_ != null && bitmaps_[0] != null && bitmaps_[1] != null && bitmaps_[2] != null;
+        }
+
         @Override
-        public Canvas lockCanvas()
+        public Canvas lockCanvas(Rect dirty)
         {
             synchronized (texture_mutex_)
             {
-                if (bitmap_a_ == null || bitmap_b_ == null)
+                if (!isValid())
                 {
                     return null;
                 }
-                Bitmap bitmap = (draw_bitmap_ == 0)? bitmap_a_: bitmap_b_;
                 // Log.i(TAG, "lockCanvas: locking "+object_name_+" texture="+draw_bitmap_);
-                last_drawn_bitmap_ = draw_bitmap_;
-                return new Canvas(bitmap);
+                // The bitmap still contains an older frame, so it has to be repainted in all areas
+                // changed since it was painted last time.
+                for (final Rect d: damage_)
+                {
+                    d.union(dirty);
+                }
+                dirty.set(damage_[draw_bitmap_]);
+                Canvas canvas = new Canvas(bitmaps_[draw_bitmap_]);
+                canvas.clipRect(dirty);
+                return canvas;
             }
         }
 
         @Override
-        public void unlockCanvas(Canvas canvas)
+        public void unlockCanvas(Canvas canvas, final Rect damage)
         {
             synchronized (texture_mutex_)
             {
-                // Marking that we have a painted texture
-                has_texture_ = true;
+                if (!isValid())
+                {
+                    return;
+                }
+                damage_[draw_bitmap_].setEmpty();
+
+                // If Qt has not taken the previous frame yet, it will skip it, so its damage
+                // goes with this frame. (If Qt takes it right after this check the damage is
+                // just larger than necessary.)
+                if ((nativeLoadExchange(exchange_) & BITMAP_FRESH) == 0)
+                {
+                    published_damage_.setEmpty();
+                }
+                published_damage_.union(damage);
+
+                final int frame = OFFSET_FRAMES + draw_bitmap_ * FRAME_SIZE;
+                exchange_.putInt(frame, published_damage_.left);
+                exchange_.putInt(frame + 4, published_damage_.top);
+                exchange_.putInt(frame + 8, published_damage_.right);
+                exchange_.putInt(frame + 12, published_damage_.bottom);
                 synchronized (texture_transform_mutex_)
                 {
                     last_texture_width_ = last_painted_width_;
                     last_texture_height_ = last_painted_height_;
+                    exchange_.putInt(frame + 16, last_texture_width_);
+                    exchange_.putInt(frame + 20, last_texture_height_);
                 }
+
+                // Release the frame to Qt and take the bitmap it has left (the one it has
+                // released or the one we've published before and Qt has skipped).
+                draw_bitmap_ = nativeExchangeBitmap(exchange_, draw_bitmap_ | BITMAP_FRESH) & BITMAP_INDEX_MASK;
+
+                // Marking that we have a painted texture
+                has_texture_ = true;
             }
         }
 
         @Override
-        public int getQtPaintingTexture()
+        public void getBounds(Rect out_bounds)
         {
             synchronized (texture_mutex_)
             {
-                if (!hasTexture())
+                if (bitmaps_[0] == null)
                 {
-                    // Log.i(TAG, "getQtPaintingTexture "+object_name_+" -1!");
-                    return -1;
+                    out_bounds.setEmpty();
                 }
-                // Swapping buffers, so Android won't paint on the Bitmap
-                // which is currently being used by Qt.
-                if (draw_bitmap_ != last_drawn_bitmap_)
+                else
                 {
-                    // Log.i(TAG, "getQtPaintingTexture "+object_name_+" -1, new bitmap is not ready yet!");
-                    return -1;
+                    out_bounds.set(0, 0, bitmaps_[0].getWidth(), bitmaps_[0].getHeight());
                 }
-                int old_draw_bitmap = draw_bitmap_;
-                draw_bitmap_ = (draw_bitmap_ == 0)? 1: 0;
-                // Log.i(TAG, "getQtPaintingTexture: "+object_name_+" returning texture="+old_draw_bitmap);
-                return old_draw_bitmap;
             }
         }
 
@@ -1367,7 +1786,7 @@ public abstract class OffscreenView
         @Override
         public boolean hasTexture()
         {
-            return has_texture_ && bitmap_a_ != null && bitmap_b_ != null;
+            return has_texture_ && isValid();
         }
 
         @Override
@@ -1376,18 +1795,32 @@ public abstract class OffscreenView
         }
 
         @Override
-        public void setBitmaps(final Bitmap bitmap_a, final Bitmap bitmap_b)
+        public void setBitmaps(
+            final Bitmap bitmap_a, final Bitmap bitmap_b, final Bitmap bitmap_c, final ByteBuffer exchange)
         {
             synchronized (texture_mutex_)
             {
                 // Log.i(TAG, "setBitmaps "+object_name_);
-                if (bitmap_a_ != bitmap_a || bitmap_b_ != bitmap_b)
+                bitmaps_[0] = bitmap_a;
+                bitmaps_[1] = bitmap_b;
+                bitmaps_[2] = bitmap_c;
+                exchange_ = exchange;
+                draw_bitmap_ = 0;
+                has_texture_ = false;
+                published_damage_.setEmpty();
+                if (exchange_ != null)
                 {
-                    bitmap_a_ = bitmap_a;
-                    bitmap_b_ = bitmap_b;
-                    draw_bitmap_ = 0;
-                    has_texture_ = false;
-                    last_drawn_bitmap_ = -1;
+                    // C++ does not read the buffer while it is passing new bitmaps, and
+                    // the first nativeExchangeBitmap() publishes this value along with the frame.
+                    exchange_.order(ByteOrder.nativeOrder());
+                    exchange_.putInt(OFFSET_STATE, 1);
+                }
+                if (isValid())
+                {
+                    for (final Rect d: damage_)
+                    {
+                        d.set(0, 0, bitmaps_[0].getWidth(), bitmaps_[0].getHeight());
+                    }
                 }
             }
         }
@@ -1420,11 +1853,12 @@ public abstract class OffscreenView
         }
 
         @Override
-        public Canvas lockCanvas()
+        public Canvas lockCanvas(Rect dirty)
         {
             try
             {
-                return surface_.lockCanvas(new Rect(0, 0, texture_width_, texture_height_));
+                // Surface keeps the contents outside of the dirty area and may extend it if it can't.
+                return surface_.lockCanvas(dirty);
             }
             catch (final Throwable e)
             {
@@ -1435,7 +1869,7 @@ public abstract class OffscreenView
         }
 
         @Override
-        public void unlockCanvas(Canvas canvas)
+        public void unlockCanvas(Canvas canvas, final Rect damage)
         {
             try
             {
@@ -1513,14 +1947,15 @@ public abstract class OffscreenView
         }
 
         @Override
-        public void setBitmaps(final Bitmap bitmap_a, final Bitmap bitmap_b)
+        public void setBitmaps(
+            final Bitmap bitmap_a, final Bitmap bitmap_b, final Bitmap bitmap_c, final ByteBuffer exchange)
         {
         }
 
         @Override
-        public int getQtPaintingTexture()
+        public void getBounds(Rect out_bounds)
         {
-            return -1;
+            out_bounds.set(0, 0, texture_width_, texture_height_);
         }
 
         @Override
@@ -1609,6 +2044,135 @@ public abstract class OffscreenView
         });
     }
 
+    // Opcodes of batched commands, must match QAndroidOffscreenViewBatch::Opcode.
+    // Subclasses add their own commands starting from BATCH_OP_USER.
+    protected static final int BATCH_OP_SET_SCROLL_X = 1;
+    protected static final int BATCH_OP_SET_SCROLL_Y = 2;
+    protected static final int BATCH_OP_SET_POSITION = 3;
+    protected static final int BATCH_OP_USER = 100;
+
+    //! Called from C++ to execute a sequence of commands recorded by QAndroidOffscreenViewBatch.
+    //! The buffer wraps C++ memory which is only valid during this call, so it is decoded right away.
+    public void applyBatch(final ByteBuffer buffer, final int size)
+    {
+        final ArrayList<Runnable> actions = new ArrayList<Runnable>();
+        try
+        {
+            buffer.order(ByteOrder.nativeOrder());
+            buffer.position(0);
+            buffer.limit(size);
+            while (buffer.remaining() >= 4)
+            {
+                final int opcode = buffer.getInt();
+                final Runnable action = decodeBatchCommand(opcode, buffer);
+                if (action == null)
+                {
+                    Log.e(TAG, "applyBatch: unknown opcode " + opcode + ", ignoring the rest of the batch.");
+                    break;
+                }
+                actions.add(action);
+            }
+        }
+        catch (final Throwable e)
+        {
+            Log.e(TAG, "applyBatch: failed to decode the batch:", e);
+        }
+        if (actions.isEmpty())
+        {
+            return;
+        }
+        runViewAction(new Runnable() {
+            @Override
+            public void run()
+            {
+                // The commands call regular setters which run their view actions
+                // immediately because we are already on UI thread.
+                applying_batch_ = true;
+                batch_invalidated_ = false;
+                batch_force_invalidation_ = false;
+                try
+                {
+                    for (final Runnable action: actions)
+                    {
+                        try
+                        {
+                            action.run();
+                        }
+                        catch (final Throwable e)
+                        {
+                            Log.e(TAG, "Exception in applyBatch.run:", e);
+                        }
+                    }
+                }
+                finally
+                {
+                    applying_batch_ = false;
+                }
+                // The damage is already collected from the commands, so just draw it.
+                if (batch_invalidated_)
+                {
+                    scheduleDrawViewOnTexture(batch_force_invalidation_);
+                }
+            }
+        });
+    }
+
+    //! Read arguments of a batched command and return an action executing it,
+    //! or null if the opcode is not known.
+    protected Runnable decodeBatchCommand(final int opcode, final ByteBuffer buffer)
+    {
+        switch (opcode)
+        {
+            case BATCH_OP_SET_SCROLL_X:
+            {
+                final int x = buffer.getInt();
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setScrollX(x);
+                    }
+                };
+            }
+            case BATCH_OP_SET_SCROLL_Y:
+            {
+                final int y = buffer.getInt();
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setScrollY(y);
+                    }
+                };
+            }
+            case BATCH_OP_SET_POSITION:
+            {
+                final int left = buffer.getInt();
+                final int top = buffer.getInt();
+                return new Runnable() {
+                    @Override
+                    public void run()
+                    {
+                        setPosition(left, top);
+                    }
+                };
+            }
+        }
+        return null;
+    }
+
+    //! Read a string written by QAndroidOffscreenViewBatch::appendString().
+    protected static String readBatchString(final ByteBuffer buffer)
+    {
+        final int length = buffer.getInt();
+        final char[] chars = new char[length];
+        for (int i = 0; i < length; ++i)
+        {
+            chars[i] = buffer.getChar();
+        }
+        return new String(chars);
+    }
+
     // Test function for development experiments, don't use it!
     public void testFunction()
     {
@@ -1640,8 +2204,14 @@ public abstract class OffscreenView
         }
     }
 
-    public native void nativeUpdate(long nativeptr);
+    public native void nativeUpdate(long nativeptr, int left, int top, int right, int bottom, int frames, float scale);
     public native Activity getActivity();
     public native void nativeViewCreated(long nativeptr);
+    //! Atomically stores 'value' into the state of the bitmap exchange buffer and returns the old state.
+    public static native int nativeExchangeBitmap(ByteBuffer exchange, int value);
+    //! Atomically loads the state of the bitmap exchange buffer.
+    public static native int nativeLoadExchange(ByteBuffer exchange);
     public native void nativeOnVisibleRect(long nativeptr, int left, int top, int right, int bottom);
+    public native void nativeViewStateChanged(long nativeptr, int scroll_x, int scroll_y, int measured_width, int measured_height);
+    public static native void nativeTrimMemory(int level);
 }
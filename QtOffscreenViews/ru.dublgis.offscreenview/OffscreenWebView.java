@@ -36,16 +36,25 @@
 
 package ru.dublgis.offscreenview;
 
+import java.io.InputStream;
+import java.nio.ByteBuffer;
+import java.security.SecureRandom;
+import java.util.ArrayList;
 import java.util.Map;
 import java.util.HashMap;
 import android.content.Context;
 import android.graphics.Bitmap;
 import android.graphics.Rect;
+import android.net.Uri;
 import android.net.http.SslError;
 import android.os.Message;
 import android.view.View;
 import android.view.KeyEvent;
 import android.view.MotionEvent;
+import android.webkit.JavascriptInterface;
+import android.webkit.ValueCallback;
+import android.webkit.WebMessage;
+import android.webkit.WebMessagePort;
 import android.webkit.WebView;
 import android.webkit.WebViewClient;
 import android.webkit.WebChromeClient;
@@ -53,6 +62,8 @@ import android.webkit.WebResourceResponse;
 import android.webkit.HttpAuthHandler;
 import android.webkit.SslErrorHandler;
 import android.graphics.Canvas;
+import android.graphics.Color;
+import android.graphics.PorterDuff;
 
 import ru.dublgis.androidhelpers.Log;
 
@@ -71,9 +82,17 @@ class OffscreenWebView extends OffscreenView
             @Override
             public void onLoadResource(WebView view, String url) { OffscreenWebView.this.onLoadResource(getNativePtr(), url); }
             @Override
-            public void onPageFinished(WebView view, String url) { OffscreenWebView.this.onPageFinished(getNativePtr(), url); }
+            public void onPageFinished(WebView view, String url)
+            {
+                installChannel();
+                OffscreenWebView.this.onPageFinished(getNativePtr(), url);
+            }
             @Override
-            public void onPageStarted(WebView view, String url, Bitmap favicon) { OffscreenWebView.this.onPageStarted(getNativePtr(), url, favicon); }
+            public void onPageStarted(WebView view, String url, Bitmap favicon)
+            {
+                closeChannel();
+                OffscreenWebView.this.onPageStarted(getNativePtr(), url, favicon);
+            }
             @Override
             public void onReceivedError(WebView view, int errorCode, String description, String failingUrl) { OffscreenWebView.this.onReceivedError(getNativePtr(), errorCode, description, failingUrl); }
             @Override
@@ -89,7 +108,37 @@ class OffscreenWebView extends OffscreenView
             @Override
             public void onUnhandledKeyEvent(WebView view, KeyEvent event) { OffscreenWebView.this.onUnhandledKeyEvent(getNativePtr(), event); }
             @Override
-            public WebResourceResponse shouldInterceptRequest(WebView view, String url) { return OffscreenWebView.this.shouldInterceptRequest(getNativePtr(), url); }
+            public WebResourceResponse shouldInterceptRequest(WebView view, String url)
+            {
+                // Called in a WebView thread. The mutex is held only to take a reference to the
+                // resource tables: reading and decompressing the data must not block the C++ object.
+                final long resources;
+                synchronized(nativePtrMutex()) {
+                    final long ptr = getNativePtr();
+                    if (ptr == 0)
+                    {
+                        return null;
+                    }
+                    final WebResourceResponse response = OffscreenWebView.this.shouldInterceptRequest(ptr, url);
+                    if (response != null)
+                    {
+                        return response;
+                    }
+                    resources = nativeAcquireResources(ptr);
+                }
+                if (resources == 0)
+                {
+                    return null;
+                }
+                try
+                {
+                    return nativeServeResource(resources, url);
+                }
+                finally
+                {
+                    nativeReleaseResources(resources);
+                }
+            }
             @Override
             public boolean shouldOverrideKeyEvent(WebView view, KeyEvent event) { return OffscreenWebView.this.shouldOverrideKeyEvent(getNativePtr(), event); }
             @Override
@@ -187,6 +236,17 @@ class OffscreenWebView extends OffscreenView
             }
         }
 
+        // Tell C++ the document height in view pixels, so it doesn't scroll or request tiles past it.
+        private void reportTiledContentHeight()
+        {
+            final int height = computeVerticalScrollRange();
+            if (height != tiled_content_height_)
+            {
+                tiled_content_height_ = height;
+                onTiledContentHeight(getNativePtr(), height);
+            }
+        }
+
         @Override
         protected void onDraw(Canvas canvas)
         {
@@ -198,13 +258,31 @@ class OffscreenWebView extends OffscreenView
             super.onDraw(canvas);
         }
 
+        @Override
+        protected void onScrollChanged(int l, int t, int oldl, int oldt)
+        {
+            super.onScrollChanged(l, t, oldl, oldt);
+            if (tiled_mode_)
+            {
+                // The following invalidate() is caused by the scroll and doesn't change the tiles.
+                scroll_invalidation_pending_ = true;
+                reportTiledContentHeight();
+                onTiledScrollChanged(getNativePtr(), l, t);
+            }
+        }
+
         // Old WebKit updating here
         @Override
         public void invalidate(Rect dirty)
         {
             Log.i(TAG, "MyWebView.invalidate(Rect dirty)");
             super.invalidate(dirty);
-            invalidateOffscreenView();
+            if (tiled_mode_ && dirty != null)
+            {
+                reportTiledContentHeight();
+                onTilesDamaged(getNativePtr(), dirty.left, dirty.top, dirty.right, dirty.bottom);
+            }
+            invalidateOffscreenView(dirty);
         }
 
         // Old WebKit updating here
@@ -217,12 +295,18 @@ class OffscreenWebView extends OffscreenView
             int my_r = getScrollX() + getWidth();
             int my_b = getScrollY() + getHeight();
             // Check that the invalidated rectangle actually visible
+            if (tiled_mode_)
+            {
+                // Tiles outside of the view are damaged too.
+                reportTiledContentHeight();
+                onTilesDamaged(getNativePtr(), l, t, r, b);
+            }
             if (l > my_r || t > my_b)
             {
                 // Log.i(TAG, "MyWebView.invalidate: ignoring invisible rectangle");
                 return;
             }
-            invalidateOffscreenView();
+            invalidateOffscreenView(new Rect(l, t, r, b));
         }
 
         // Old & new WebKit updating
@@ -231,6 +315,19 @@ class OffscreenWebView extends OffscreenView
         {
             // Log.i(TAG, "MyWebView.invalidate(void)");
             super.invalidate();
+            if (tiled_mode_)
+            {
+                if (scroll_invalidation_pending_)
+                {
+                    scroll_invalidation_pending_ = false;
+                }
+                else
+                {
+                    // Empty rectangle: all tiles
+                    reportTiledContentHeight();
+                    onTilesDamaged(getNativePtr(), 0, 0, 0, 0);
+                }
+            }
             invalidateOffscreenView();
         }
 
@@ -292,6 +389,106 @@ class OffscreenWebView extends OffscreenView
 
     }
 
+    // Tiled rendering (see QAndroidOffscreenWebView::setTiledRendering())
+    private volatile boolean tiled_mode_ = false;
+    // Accessed in UI thread only
+    private boolean scroll_invalidation_pending_ = false;
+    private int tiled_content_height_ = -1;
+
+    // JavaScript message channel (see QAndroidOffscreenWebView::postMessage())
+    private static final String CHANNEL_BRIDGE_NAME = "qtChannelBridge";
+    private static final String CHANNEL_PORT_MESSAGE = "qtChannelPort";
+    private static final String CHANNEL_TOKEN_PLACEHOLDER = "@TOKEN@";
+    // Installed into each loaded page of the allowed origin. Messages are batched both ways: the page
+    // sends a JSON array of strings per JavaScript task, C++ sends a JSON array per flush. Binary
+    // messages come as {"blob": url} and are loaded from shouldInterceptRequest() keeping the order
+    // of the messages. The token is known only to the shim in the main frame, so other frames
+    // can neither use the bridge nor hand the page a port of their own.
+    private static final String CHANNEL_SHIM =
+        "(function() {" +
+        "var ch = window.qtChannel || {};" +
+        "if (ch._receive) return;" +
+        "var token = '" + CHANNEL_TOKEN_PLACEHOLDER + "';" +
+        "var port = null, outgoing = [], flushing = false, pending = [];" +
+        "function deliver(m) {" +
+        "  if (typeof ch.onmessage === 'function') { try { ch.onmessage(m); } catch (e) { console.error(e); } }" +
+        "}" +
+        "function pump() {" +
+        "  while (pending.length > 0 && pending[0].ready) { var item = pending.shift(); if (!item.failed) deliver(item.data); }" +
+        "}" +
+        "function load(url) {" +
+        "  var item = { ready: false, failed: false, data: null }, xhr = new XMLHttpRequest();" +
+        "  pending.push(item);" +
+        "  xhr.open('GET', url);" +
+        "  xhr.responseType = 'arraybuffer';" +
+        "  xhr.onload = function() { item.data = xhr.response; item.ready = true; pump(); };" +
+        "  xhr.onerror = function() { console.error('qtChannel: failed to load ' + url); item.failed = item.ready = true; pump(); };" +
+        "  xhr.send();" +
+        "}" +
+        "function flush() {" +
+        "  flushing = false;" +
+        "  if (outgoing.length === 0 || (!port && !window." + CHANNEL_BRIDGE_NAME + ")) return;" +
+        "  var batch = JSON.stringify(outgoing);" +
+        "  outgoing = [];" +
+        "  if (port) port.postMessage(batch); else window." + CHANNEL_BRIDGE_NAME + ".postMessages(token, batch);" +
+        "}" +
+        "ch._receive = function(batch) {" +
+        "  for (var i = 0; i < batch.length; ++i) {" +
+        "    var m = batch[i];" +
+        "    if (m !== null && typeof m === 'object' && typeof m.blob === 'string') load(m.blob);" +
+        "    else if (pending.length > 0) pending.push({ ready: true, failed: false, data: m });" +
+        "    else deliver(m);" +
+        "  }" +
+        "};" +
+        "ch.postMessage = function(m) {" +
+        "  outgoing.push(String(m));" +
+        "  if (!flushing) { flushing = true; setTimeout(flush, 0); }" +
+        "};" +
+        "window.addEventListener('message', function(e) {" +
+        "  if (port || e.data !== '" + CHANNEL_PORT_MESSAGE + ":' + token || !e.ports || e.ports.length === 0) return;" +
+        "  port = e.ports[0];" +
+        "  port.onmessage = function(pe) { ch._receive(JSON.parse(pe.data)); };" +
+        "  port.postMessage('" + CHANNEL_PORT_MESSAGE + "');" +
+        "  flush();" +
+        "});" +
+        "window.qtChannel = ch;" +
+        "var ready = document.createEvent('Event');" +
+        "ready.initEvent('qtchannelready', false, false);" +
+        "window.dispatchEvent(ready);" +
+        "})();";
+    private volatile boolean channel_enabled_ = false;
+    // Origin of the pages the channel is installed into ("*" for any), null if none.
+    private volatile String channel_allowed_origin_ = null;
+    // Origin of the page the channel is installed into, null if there is no channel.
+    private volatile String channel_page_origin_ = null;
+    // Secret of the current page's shim, see CHANNEL_SHIM.
+    private volatile String channel_token_ = null;
+    private final SecureRandom channel_random_ = new SecureRandom();
+    // Accessed in UI thread only
+    private boolean channel_ready_ = false;
+    private int channel_generation_ = 0;
+    private WebMessagePort channel_port_ = null;
+    private boolean channel_port_confirmed_ = false;
+    private final ArrayList<String> channel_queue_ = new ArrayList<String>();
+
+    // Page -> C++ transport on Android < 6, which has no message ports.
+    private class ChannelBridge
+    {
+        @JavascriptInterface
+        public void postMessages(final String token, final String batch)
+        {
+            // Called in a WebView thread. The interface is visible to every frame of every page,
+            // so only the shim installed into the page of the allowed origin is listened to.
+            final String expected = channel_token_;
+            if (expected == null || !expected.equals(token))
+            {
+                Log.w(TAG, "Ignoring channel messages from a page or frame without the channel.");
+                return;
+            }
+            forwardChannelMessages(batch);
+        }
+    }
+
     OffscreenWebView()
     {
         // Log.i(TAG, "OffscreenWebView constructor");
@@ -306,7 +503,83 @@ class OffscreenWebView extends OffscreenView
     @Override
     public void callViewPaintMethod(Canvas canvas)
     {
-        ((MyWebView)getView()).onDrawPublic(canvas);
+        // In tiled mode the view is composed from tiles on C++ side, so the regular
+        // painting only reports the damage.
+        if (!tiled_mode_)
+        {
+            ((MyWebView)getView()).onDrawPublic(canvas);
+        }
+    }
+
+    // From C++
+    public void setTiledMode(final boolean enable)
+    {
+        Log.i(TAG, "setTiledMode " + enable);
+        if (enable && getApiLevel() >= 21)
+        {
+            // Otherwise Chromium draws only the visible part of the page. Has effect only
+            // if called before the first WebView is created.
+            try
+            {
+                WebView.enableSlowWholeDocumentDraw();
+            }
+            catch (final Throwable e)
+            {
+                Log.w(TAG, "setTiledMode: enableSlowWholeDocumentDraw failed: " + e);
+            }
+        }
+        tiled_mode_ = enable;
+        invalidateOffscreenView();
+    }
+
+    // From C++
+    /*!
+     * Render the area of the page at document position (x, y) into the bitmap and
+     * call onTileRendered() with the same x, y and request id.
+     */
+    public void renderTile(final Bitmap bitmap, final int x, final int y, final int request)
+    {
+        runViewAction(new Runnable() {
+            @Override
+            public void run()
+            {
+                boolean ok = false;
+                final MyWebView v = (MyWebView)getView();
+                if (v != null && bitmap != null && tiled_mode_)
+                {
+                    try
+                    {
+                        Canvas canvas = new Canvas(bitmap);
+                        synchronized (view_variables_mutex_)
+                        {
+                            canvas.drawColor(
+                                Color.argb(fill_a_, fill_r_, fill_g_, fill_b_)
+                                , PorterDuff.Mode.SRC);
+                        }
+                        canvas.translate(-x, -y);
+                        v.onDrawPublic(canvas);
+                        ok = true;
+                    }
+                    catch (final Throwable e)
+                    {
+                        Log.e(TAG, "renderTile failed!", e);
+                    }
+                }
+                onTileRendered(getNativePtr(), x, y, request, ok);
+            }
+        });
+    }
+
+    // From C++
+    public void setScrollPosition(final int x, final int y)
+    {
+        runViewAction(new Runnable() {
+            @Override
+            public void run()
+            {
+                ((MyWebView)getView()).scrollTo(x, y);
+            }
+        });
     }
 
     // From C++
@@ -477,6 +750,398 @@ class OffscreenWebView extends OffscreenView
         });
     }
 
+    // From C++
+    public void setMessageChannelEnabled(final boolean enable)
+    {
+        channel_enabled_ = enable;
+        runViewAction(new Runnable() {
+            @Override
+            public void run()
+            {
+                final MyWebView v = (MyWebView)getView();
+                if (enable)
+                {
+                    // Message ports are used where available, so the page gets no interface.
+                    if (getApiLevel() < 23)
+                    {
+                        // Visible to the pages loaded after this.
+                        v.addJavascriptInterface(new ChannelBridge(), CHANNEL_BRIDGE_NAME);
+                    }
+                }
+                else
+                {
+                    if (getApiLevel() < 23)
+                    {
+                        v.removeJavascriptInterface(CHANNEL_BRIDGE_NAME);
+                    }
+                    closeChannel();
+                    channel_queue_.clear();
+                }
+            }
+        });
+    }
+
+    // From C++
+    //! Origin (scheme://host[:port]) of the pages which get the channel, "*" for any page.
+    public void setMessageChannelOrigin(final String origin)
+    {
+        channel_allowed_origin_ = (origin == null || origin.isEmpty())? null: origin;
+    }
+
+    //! Origin of the URL in the form used by postWebMessage() and CORS, or null if it has none.
+    private static String urlOrigin(final String url)
+    {
+        if (url == null)
+        {
+            return null;
+        }
+        final Uri uri = Uri.parse(url);
+        final String scheme = uri.getScheme();
+        final String host = uri.getHost();
+        if (scheme == null || host == null || host.isEmpty())
+        {
+            return null;
+        }
+        final String lower_scheme = scheme.toLowerCase();
+        final int port = uri.getPort();
+        final boolean default_port = port == -1
+            || (port == 80 && lower_scheme.equals("http"))
+            || (port == 443 && lower_scheme.equals("https"));
+        return lower_scheme + "://" + host.toLowerCase() + ((default_port)? "": ":" + port);
+    }
+
+    // From C++
+    //! Deliver a JSON array of messages to the page, or queue it until the page is ready.
+    public void postMessages(final String batch)
+    {
+        runViewAction(new Runnable() {
+            @Override
+            public void run()
+            {
+                if (!channel_enabled_)
+                {
+                    return;
+                }
+                if (channel_ready_)
+                {
+                    sendChannelBatch(batch);
+                }
+                else
+                {
+                    channel_queue_.add(batch);
+                }
+            }
+        });
+    }
+
+    // From C++
+    //! Evaluate the script in the current page and call onJavascriptResult() with the same request id.
+    public void evaluateJavascript(final String script, final int request)
+    {
+        runViewAction(new Runnable() {
+            @Override
+            public void run()
+            {
+                final MyWebView v = (MyWebView)getView();
+                if (getApiLevel() >= 19)
+                {
+                    v.evaluateJavascript(script, new ValueCallback<String>() {
+                        @Override
+                        public void onReceiveValue(String value)
+                        {
+                            onJavascriptResult(getNativePtr(), request, value);
+                        }
+                    });
+                }
+                else
+                {
+                    v.loadUrl("javascript:" + script);
+                    onJavascriptResult(getNativePtr(), request, "null");
+                }
+            }
+        });
+    }
+
+    // Called in UI thread when a page has been loaded.
+    private void installChannel()
+    {
+        closeChannel();
+        if (!channel_enabled_)
+        {
+            return;
+        }
+        final MyWebView v = (MyWebView)getView();
+        final String allowed_origin = channel_allowed_origin_;
+        final String page_origin = urlOrigin(v.getUrl());
+        if (allowed_origin == null
+            || (!allowed_origin.equals("*") && !allowed_origin.equalsIgnoreCase(page_origin)))
+        {
+            Log.i(TAG, "Message channel is not installed into a page of origin " + page_origin);
+            return;
+        }
+        final byte[] secret = new byte[16];
+        channel_random_.nextBytes(secret);
+        final StringBuilder token = new StringBuilder();
+        for (final byte b: secret)
+        {
+            token.append(String.format("%02x", b & 0xff));
+        }
+        channel_token_ = token.toString();
+        channel_page_origin_ = (page_origin != null)? page_origin: allowed_origin;
+        final String shim = CHANNEL_SHIM.replace(CHANNEL_TOKEN_PLACEHOLDER, channel_token_);
+        final int generation = channel_generation_;
+        if (getApiLevel() >= 19)
+        {
+            v.evaluateJavascript(shim, new ValueCallback<String>() {
+                @Override
+                public void onReceiveValue(String value)
+                {
+                    // Skip if another page has started loading meanwhile.
+                    if (generation == channel_generation_)
+                    {
+                        onChannelInstalled();
+                    }
+                }
+            });
+        }
+        else
+        {
+            v.loadUrl("javascript:" + shim);
+            onChannelInstalled();
+        }
+    }
+
+    private void onChannelInstalled()
+    {
+        if (getApiLevel() >= 23)
+        {
+            createChannelPort();
+        }
+        channel_ready_ = true;
+        for (final String batch: channel_queue_)
+        {
+            sendChannelBatch(batch);
+        }
+        channel_queue_.clear();
+    }
+
+    // Hand a message port over to the page, if it still has the allowed origin. It is used after the
+    // page has confirmed it via the port, evaluateJavascript() is used until then.
+    private void createChannelPort()
+    {
+        try
+        {
+            final MyWebView v = (MyWebView)getView();
+            final WebMessagePort[] ports = v.createWebMessageChannel();
+            ports[0].setWebMessageCallback(new WebMessagePort.WebMessageCallback() {
+                @Override
+                public void onMessage(WebMessagePort port, WebMessage message)
+                {
+                    if (port != channel_port_)
+                    {
+                        return;
+                    }
+                    final String data = message.getData();
+                    if (CHANNEL_PORT_MESSAGE.equals(data))
+                    {
+                        channel_port_confirmed_ = true;
+                    }
+                    else if (data != null)
+                    {
+                        forwardChannelMessages(data);
+                    }
+                }
+            });
+            channel_port_ = ports[0];
+            // With "*" the page origin may be opaque (e.g. data: URLs), which only "*" can target.
+            final String target = ("*".equals(channel_allowed_origin_))? "*": channel_page_origin_;
+            v.postWebMessage(
+                new WebMessage(CHANNEL_PORT_MESSAGE + ":" + channel_token_, new WebMessagePort[] { ports[1] }),
+                Uri.parse(target));
+        }
+        catch (final Throwable e)
+        {
+            Log.w(TAG, "Message port is not available, using evaluateJavascript: " + e);
+            closeChannelPort();
+        }
+    }
+
+    private void sendChannelBatch(final String batch)
+    {
+        if (channel_port_ != null && channel_port_confirmed_)
+        {
+            try
+            {
+                channel_port_.postMessage(new WebMessage(batch));
+                return;
+            }
+            catch (final Throwable e)
+            {
+                Log.w(TAG, "Failed to post to the message port: " + e);
+                closeChannelPort();
+            }
+        }
+        // JSON is a valid JavaScript literal except for these two characters in strings.
+        final String script = "window.qtChannel._receive(" +
+            batch.replace("\u2028", "\\u2028").replace("\u2029", "\\u2029") + ");";
+        final MyWebView v = (MyWebView)getView();
+        if (getApiLevel() >= 19)
+        {
+            v.evaluateJavascript(script, null);
+        }
+        else
+        {
+            v.loadUrl("javascript:" + script);
+        }
+    }
+
+    // Called in UI thread when a new page starts loading or the channel is disabled.
+    private void closeChannel()
+    {
+        ++channel_generation_;
+        channel_ready_ = false;
+        channel_token_ = null;
+        channel_page_origin_ = null;
+        closeChannelPort();
+    }
+
+    private void closeChannelPort()
+    {
+        if (channel_port_ != null)
+        {
+            try
+            {
+                channel_port_.close();
+            }
+            catch (final Throwable e)
+            {
+                Log.w(TAG, "Failed to close the message port: " + e);
+            }
+            channel_port_ = null;
+        }
+        channel_port_confirmed_ = false;
+    }
+
+    // Called in UI thread or a WebView thread.
+    private void forwardChannelMessages(final String batch)
+    {
+        if (!channel_enabled_ || channel_page_origin_ == null)
+        {
+            return;
+        }
+        synchronized(nativePtrMutex()) {
+            final long ptr = getNativePtr();
+            if (ptr != 0)
+            {
+                onChannelMessages(ptr, batch);
+            }
+        }
+    }
+
+    /*!
+     * Stream over a direct buffer which wraps native memory. The memory is kept by C++
+     * until the stream is closed, so WebView reads it without copying into a byte[] first.
+     */
+    static class NativeBufferInputStream extends InputStream
+    {
+        private ByteBuffer buffer_;
+        private long handle_;
+
+        NativeBufferInputStream(final ByteBuffer buffer, final long handle)
+        {
+            buffer_ = buffer;
+            handle_ = handle;
+        }
+
+        @Override
+        public synchronized int read()
+        {
+            if (buffer_ == null || !buffer_.hasRemaining())
+            {
+                return -1;
+            }
+            return buffer_.get() & 0xff;
+        }
+
+        @Override
+        public synchronized int read(byte[] b, int off, int len)
+        {
+            if (buffer_ == null || !buffer_.hasRemaining())
+            {
+                return -1;
+            }
+            final int count = Math.min(len, buffer_.remaining());
+            buffer_.get(b, off, count);
+            return count;
+        }
+
+        @Override
+        public synchronized long skip(long n)
+        {
+            if (buffer_ == null || n <= 0)
+            {
+                return 0;
+            }
+            final int count = (int)Math.min(n, (long)buffer_.remaining());
+            buffer_.position(buffer_.position() + count);
+            return count;
+        }
+
+        @Override
+        public synchronized int available()
+        {
+            return (buffer_ == null)? 0: buffer_.remaining();
+        }
+
+        @Override
+        public synchronized void close()
+        {
+            buffer_ = null;
+            if (handle_ != 0)
+            {
+                nativeReleaseResource(handle_);
+                handle_ = 0;
+            }
+        }
+
+        @Override
+        protected void finalize() throws Throwable
+        {
+            try
+            {
+                close();
+            }
+            finally
+            {
+                super.finalize();
+            }
+        }
+    }
+
+    // From C++: wrap a native buffer into a response for shouldInterceptRequest().
+    // channel_blob: let the page of the message channel load the resource with XMLHttpRequest (Android 5+).
+    WebResourceResponse createNativeResponse(final String mime_type, final String encoding, final ByteBuffer buffer, final long handle, final boolean channel_blob)
+    {
+        try
+        {
+            final WebResourceResponse response = new WebResourceResponse(mime_type, encoding, new NativeBufferInputStream(buffer, handle));
+            final String origin = channel_page_origin_;
+            if (channel_blob && origin != null && getApiLevel() >= 21)
+            {
+                final Map<String, String> headers = new HashMap<String, String>();
+                headers.put("Access-Control-Allow-Origin", origin);
+                response.setResponseHeaders(headers);
+            }
+            return response;
+        }
+        catch (final Throwable e)
+        {
+            Log.e(TAG, "Exception in createNativeResponse:", e);
+            nativeReleaseResource(handle);
+            return null;
+        }
+    }
+
     // WebViewClient
     public native void doUpdateVisitedHistory(long nativeptr, String url, boolean isReload);
     public native void onFormResubmission(long nativeptr, Message dontResend, Message resend);
@@ -502,5 +1167,21 @@ class OffscreenWebView extends OffscreenView
     public native void onCanGoBackReceived(long nativeptr, boolean can);
     public native void onCanGoForwardReceived(long nativeptr, boolean can);
     public native void onCanGoBackOrForwardReceived(long nativeptr, boolean can, int steps);
+
+    // Tiled rendering
+    public native void onTileRendered(long nativeptr, int x, int y, int request, boolean ok);
+    public native void onTilesDamaged(long nativeptr, int left, int top, int right, int bottom);
+    public native void onTiledScrollChanged(long nativeptr, int x, int y);
+    public native void onTiledContentHeight(long nativeptr, int height);
+
+    // Resource interception
+    public static native void nativeReleaseResource(long handle);
+    public native long nativeAcquireResources(long nativeptr);
+    public native WebResourceResponse nativeServeResource(long resources, String url);
+    public static native void nativeReleaseResources(long resources);
+
+    // JavaScript message channel
+    public native void onChannelMessages(long nativeptr, String batch);
+    public native void onJavascriptResult(long nativeptr, int request, String result);
 }
 
@@ -0,0 +1,91 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Throughput of the R/B swizzle kernels on typical offscreen view sizes. Reports GB/s of
+// image data converted (4 bytes per pixel; the memory traffic is twice that when copying).
+
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "QAndroidPixelSwizzle.h"
+
+using namespace QAndroidPixelSwizzle;
+
+//! Best of several runs, in seconds.
+template<class F> static double measure(F && f, int repeat)
+{
+	double best = 1e9;
+	for (int run = 0; run < 5; ++run)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < repeat; ++i)
+		{
+			f();
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count() / repeat);
+	}
+	return best;
+}
+
+int main()
+{
+	struct Size { int width, height; };
+	const Size sizes[] = { { 256, 256 }, { 720, 1280 }, { 1080, 1920 }, { 1440, 3000 } };
+
+	Implementation impls[8];
+	const int count = supportedImplementations(impls, 8);
+	printf("%-8s %12s %12s %12s\n", "kernel", "size", "copy GB/s", "inplace GB/s");
+	for (const Size & size : sizes)
+	{
+		const size_t pixels = static_cast<size_t>(size.width) * static_cast<size_t>(size.height);
+		std::vector<uint32_t> src(pixels, 0x80402010u), dest(pixels);
+		const int repeat = static_cast<int>(std::max<size_t>(1, 50000000 / pixels));
+		const double bytes = static_cast<double>(pixels) * 4;
+		for (int i = 0; i < count; ++i)
+		{
+			const SwapFunction function = impls[i].function;
+			const double copy = measure([&]() { function(src.data(), dest.data(), pixels); }, repeat);
+			const double in_place = measure([&]() { function(dest.data(), dest.data(), pixels); }, repeat);
+			char size_text[32];
+			snprintf(size_text, sizeof(size_text), "%dx%d", size.width, size.height);
+			printf("%-8s %12s %12.2f %12.2f\n", impls[i].name, size_text, bytes / copy / 1e9, bytes / in_place / 1e9);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,170 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Correctness test of the R/B swizzle kernels against the scalar implementation.
+// Every kernel supported by the CPU is tested: NEON on ARM, SSE2 / SSSE3 / AVX2 on x86.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "QAndroidPixelSwizzle.h"
+
+using namespace QAndroidPixelSwizzle;
+
+static int g_failures = 0;
+
+static uint32_t nextRandom()
+{
+	static uint32_t state = 0x12345678u;
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static void check(bool ok, const char * kernel, const char * what, int a, int b, int c)
+{
+	if (!ok)
+	{
+		++g_failures;
+		if (g_failures <= 20)
+		{
+			fprintf(stderr, "FAIL [%s] %s (%d, %d, %d)\n", kernel, what, a, b, c);
+		}
+	}
+}
+
+//! Runs of all lengths around the vector widths, at unaligned offsets, copying and in place.
+static void testRuns(const Implementation & impl)
+{
+	const int c_max_count = 300;
+	std::vector<uint32_t> src(c_max_count + 8), expected(c_max_count + 8), dest(c_max_count + 8);
+	for (int count = 0; count <= c_max_count; count += (count < 70)? 1: 37)
+	{
+		for (int offset = 0; offset < 4; ++offset)
+		{
+			for (uint32_t & p : src)
+			{
+				p = nextRandom();
+			}
+			swapRedBlueScalar(src.data() + offset, expected.data() + offset, static_cast<size_t>(count));
+
+			// Guard pixels around the run must not be touched.
+			std::fill(dest.begin(), dest.end(), 0xDEADBEEFu);
+			impl.function(src.data() + offset, dest.data() + offset, static_cast<size_t>(count));
+			check(memcmp(dest.data() + offset, expected.data() + offset, static_cast<size_t>(count) * 4) == 0,
+				impl.name, "copy", count, offset, 0);
+			check(dest[static_cast<size_t>(offset + count)] == 0xDEADBEEFu && (offset == 0 || dest[static_cast<size_t>(offset - 1)] == 0xDEADBEEFu),
+				impl.name, "copy guard", count, offset, 0);
+
+			std::vector<uint32_t> in_place(src);
+			impl.function(in_place.data() + offset, in_place.data() + offset, static_cast<size_t>(count));
+			check(memcmp(in_place.data() + offset, expected.data() + offset, static_cast<size_t>(count) * 4) == 0,
+				impl.name, "in place", count, offset, 0);
+		}
+	}
+}
+
+//! Rectangles with odd widths and row padding; the padding of the destination must stay intact.
+static void testRects(const Implementation & impl)
+{
+	for (int width = 1; width <= 41; width += 2)
+	{
+		for (int height = 1; height <= 5; ++height)
+		{
+			for (int src_pad = 0; src_pad <= 3; ++src_pad)
+			{
+				for (int dest_pad = 0; dest_pad <= 3; ++dest_pad)
+				{
+					const ptrdiff_t src_stride = (width + src_pad) * 4;
+					const ptrdiff_t dest_stride = (width + dest_pad) * 4;
+					std::vector<uint32_t> src(static_cast<size_t>((width + src_pad) * height));
+					for (uint32_t & p : src)
+					{
+						p = nextRandom();
+					}
+					std::vector<uint32_t> dest(static_cast<size_t>((width + dest_pad) * height), 0xDEADBEEFu);
+					swapRedBlue(
+						impl.function,
+						reinterpret_cast<const uint8_t *>(src.data()), src_stride,
+						reinterpret_cast<uint8_t *>(dest.data()), dest_stride,
+						width, height);
+					bool ok = true;
+					for (int y = 0; y < height; ++y)
+					{
+						for (int x = 0; x < width + dest_pad; ++x)
+						{
+							const uint32_t got = dest[static_cast<size_t>(y * (width + dest_pad) + x)];
+							uint32_t want = 0xDEADBEEFu;
+							if (x < width)
+							{
+								swapRedBlueScalar(&src[static_cast<size_t>(y * (width + src_pad) + x)], &want, 1);
+							}
+							ok = ok && got == want;
+						}
+					}
+					check(ok, impl.name, "rect", width, height, src_pad * 4 + dest_pad);
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	const uint32_t argb = 0x11223344u;
+	uint32_t abgr = 0;
+	swapRedBlueScalar(&argb, &abgr, 1);
+	check(abgr == 0x11443322u, "scalar", "reference pixel", 0, 0, 0);
+
+	Implementation impls[8];
+	const int count = supportedImplementations(impls, 8);
+	printf("Selected kernel: %s\n", implementationName());
+	for (int i = 0; i < count; ++i)
+	{
+		printf("Testing %s\n", impls[i].name);
+		testRuns(impls[i]);
+		testRects(impls[i]);
+	}
+	if (g_failures)
+	{
+		fprintf(stderr, "%d check(s) failed\n", g_failures);
+		return 1;
+	}
+	printf("All kernels match the scalar implementation\n");
+	return 0;
+}
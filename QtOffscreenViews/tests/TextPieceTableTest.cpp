@@ -0,0 +1,185 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Test of QAndroidTextPieceTable: edits are checked against QString::replace() on a copy
+// of the text, including compaction of the pieces and rejection of out-of-range edits.
+
+#include <stdio.h>
+#include <stdint.h>
+#include "QAndroidTextPieceTable.h"
+
+static int g_failures = 0;
+
+//! Same as c_MaxPieces in QAndroidTextPieceTable.cpp.
+static const int c_max_pieces = 512;
+
+static uint32_t nextRandom()
+{
+	static uint32_t state = 0x2468ACE1u;
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static void check(bool ok, const char * what, int a, int b)
+{
+	if (!ok)
+	{
+		++g_failures;
+		if (g_failures <= 20)
+		{
+			fprintf(stderr, "FAIL %s (%d, %d)\n", what, a, b);
+		}
+	}
+}
+
+static QString randomText(int length)
+{
+	QString text;
+	for (int i = 0; i < length; ++i)
+	{
+		text.append(QChar(static_cast<char16_t>(u'a' + nextRandom() % 26)));
+	}
+	return text;
+}
+
+static void testReplace()
+{
+	QAndroidTextPieceTable table;
+	check(table.isEmpty() && table.text().isEmpty() && table.pieceCount() == 0, "empty", 0, 0);
+
+	table.setText(QStringLiteral("hello world"));
+	check(table.replace(0, 0, QStringLiteral(">> ")), "insert at start", 0, 0);
+	check(table.replace(table.length(), 0, QStringLiteral("!")), "insert at end", 0, 0);
+	check(table.replace(9, 5, QStringLiteral("there")), "replace in the middle", 0, 0);
+	check(table.text() == QStringLiteral(">> hello there!"), "text after edits", table.length(), table.pieceCount());
+	check(table.replace(0, table.length(), QString()), "remove everything", 0, 0);
+	check(table.isEmpty() && table.text().isEmpty(), "empty after removal", table.length(), table.pieceCount());
+
+	// Typing characters one after another must not add a piece per character.
+	table.setText(QStringLiteral("abc"));
+	for (int i = 0; i < 100; ++i)
+	{
+		table.replace(1 + i, 0, QStringLiteral("x"));
+	}
+	check(table.pieceCount() == 3, "typing pieces", table.pieceCount(), 3);
+
+	// Random edits against QString.
+	QString expected = randomText(1000);
+	table.setText(expected);
+	for (int i = 0; i < 5000; ++i)
+	{
+		const int length = static_cast<int>(expected.length());
+		const int position = static_cast<int>(nextRandom() % static_cast<uint32_t>(length + 1));
+		const int removed = static_cast<int>(nextRandom() % static_cast<uint32_t>(qMin(length - position, 8) + 1));
+		const QString inserted = randomText(static_cast<int>(nextRandom() % 5));
+		check(table.replace(position, removed, inserted), "random replace", position, removed);
+		expected.replace(position, removed, inserted);
+		check(table.length() == static_cast<int>(expected.length()), "random length", i, table.length());
+		if (i % 97 == 0)
+		{
+			check(table.text() == expected, "random text", i, table.pieceCount());
+		}
+		check(table.pieceCount() <= c_max_pieces, "piece limit", i, table.pieceCount());
+	}
+	check(table.text() == expected, "final random text", table.length(), table.pieceCount());
+}
+
+static void testCompaction()
+{
+	// Each insertion at an even offset splits an original piece, adding two pieces.
+	QString expected = randomText(2 * c_max_pieces);
+	QAndroidTextPieceTable table(expected);
+	int previous_count = table.pieceCount();
+	bool compacted = false;
+	for (int i = 0; i < c_max_pieces && !compacted; ++i)
+	{
+		const int position = i * 3;
+		table.replace(position, 0, QStringLiteral("#"));
+		expected.insert(position, QLatin1Char('#'));
+		compacted = table.pieceCount() < previous_count;
+		previous_count = table.pieceCount();
+	}
+	check(compacted, "compacted", previous_count, c_max_pieces);
+	check(table.pieceCount() == 1, "one piece after compaction", table.pieceCount(), 1);
+	check(table.text() == expected, "text after compaction", table.length(), static_cast<int>(expected.length()));
+
+	// Edits after compaction continue from the merged text.
+	table.replace(1, 2, QStringLiteral("xyz"));
+	expected.replace(1, 2, QStringLiteral("xyz"));
+	check(table.text() == expected, "text after compaction and edit", table.length(), static_cast<int>(expected.length()));
+}
+
+static void testOutOfRange()
+{
+	const QString original = QStringLiteral("0123456789");
+	QAndroidTextPieceTable table(original);
+	table.replace(5, 0, QStringLiteral("ab"));
+	const QString text = table.text();
+	const int length = table.length();
+	const int pieces = table.pieceCount();
+	const int edits[][2] = {
+		{ -1, 0 },
+		{ 0, -1 },
+		{ length + 1, 0 },
+		{ length, 1 },
+		{ 3, length },
+		{ 0, length + 1 },
+	};
+	for (const auto & edit : edits)
+	{
+		check(!table.replace(edit[0], edit[1], QStringLiteral("x")), "out of range accepted", edit[0], edit[1]);
+		check(table.text() == text && table.length() == length && table.pieceCount() == pieces,
+			"out of range changed the text", edit[0], edit[1]);
+	}
+	check(table.replace(length, 0, QString()), "empty edit at end", length, 0);
+	check(table.text() == text, "empty edit changed the text", length, 0);
+}
+
+int main()
+{
+	testReplace();
+	testCompaction();
+	testOutOfRange();
+	if (g_failures)
+	{
+		fprintf(stderr, "%d check(s) failed\n", g_failures);
+		return 1;
+	}
+	printf("Piece table edits match QString\n");
+	return 0;
+}
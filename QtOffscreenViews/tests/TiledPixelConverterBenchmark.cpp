@@ -0,0 +1,139 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Sweep of QAndroidTiledPixelConverter over image sizes and thread counts. For each size
+// prints the in-place conversion time on 1..N threads and the speedup over one thread,
+// then the smallest measured size at which splitting pays off, which is what
+// QAndroidTiledPixelConverter::parallelThreshold() should be set to. Run it on the
+// target device (e.g. pushed with adb), as the result depends on the cores and memory.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "QAndroidTiledPixelConverter.h"
+
+namespace Converter = QAndroidTiledPixelConverter;
+
+//! Splitting must be at least this much faster to count as paying off, so noise does not.
+static const double c_MinGain = 0.9;
+
+//! Best of several runs, in seconds.
+template<class F> static double measure(F && f, int repeat)
+{
+	double best = 1e9;
+	for (int run = 0; run < 5; ++run)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < repeat; ++i)
+		{
+			f();
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count() / repeat);
+	}
+	return best;
+}
+
+//! Usage: TiledPixelConverterBenchmark [max_threads]; defaults to all cores.
+int main(int argc, char ** argv)
+{
+	struct Size { int width, height; };
+	const Size sizes[] = {
+		{ 128, 128 }, { 256, 256 }, { 384, 384 }, { 512, 512 }, { 768, 768 },
+		{ 720, 1280 }, { 1080, 1920 }, { 1440, 3000 } };
+
+	// The converter never uses more threads than there are cores.
+	Converter::setMaxThreadCount((argc > 1) ? atoi(argv[1]) : 1000);
+	const int max_threads = Converter::threadCount();
+
+	// Always split, so small sizes show the cost of the pool round trip.
+	Converter::setParallelThreshold(0);
+
+	printf("%12s %8s %10s %8s %8s\n", "size", "threads", "usec", "GB/s", "speedup");
+	const Size * break_even = nullptr;
+	for (const Size & size : sizes)
+	{
+		const size_t pixels = static_cast<size_t>(size.width) * static_cast<size_t>(size.height);
+		std::vector<uint32_t> image(pixels, 0x80402010u);
+		uint8_t * data = reinterpret_cast<uint8_t *>(image.data());
+		const ptrdiff_t stride = static_cast<ptrdiff_t>(size.width) * 4;
+		const int repeat = static_cast<int>(std::max<size_t>(1, 50000000 / pixels));
+		const double bytes = static_cast<double>(pixels) * 4;
+		char size_text[32];
+		snprintf(size_text, sizeof(size_text), "%dx%d", size.width, size.height);
+
+		double single = 0;
+		bool pays_off = false;
+		for (int threads = 1; threads <= max_threads; ++threads)
+		{
+			Converter::setMaxThreadCount(threads);
+			const double time = measure([&]() {
+				Converter::swapRedBlue(data, stride, data, stride, size.width, size.height); }, repeat);
+			if (threads == 1)
+			{
+				single = time;
+			}
+			else if (time < single * c_MinGain)
+			{
+				pays_off = true;
+			}
+			printf("%12s %8d %10.1f %8.2f %8.2f\n",
+				size_text, threads, time * 1e6, bytes / time / 1e9, single / time);
+		}
+		if (pays_off && !break_even)
+		{
+			break_even = &size;
+		}
+	}
+
+	if (max_threads < 2)
+	{
+		printf("Single core: nothing to parallelize.\n");
+	}
+	else if (break_even)
+	{
+		printf("Parallel conversion pays off from %dx%d (%d pixels).\n",
+			break_even->width, break_even->height, break_even->width * break_even->height);
+	}
+	else
+	{
+		printf("Parallel conversion does not pay off at any measured size.\n");
+	}
+	return 0;
+}
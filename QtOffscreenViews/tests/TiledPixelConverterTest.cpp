@@ -0,0 +1,192 @@
+/*
+  Offscreen Android Views library for Qt
+
+  Author:
+  Sergey A. Galin <sergey.galin@gmail.com>
+
+  Distrbuted under The BSD License
+
+  Copyright (c) 2026, DoubleGIS, LLC.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+  * Neither the name of the DoubleGIS, LLC nor the names of its contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+  BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+  THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Correctness test of QAndroidTiledPixelConverter: the output of the parallel banded
+// conversion must match a single-threaded pass for odd heights, more bands than rows,
+// padded strides and in-place conversion. The threads are oversubscribed, so the parallel
+// path runs on single-core machines too.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "QAndroidPixelSwizzle.h"
+#include "QAndroidTiledPixelConverter.h"
+
+namespace Converter = QAndroidTiledPixelConverter;
+
+static int g_failures = 0;
+
+static uint32_t nextRandom()
+{
+	static uint32_t state = 0x87654321u;
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static void check(bool ok, const char * what, int width, int height, int threads, int pad)
+{
+	if (!ok)
+	{
+		++g_failures;
+		if (g_failures <= 20)
+		{
+			fprintf(stderr, "FAIL %s (width %d, height %d, threads %d, pad %d)\n", what, width, height, threads, pad);
+		}
+	}
+}
+
+//! Converts with the current settings and compares with QAndroidPixelSwizzle::swapRedBlue().
+static void testRect(int width, int height, int src_pad, int dest_pad, int threads)
+{
+	const ptrdiff_t src_stride = (width + src_pad) * 4;
+	const ptrdiff_t dest_stride = (width + dest_pad) * 4;
+	std::vector<uint32_t> src(static_cast<size_t>((width + src_pad) * height));
+	for (uint32_t & p : src)
+	{
+		p = nextRandom();
+	}
+	std::vector<uint32_t> expected(static_cast<size_t>((width + dest_pad) * height), 0xDEADBEEFu);
+	QAndroidPixelSwizzle::swapRedBlue(
+		reinterpret_cast<const uint8_t *>(src.data()), src_stride,
+		reinterpret_cast<uint8_t *>(expected.data()), dest_stride,
+		width, height);
+
+	// The padding of the destination must stay intact.
+	std::vector<uint32_t> dest(expected.size(), 0xDEADBEEFu);
+	Converter::swapRedBlue(
+		reinterpret_cast<const uint8_t *>(src.data()), src_stride,
+		reinterpret_cast<uint8_t *>(dest.data()), dest_stride,
+		width, height);
+	check(dest == expected, "copy", width, height, threads, src_pad * 4 + dest_pad);
+
+	if (src_pad == dest_pad)
+	{
+		std::vector<uint32_t> in_place(src);
+		Converter::swapRedBlue(
+			reinterpret_cast<const uint8_t *>(in_place.data()), src_stride,
+			reinterpret_cast<uint8_t *>(in_place.data()), src_stride,
+			width, height);
+		bool ok = true;
+		for (int y = 0; y < height; ++y)
+		{
+			ok = ok && memcmp(
+				&in_place[static_cast<size_t>(y * (width + src_pad))],
+				&expected[static_cast<size_t>(y * (width + dest_pad))],
+				static_cast<size_t>(width) * 4) == 0;
+		}
+		check(ok, "in place", width, height, threads, src_pad);
+	}
+}
+
+//! Conversions racing for the pool: the ones which don't get it run on their own thread.
+static void testConcurrent()
+{
+	const int c_width = 16411, c_height = 37;
+	std::vector<uint32_t> src(static_cast<size_t>(c_width * c_height));
+	for (uint32_t & p : src)
+	{
+		p = nextRandom();
+	}
+	std::vector<uint32_t> expected(src.size());
+	QAndroidPixelSwizzle::swapRedBlue(
+		reinterpret_cast<const uint8_t *>(src.data()), c_width * 4,
+		reinterpret_cast<uint8_t *>(expected.data()), c_width * 4,
+		c_width, c_height);
+
+	const int c_callers = 4;
+	std::vector<std::vector<uint32_t> > results(c_callers, std::vector<uint32_t>(src.size()));
+	std::vector<std::thread> callers;
+	for (int i = 0; i < c_callers; ++i)
+	{
+		callers.emplace_back([&, i]{
+			for (int run = 0; run < 20; ++run)
+			{
+				Converter::swapRedBlue(
+					reinterpret_cast<const uint8_t *>(src.data()), c_width * 4,
+					reinterpret_cast<uint8_t *>(results[static_cast<size_t>(i)].data()), c_width * 4,
+					c_width, c_height);
+			}
+		});
+	}
+	for (std::thread & caller : callers)
+	{
+		caller.join();
+	}
+	for (int i = 0; i < c_callers; ++i)
+	{
+		check(results[static_cast<size_t>(i)] == expected, "concurrent", c_width, c_height, Converter::threadCount(), i);
+	}
+}
+
+int main()
+{
+	Converter::setParallelThreshold(0);
+	// Rows of 16385+ pixels are 64 KB, so bands are a single row and a few-row image gets
+	// fewer rows than the bands wanted; narrow images get few tall bands.
+	const int widths[] = { 1, 7, 1021, 16385, 16411 };
+	const int heights[] = { 1, 2, 3, 5, 7, 15, 17, 31, 67 };
+	const int thread_counts[] = { 2, 3, 4, 16 };
+	for (const int threads : thread_counts)
+	{
+		Converter::setMaxThreadCount(threads, true);
+		printf("Testing %d threads\n", Converter::threadCount());
+		for (const int width : widths)
+		{
+			for (const int height : heights)
+			{
+				for (int src_pad = 0; src_pad <= 3; src_pad += 3)
+				{
+					for (int dest_pad = 0; dest_pad <= 3; dest_pad += 3)
+					{
+						testRect(width, height, src_pad, dest_pad, threads);
+					}
+				}
+			}
+		}
+	}
+	testConcurrent();
+	if (g_failures)
+	{
+		fprintf(stderr, "%d check(s) failed\n", g_failures);
+		return 1;
+	}
+	printf("Parallel conversion matches the single-threaded one\n");
+	return 0;
+}